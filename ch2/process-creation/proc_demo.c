@@ -8,79 +8,7474 @@
  * Unix/Linux: fork + exec 조합 사용
  */
 
+#ifndef _WIN32
+  #define _GNU_SOURCE    // pipe2() 등 GNU/Linux 확장 함수용
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#ifdef _WIN32
-  #include <windows.h>
-  #include <process.h>   // _getpid() 함수용
-#else
-  #include <unistd.h>    // fork(), execvp(), getpid(), sleep() 함수용
-  #include <sys/wait.h>  // waitpid() 함수용
-#endif
+#ifdef _WIN32
+  #include <windows.h>
+  #include <process.h>   // _getpid() 함수용
+#else
+  #include <unistd.h>    // fork(), execvp(), getpid(), sleep() 함수용
+  #include <sys/wait.h>  // waitpid() 함수용
+  #include <errno.h>     // errno, strerror() 함수용
+  #include <fcntl.h>     // O_CLOEXEC, fcntl() 함수용
+  #include <time.h>      // clock_gettime(), nanosleep() 함수용
+  #include <limits.h>    // INT_MAX
+  #include <sys/mman.h>  // mmap(), memfd_create() 함수용
+  #include <sys/stat.h>  // fstat() 함수용
+  #include <sys/sysmacros.h>  // major(), minor() (--io-cgroup의 장치 번호)
+  #include <sys/resource.h>  // getrusage() 함수용
+  #include <sys/time.h>  // setitimer() 함수용 (--timeout-ms)
+  #include <signal.h>    // raise(), strsignal() 함수용
+  #include <pthread.h>   // pthread_create() 함수용 (--compare, --fibers)
+  #include <sched.h>     // CLONE_NEW* 플래그
+  #include <sys/mount.h> // mount() 함수용 (마운트 네임스페이스)
+  #include <linux/sched.h>   // struct clone_args (clone3)
+  #include <stddef.h>          // offsetof()
+  #include <sys/prctl.h>       // prctl() 함수용 (seccomp 설치)
+  #include <linux/filter.h>    // BPF 명령 (struct sock_filter)
+  #include <linux/seccomp.h>   // SECCOMP_* 상수
+  #include <linux/audit.h>     // AUDIT_ARCH_* (필터의 아키텍처 확인)
+  #ifndef __x86_64__
+    #include <ucontext.h>  // swapcontext() 함수용 (x86_64가 아닌 곳의 파이버 문맥 전환)
+  #endif
+  #include <sys/syscall.h>   // syscall(SYS_futex, ...)
+  #include <linux/futex.h>   // FUTEX_WAIT, FUTEX_WAKE
+  #include <linux/perf_event.h>  // perf_event_open() 구조체와 상수
+  #include <stdint.h>        // uint32_t 등 (--daemon 프로토콜)
+  #include <sys/socket.h>    // socket(), accept4() 함수용 (--daemon, --ctl)
+  #include <sys/un.h>        // struct sockaddr_un
+  #include <sys/epoll.h>     // epoll_wait() 함수용 (데몬 이벤트 루프)
+  #include <sys/signalfd.h>  // signalfd() 함수용 (SIGCHLD를 fd로 받기)
+  #include <poll.h>          // poll() 함수용 (--keep-order)
+  #include <dirent.h>        // readdir() 함수용 (--cache 축출)
+#endif
+
+// 전역 변수: 현재 프로세스가 자식인지, 몇 번째 자식인지 저장
+static int is_child = 0;    // 1이면 자식 프로세스, 0이면 부모 프로세스
+static int child_idx = 0;   // 자식 프로세스의 인덱스 번호 (1, 2, ...)
+static int child_slot = 0;  // 자식이 쓸 공유 메모리 슬롯 번호 (--slot=N, 없으면 인덱스와 같음)
+
+// 부모 프로세스 옵션
+static int num_children = 2;          // 생성할 자식 프로세스 수 (--children=N)
+static const char* exec_path = NULL;  // 자식으로 exec할 프로그램 (--exec=PATH, 기본값: argv[0])
+static int parallel = 0;              // 1이면 모든 자식을 동시에 실행 (--parallel)
+static int jobs = 1;                  // 동시에 살아 있을 수 있는 자식 수 (--jobs=K)
+static int fail_every = 0;            // K번째 자식마다 잘못된 종료 코드로 끝내기 (--fail-every=K)
+static int crash_every = 0;           // K번째 자식마다 SIGSEGV로 죽이기 (--crash-every=K)
+static int quiet = 0;                 // 자식별 출력 끄기 (--quiet, 자식이 32개를 넘으면 자동)
+static const char* perf_list = NULL;  // 수집할 성능 카운터 목록 (--perf=EV,EV,...)
+static int use_barrier = 1;           // 동시 실행 시 시작 배리어 사용 여부 (--no-barrier로 끔)
+static int compare_n = 0;             // 스레드/fork/fork+exec 비교 모드 단위 수 (--compare=N)
+static int fibers_n = 0;              // 파이버 실행기 모드의 파이버 수 (--fibers=N)
+static int fiber_threads = 0;         // 파이버를 실행할 OS 스레드 수 (--fiber-threads=T, 기본값 CPU 수)
+static size_t fiber_stack = 2048;     // 파이버 스택 크기 (--fiber-stack=BYTES)
+#define FIBER_STACK_MIN 1024UL
+#define FIBER_STACK_MAX (32UL << 20)  // 64MB 스택 덩어리에 머리 칸과 스택 한 칸이 들어가야 함
+static const char* ns_list = NULL;    // 자식을 격리할 네임스페이스 목록 (--ns=user,pid,...)
+static int ns_bench_n = 0;            // 네임스페이스별 생성 비용 벤치마크 (--ns-bench=N)
+static int seccomp_opt = 0;           // 자식에 seccomp 필터 설치 (--seccomp)
+static int seccomp_bench_n = 0;       // seccomp 비용 벤치마크 (--seccomp-bench=N)
+static int mem_report = 0;            // 대기 중인 부모/자식의 PSS/USS 보고 (--mem-report)
+static int exec_bench_n = 0;          // 자식 바이너리의 exec → main 지연 측정 (--exec-bench=N)
+static int timeout_ms = 0;            // 자식 하나의 최대 실행 시간, 넘으면 종료 (--timeout-ms=N)
+static int sample_ms = 0;             // 백그라운드 /proc 샘플링 간격 (--sample-ms=N, 0이면 끔)
+static const char* sample_out = NULL; // 샘플 CSV 저장 파일 (--sample-out=FILE)
+static const char* sched_specs[8];    // 자식별 스케줄링 규칙 (--sched=RANGE:POLICY[:WORK])
+static int n_sched_specs = 0;
+static const char* ioprio_specs[8];   // 자식별 I/O 우선순위 (--ioprio=RANGE:CLASS[/LEVEL])
+static int n_ioprio_specs = 0;
+static const char* io_cg_specs[8];    // 자식별 cgroup I/O 제한 (--io-cgroup=RANGE:KEY=VAL,...)
+static int n_io_cg_specs = 0;
+static int io_bench_n = 0;            // 쓰기 자식 N개 옆에서 읽기 지연 비교 (--io-bench=N)
+static const char* fd_hygiene_name = NULL;  // exec 전 fd 정리 방식 (--fd-hygiene=cloexec|close|off)
+static int hold_fds_n = 0;            // 부모가 미리 열어 둘 (새는) fd 수 (--hold-fds=N)
+static int fd_bench_n = 0;            // 부모 fd 수와 정리 방식별 생성 비용 비교 (--fd-bench=N)
+static const char* daemon_path = NULL;  // 데몬 모드로 제어 소켓에서 요청 대기 (--daemon=SOCK)
+static const char* ctl_path = NULL;   // 데몬에 요청을 보낼 소켓 (--ctl=SOCK 명령 ...)
+static char** ctl_argv = NULL;        // --ctl 뒤의 명령과 인수
+static int ctl_argc = 0;
+static const char* manifest_path = NULL;  // 실행할 명령 목록 (--manifest=FILE, -이면 stdin)
+static const char* manifest_format = "text";  // 목록 형식 (--manifest-format=text|bin)
+static int manifest_bench_n = 0;      // xargs와 처리량 비교 (--manifest-bench=N)
+static int keep_order = 0;            // 작업 출력을 제출 순서대로 내보냄 (--keep-order)
+static size_t keep_order_mem = 4u << 20;  // 재정렬 버퍼의 메모리 한도 (--keep-order-mem=BYTES)
+static const char* dag_path = NULL;   // 의존성 그래프로 실행할 작업 목록 (--dag=FILE)
+static const char* cache_dir = NULL;  // 작업 결과 캐시 디렉터리 (--cache=DIR)
+static const char* cache_env = "PATH";  // 캐시 키에 넣을 환경 변수 (--cache-env=VAR,...)
+static long long cache_max = 256ll << 20;  // 캐시 크기 한도, 넘으면 오래된 항목 삭제 (--cache-max=BYTES)
+static const char* history_path = NULL;  // 작업별 실행 시간/메모리 기록 파일 (--history=FILE)
+static const char* order_name = "fifo";  // 작업 실행 순서 (--order=fifo|lpt|sjf)
+static long mem_budget_mb = 0;        // 동시에 실행할 작업의 예상 메모리 합 한도 (--mem-budget=MB, 0이면 없음)
+static int history_bench_n = 0;       // 순서별 전체 시간 비교 (--history-bench=N)
+
+// 자식 프로세스 옵션
+static int ready_fd = -1;   // 준비 완료를 알릴 파이프 fd (--ready-fd=N, 부모가 전달)
+static int shm_fd = -1;     // 시작 배리어/타임스탬프용 공유 메모리 fd (--shm-fd=N)
+static int daemon_resume_fd = -1;  // 재실행 전 데몬이 남긴 상태 memfd (--daemon-resume=N, 데몬이 전달)
+static int inject_fail = 0;   // 1이면 기대와 다른 종료 코드로 끝냄 (--fail, 부모가 지정)
+static int inject_crash = 0;  // 1이면 작업 후 SIGSEGV로 죽음 (--crash, 부모가 지정)
+static int minimal = 0;       // 1이면 stdio 없이 최소 경로로 실행 (--minimal, 부모가 전달)
+
+// 자식 작업(payload) 옵션: 부모가 받은 그대로 자식에게 전달됨
+static const char* work_name = "sleep";  // 작업 종류 (--work=sleep|spin|...)
+static int work_ms = 1000;               // 작업 시간 (--work-ms=N, 밀리초)
+static int mem_mb = 64;                  // alloc 작업의 버퍼 크기 (--mem-mb=N)
+static const char* mem_backing = "normal";   // 버퍼 페이지 종류 (--mem-backing=normal|thp|hugetlb)
+static const char* prefault_mode = "none";   // 미리 채우기 (--prefault=none|populate|madvise)
+static int table_entries = 1 << 20;      // table 작업의 항목 수 (--table-entries=N)
+static const char* snapshot_dir = NULL;  // table 스냅샷 저장 위치 (--snapshot-dir=DIR)
+static const char* io_dir = "/var/tmp";  // write/read 작업의 파일 위치 (--io-dir=DIR)
+static int io_file_mb = 256;             // write 작업 파일의 최대 크기 (--io-file-mb=N)
+
+// 부모가 자식에게 그대로 넘겨줄 인수 목록
+// (명령행에서 온 것은 MAX_FWD_ARGS - FWD_ARGS_RESERVED개까지, 나머지는 모드별로 부모가 덧붙이는 몫)
+#define MAX_FWD_ARGS 40
+#define FWD_ARGS_RESERVED 8
+static char* fwd_args[MAX_FWD_ARGS];
+static int n_fwd_args = 0;
+
+// 넘칠 때 조용히 버리면 자식이 요청과 다른 설정으로 돌므로 시작하지 않고 끝냄
+static void forward_arg(char* arg) {
+  if (n_fwd_args == MAX_FWD_ARGS) {
+    fprintf(stderr, "[parent] too many options to forward to children (at most %d): %s\n",
+            MAX_FWD_ARGS - FWD_ARGS_RESERVED, arg);
+    exit(2);
+  }
+  fwd_args[n_fwd_args++] = arg;
+}
+
+/*
+ * 명령행 인수 파싱 함수
+ * 
+ * 프로그램이 자기 자신을 다시 실행할 때 사용하는 인수들:
+ * --child: 이 프로세스가 자식 프로세스임을 나타냄
+ * --id=N: 이 자식 프로세스의 인덱스 번호
+ * --ready-fd=N: 작업 시작 시 1바이트를 써서 부모에게 준비 완료를 알릴 fd
+ * --shm-fd=N: 시작 배리어와 시작/종료 타임스탬프가 들어 있는 공유 메모리 fd
+ * --fail, --crash: 실패 주입 (종료 코드를 바꾸거나 SIGSEGV로 죽음)
+ * --quiet: 자식 쪽 출력 끄기
+ * --minimal: stdio를 쓰지 않는 최소 경로로 실행 (메모리 사용량 줄이기)
+ * --daemon-resume=N: 데몬이 자기 자신을 다시 exec할 때 넘기는 상태 memfd
+ * 
+ * 예: ./proc_demo --child --id=1 --ready-fd=4 --shm-fd=3
+ *
+ * 사용자가 부모 모드에서 줄 수 있는 인수들:
+ * --children=N: 생성할 자식 프로세스 수 (기본값 2)
+ * --exec=PATH: 자식으로 실행할 프로그램 (기본값: 자기 자신)
+ *              존재하지 않는 경로를 주면 exec 실패 감지를 확인할 수 있음
+ * --parallel: 자식을 하나씩 기다리지 않고 모두 만든 뒤 동시에 실행
+ * --no-barrier: --parallel에서 시작 배리어 없이 준비되는 대로 바로 작업 시작
+ * --jobs=K: 최대 K개의 자식을 동시에 유지하며 하나가 끝나면 다음을 생성 (기본값 1)
+ * --quiet: 자식별 출력을 끄고 요약만 출력 (자식이 32개를 넘으면 자동으로 켜짐)
+ * --fail-every=K, --crash-every=K: K번째 자식마다 실패를 주입 (집계 확인용)
+ * --compare=N: 같은 작업을 N개의 스레드, fork 자식, fork+exec 자식으로 각각 실행해
+ *   생성 비용, 메모리, 처리량을 한 표로 비교
+ * --fibers=N: 자식 대신 N개의 사용자 공간 파이버로 sleep 작업을 실행
+ *   (--fiber-threads=T, --fiber-stack=BYTES와 함께 사용)
+ * --ns=user,pid,mount,net,uts,ipc: 자식을 새 네임스페이스에서 실행 (clone3)
+ * --ns-bench=N: 네임스페이스 종류별로 자식 N개씩 만들어 생성 비용 비교
+ * --seccomp: 자식이 exec 전에 seccomp 허용 목록 필터를 설치
+ * --seccomp-bench=N: 필터 유무에 따른 생성 비용과 시스템 콜 비용 비교
+ * --mem-report: 자식이 모두 대기 중일 때 부모와 자식의 RSS/PSS/USS 보고 (--parallel 포함)
+ * --minimal: 자식을 stdio 없는 최소 경로와 작은 스택 한도로 실행
+ * --exec-bench=N: 작업 없는 자식 N개로 exec → main 지연 측정 (--exec=로 빌드 변형 비교)
+ * --timeout-ms=N: fork부터 N밀리초가 지나도 끝나지 않은 자식을 SIGALRM으로 종료
+ * --sample-ms=N: 스레드 하나가 N밀리초마다 자식들의 /proc 통계를 읽어 CPU/RSS 곡선 출력
+ * --sample-out=FILE: 샘플러가 모은 모든 샘플을 CSV로 저장
+ * --sched=RANGE:POLICY[:WORK]: 자식 범위별 nice/batch/idle/fifo/rr/deadline 정책 (여러 번 가능)
+ * --ioprio=RANGE:CLASS[/LEVEL]: 자식 범위별 I/O 우선순위 (rt, be, idle)
+ * --io-cgroup=RANGE:KEY=VAL,...: 자식 범위별 cgroup io.weight / io.max (weight, rbps, wbps, riops, wiops)
+ * --io-bench=N: 쓰기 자식 N개와 읽기 자식을 함께 돌려 격리 유무에 따른 읽기 지연 비교
+ * --fd-hygiene=cloexec|close|off: 자식이 exec 전에 물려받은 fd를 정리하는 방식 (기본값 cloexec)
+ * --hold-fds=N: 부모가 CLOEXEC 없는 fd N개를 들고 시작 (fd가 많은 부모 흉내)
+ * --fd-bench=N: 부모 fd 0/1만/10만 개 x 정리 방식별로 자식 N개씩 생성 비용 비교
+ * --daemon=SOCK: 유닉스 소켓에서 spawn/status/kill/scale/shutdown 요청을 받는 데몬으로 실행
+ *   (자식 작업 기본값은 --work, --work-ms)
+ * --ctl=SOCK CMD [ARGS]: 데몬에 요청 하나를 보내고 결과 출력 (뒤의 인수는 모두 명령으로 취급)
+ *   spawn [WORK [MS]], status [ID], kill ID|all [SIG], scale N, ping, bench N [DEPTH], upgrade, shutdown
+ *   (upgrade 또는 데몬에 SIGHUP: 자식을 멈추지 않고 데몬만 다시 exec)
+ * --manifest=FILE|-: 목록의 명령을 한 줄에 하나씩 스트림으로 읽어 --jobs개씩 실행
+ * --manifest-format=text|bin: 목록 형식 (bin: uint32 argc, 인수마다 uint32 길이 + 바이트)
+ * --keep-order: 작업 stdout을 모아 작업 번호 순서대로 출력 (앞 작업들이 끝나는 즉시)
+ * --keep-order-mem=BYTES: 재정렬 버퍼의 메모리 한도, 넘으면 임시 파일로 내려 씀 (기본값 4 MiB)
+ * --manifest-bench=N: /bin/true N개를 이 실행기(text, bin)와 xargs -P로 돌려 처리량 비교
+ * --dag=FILE: 줄마다 "이름 [after=의존,...] [cost=예상ms] 명령..."인 작업 그래프를 --jobs개씩 실행
+ *   (준비된 작업은 임계 경로가 긴 것부터, 실패하면 의존하는 작업 취소)
+ * --cache=DIR: --manifest, --dag 작업의 종료 코드와 stdout을 내용 해시로 저장해 두고 같은 작업은 실행하지 않음
+ *   (줄 앞의 in=FILE은 키에 들어갈 입력 파일, --keep-order와는 함께 쓸 수 없음)
+ * --cache-env=VAR,...: 캐시 키에 넣을 환경 변수 (기본값 PATH)
+ * --cache-max=BYTES: 캐시 크기 한도, 실행이 끝나면 오래 쓰지 않은 항목부터 삭제 (기본값 256 MiB)
+ * --history=FILE: 작업(명령 해시)별 실행 시간과 최대 RSS를 mmap한 파일에 기록하고 예측에 사용
+ *   (--dag에서 cost=가 없는 작업은 기록된 시간을 비용으로 씀)
+ * --order=fifo|lpt|sjf: --manifest 실행 순서 (lpt: 예상 시간이 긴 것부터, sjf: 짧은 것부터, 목록을 모두 읽음)
+ * --mem-budget=MB: 실행 중인 작업의 예상 메모리 합이 넘지 않도록 띄움 (들어가는 작업을 먼저)
+ * --history-bench=N: 꼬리가 긴 가짜 작업 N개로 fifo, lpt, sjf의 전체 시간 비교
+ * --perf=EV,EV,...: 자식마다 성능 카운터 수집 (cycles, instructions, cache-refs,
+ *   cache-misses, branches, branch-misses, task-clock, page-faults, ctx-switches)
+ * --work=sleep|spin|alloc|table|syscall|wakeup|write|read: 자식 작업 종류
+ *     (sleep: 대기, spin: CPU 사용, alloc: 메모리 확보, table: 표 준비, syscall: 시스템 콜 반복,
+ *      wakeup: 1ms마다 깨어나며 깨어남 지연 측정, write: 디스크 쓰기, read: 무작위 읽기 지연 측정)
+ * --io-dir=DIR, --io-file-mb=N: write/read 작업의 파일 위치와 write 파일 최대 크기
+ * --work-ms=N: 자식 작업 시간 (밀리초, 기본값 1000)
+ * --mem-mb=N, --mem-backing=normal|thp|hugetlb, --prefault=none|populate|madvise:
+ *   alloc 작업의 버퍼 크기와 확보 방식
+ * --table-entries=N, --snapshot-dir=DIR: table 작업의 크기와 스냅샷 위치
+ *   (같은 --id로 다시 실행하면 스냅샷을 mmap하여 웜 스타트)
+ */
+// 잘못된 옵션 값: 실행해 봐야 멈추거나 엉뚱하게 끝나므로 시작 전에 거부
+static void usage_error(const char* arg, const char* why) {
+  fprintf(stderr, "[parent] invalid %s: %s\n", arg, why);
+  exit(2);
+}
+
+static void parse_args(int argc, char** argv) {
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--child") == 0) {
+      is_child = 1;  // 자식 모드로 설정
+    } else if (strncmp(argv[i], "--id=", 5) == 0) {
+      // "--id=" 다음 문자들을 숫자로 변환
+      child_idx = atoi(argv[i] + 5);
+    } else if (strncmp(argv[i], "--slot=", 7) == 0) {
+      child_slot = atoi(argv[i] + 7);
+    } else if (strncmp(argv[i], "--ready-fd=", 11) == 0) {
+      ready_fd = atoi(argv[i] + 11);
+    } else if (strncmp(argv[i], "--children=", 11) == 0) {
+      num_children = atoi(argv[i] + 11);
+    } else if (strncmp(argv[i], "--exec=", 7) == 0) {
+      exec_path = argv[i] + 7;
+    } else if (strcmp(argv[i], "--parallel") == 0) {
+      parallel = 1;
+    } else if (strcmp(argv[i], "--no-barrier") == 0) {
+      use_barrier = 0;
+    } else if (strncmp(argv[i], "--jobs=", 7) == 0) {
+      jobs = atoi(argv[i] + 7);
+      if (jobs < 1) usage_error(argv[i], "must be at least 1");
+    } else if (strncmp(argv[i], "--fail-every=", 13) == 0) {
+      fail_every = atoi(argv[i] + 13);
+    } else if (strncmp(argv[i], "--crash-every=", 14) == 0) {
+      crash_every = atoi(argv[i] + 14);
+    } else if (strcmp(argv[i], "--fail") == 0) {
+      inject_fail = 1;
+    } else if (strcmp(argv[i], "--crash") == 0) {
+      inject_crash = 1;
+    } else if (strncmp(argv[i], "--compare=", 10) == 0) {
+      compare_n = atoi(argv[i] + 10);
+    } else if (strncmp(argv[i], "--fibers=", 9) == 0) {
+      fibers_n = atoi(argv[i] + 9);
+    } else if (strncmp(argv[i], "--fiber-threads=", 16) == 0) {
+      fiber_threads = atoi(argv[i] + 16);
+    } else if (strncmp(argv[i], "--fiber-stack=", 14) == 0) {
+      long v = atol(argv[i] + 14);
+      if (v < (long)FIBER_STACK_MIN || v > (long)FIBER_STACK_MAX) {
+        usage_error(argv[i], "must be between 1024 and 33554432 bytes");
+      }
+      fiber_stack = (size_t)v;
+    } else if (strncmp(argv[i], "--ns=", 5) == 0) {
+      ns_list = argv[i] + 5;
+    } else if (strncmp(argv[i], "--ns-bench=", 11) == 0) {
+      ns_bench_n = atoi(argv[i] + 11);
+    } else if (strcmp(argv[i], "--seccomp") == 0) {
+      seccomp_opt = 1;
+    } else if (strncmp(argv[i], "--seccomp-bench=", 16) == 0) {
+      seccomp_bench_n = atoi(argv[i] + 16);
+    } else if (strcmp(argv[i], "--mem-report") == 0) {
+      mem_report = 1;
+      parallel = 1;  // 모든 자식이 동시에 떠 있어야 의미가 있음
+    } else if (strncmp(argv[i], "--sched=", 8) == 0) {
+      if (n_sched_specs == (int)(sizeof(sched_specs) / sizeof(sched_specs[0]))) {
+        usage_error(argv[i], "too many --sched rules (at most 8)");
+      }
+      sched_specs[n_sched_specs++] = argv[i] + 8;
+    } else if (strncmp(argv[i], "--ioprio=", 9) == 0) {
+      if (n_ioprio_specs == (int)(sizeof(ioprio_specs) / sizeof(ioprio_specs[0]))) {
+        usage_error(argv[i], "too many --ioprio rules (at most 8)");
+      }
+      ioprio_specs[n_ioprio_specs++] = argv[i] + 9;
+    } else if (strncmp(argv[i], "--io-cgroup=", 12) == 0) {
+      if (n_io_cg_specs == (int)(sizeof(io_cg_specs) / sizeof(io_cg_specs[0]))) {
+        usage_error(argv[i], "too many --io-cgroup rules (at most 8)");
+      }
+      io_cg_specs[n_io_cg_specs++] = argv[i] + 12;
+    } else if (strncmp(argv[i], "--daemon-resume=", 16) == 0) {
+      daemon_resume_fd = atoi(argv[i] + 16);
+    } else if (strncmp(argv[i], "--daemon=", 9) == 0) {
+      daemon_path = argv[i] + 9;
+    } else if (strncmp(argv[i], "--ctl=", 6) == 0) {
+      ctl_path = argv[i] + 6;
+      ctl_argv = argv + i + 1;
+      ctl_argc = argc - i - 1;
+      break;
+    } else if (strncmp(argv[i], "--manifest=", 11) == 0) {
+      manifest_path = argv[i] + 11;
+    } else if (strncmp(argv[i], "--manifest-format=", 18) == 0) {
+      manifest_format = argv[i] + 18;
+    } else if (strcmp(argv[i], "--keep-order") == 0) {
+      keep_order = 1;
+    } else if (strncmp(argv[i], "--keep-order-mem=", 17) == 0) {
+      keep_order_mem = (size_t)atol(argv[i] + 17);
+    } else if (strncmp(argv[i], "--manifest-bench=", 17) == 0) {
+      manifest_bench_n = atoi(argv[i] + 17);
+    } else if (strncmp(argv[i], "--dag=", 6) == 0) {
+      dag_path = argv[i] + 6;
+    } else if (strncmp(argv[i], "--cache=", 8) == 0) {
+      cache_dir = argv[i] + 8;
+    } else if (strncmp(argv[i], "--cache-env=", 12) == 0) {
+      cache_env = argv[i] + 12;
+    } else if (strncmp(argv[i], "--cache-max=", 12) == 0) {
+      cache_max = atoll(argv[i] + 12);
+    } else if (strncmp(argv[i], "--history=", 10) == 0) {
+      history_path = argv[i] + 10;
+    } else if (strncmp(argv[i], "--order=", 8) == 0) {
+      order_name = argv[i] + 8;
+    } else if (strncmp(argv[i], "--mem-budget=", 13) == 0) {
+      mem_budget_mb = atol(argv[i] + 13);
+    } else if (strncmp(argv[i], "--history-bench=", 16) == 0) {
+      history_bench_n = atoi(argv[i] + 16);
+    } else if (strncmp(argv[i], "--fd-hygiene=", 13) == 0) {
+      fd_hygiene_name = argv[i] + 13;
+    } else if (strncmp(argv[i], "--hold-fds=", 11) == 0) {
+      hold_fds_n = atoi(argv[i] + 11);
+    } else if (strncmp(argv[i], "--fd-bench=", 11) == 0) {
+      fd_bench_n = atoi(argv[i] + 11);
+    } else if (strncmp(argv[i], "--io-bench=", 11) == 0) {
+      io_bench_n = atoi(argv[i] + 11);
+    } else if (strncmp(argv[i], "--sample-ms=", 12) == 0) {
+      sample_ms = atoi(argv[i] + 12);
+    } else if (strncmp(argv[i], "--sample-out=", 13) == 0) {
+      sample_out = argv[i] + 13;
+    } else if (strncmp(argv[i], "--timeout-ms=", 13) == 0) {
+      timeout_ms = atoi(argv[i] + 13);
+    } else if (strncmp(argv[i], "--exec-bench=", 13) == 0) {
+      exec_bench_n = atoi(argv[i] + 13);
+    } else if (strcmp(argv[i], "--minimal") == 0) {
+      minimal = 1;
+      forward_arg(argv[i]);
+    } else if (strncmp(argv[i], "--perf=", 7) == 0) {
+      perf_list = argv[i] + 7;
+    } else if (strcmp(argv[i], "--quiet") == 0) {
+      quiet = 1;
+      forward_arg(argv[i]);
+    } else if (strncmp(argv[i], "--shm-fd=", 9) == 0) {
+      shm_fd = atoi(argv[i] + 9);
+    } else if (strncmp(argv[i], "--work=", 7) == 0) {
+      work_name = argv[i] + 7;
+      forward_arg(argv[i]);
+    } else if (strncmp(argv[i], "--work-ms=", 10) == 0) {
+      work_ms = atoi(argv[i] + 10);
+      forward_arg(argv[i]);
+    } else if (strncmp(argv[i], "--mem-mb=", 9) == 0) {
+      mem_mb = atoi(argv[i] + 9);
+      forward_arg(argv[i]);
+    } else if (strncmp(argv[i], "--mem-backing=", 14) == 0) {
+      mem_backing = argv[i] + 14;
+      forward_arg(argv[i]);
+    } else if (strncmp(argv[i], "--prefault=", 11) == 0) {
+      prefault_mode = argv[i] + 11;
+      forward_arg(argv[i]);
+    } else if (strncmp(argv[i], "--table-entries=", 16) == 0) {
+      table_entries = atoi(argv[i] + 16);
+      if (table_entries < 1) usage_error(argv[i], "must be at least 1");
+      forward_arg(argv[i]);
+    } else if (strncmp(argv[i], "--snapshot-dir=", 15) == 0) {
+      snapshot_dir = argv[i] + 15;
+      forward_arg(argv[i]);
+    } else if (strncmp(argv[i], "--io-dir=", 9) == 0) {
+      io_dir = argv[i] + 9;
+      forward_arg(argv[i]);
+    } else if (strncmp(argv[i], "--io-file-mb=", 13) == 0) {
+      io_file_mb = atoi(argv[i] + 13);
+      forward_arg(argv[i]);
+    }
+  }
+  // 모드별로 부모가 덧붙일 몫은 남겨 둠 (실행 중인 데몬이 자식을 만들다 끝나지 않도록)
+  if (n_fwd_args > MAX_FWD_ARGS - FWD_ARGS_RESERVED) {
+    fprintf(stderr, "[parent] too many options to forward to children (%d, at most %d)\n",
+            n_fwd_args, MAX_FWD_ARGS - FWD_ARGS_RESERVED);
+    exit(2);
+  }
+  // 최소 경로는 stdio도 malloc도 쓰지 않는 작업만 돌릴 수 있음
+  if (minimal && strcmp(work_name, "sleep") != 0 && strcmp(work_name, "spin") != 0) {
+    usage_error("--minimal", "only --work=sleep and --work=spin run without stdio");
+  }
+}
+
+#ifndef _WIN32
+/*
+ * 단조 증가 시계(CLOCK_MONOTONIC)로 현재 시각을 마이크로초 단위로 반환
+ *
+ * CLOCK_MONOTONIC은 시스템 전체에서 공유되므로
+ * 부모와 자식이 각각 잰 시각을 서로 비교할 수 있습니다.
+ */
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/*
+ * 지연 시간 분포 (로그 스케일 히스토그램)
+ *
+ * 샘플을 모두 저장하지 않고 버킷에 개수만 누적합니다.
+ * 나노초 값의 최상위 비트 위치(2의 거듭제곱 구간)를 다시 4등분하므로
+ * 백분위수 추정 오차는 약 ±12% 이내이고, 메모리는 샘플 수와 무관하게 일정합니다.
+ */
+#define HIST_BUCKETS 256
+
+struct lat_hist {
+  unsigned long count;
+  double min_us, max_us, sum_us;
+  unsigned long buckets[HIST_BUCKETS];
+};
+
+static int hist_bucket(unsigned long long ns) {
+  if (ns < 4) return (int)ns;
+  int e = 63 - __builtin_clzll(ns);          // 최상위 비트 위치
+  return e * 4 + (int)((ns >> (e - 2)) & 3); // 그 아래 2비트로 4등분
+}
+
+static double hist_bucket_mid_us(int b) {
+  if (b < 4) return b / 1e3;
+  int e = b / 4, s = b % 4;
+  double lo = (double)((4ULL + s) << (e - 2));
+  double hi = (double)((5ULL + s) << (e - 2));
+  return (lo + hi) / 2 / 1e3;
+}
+
+static void hist_add(struct lat_hist* h, double us) {
+  if (us < 0) us = 0;
+  if (h->count == 0 || us < h->min_us) h->min_us = us;
+  if (h->count == 0 || us > h->max_us) h->max_us = us;
+  h->count++;
+  h->sum_us += us;
+  h->buckets[hist_bucket((unsigned long long)(us * 1e3))]++;
+}
+
+// p(0~100) 백분위수에 해당하는 값을 버킷 중앙값으로 추정
+static double hist_pct(const struct lat_hist* h, double p) {
+  if (h->count == 0) return 0;
+  unsigned long rank = (unsigned long)(p / 100.0 * (h->count - 1)) + 1;
+  unsigned long seen = 0;
+  for (int b = 0; b < HIST_BUCKETS; ++b) {
+    seen += h->buckets[b];
+    if (seen >= rank) {
+      double v = hist_bucket_mid_us(b);
+      if (v < h->min_us) v = h->min_us;
+      if (v > h->max_us) v = h->max_us;
+      return v;
+    }
+  }
+  return h->max_us;
+}
+
+// 다른 히스토그램(예: 스레드별)을 하나로 합침
+static void hist_merge(struct lat_hist* dst, const struct lat_hist* src) {
+  if (src->count == 0) return;
+  if (dst->count == 0 || src->min_us < dst->min_us) dst->min_us = src->min_us;
+  if (dst->count == 0 || src->max_us > dst->max_us) dst->max_us = src->max_us;
+  dst->count += src->count;
+  dst->sum_us += src->sum_us;
+  for (int b = 0; b < HIST_BUCKETS; ++b) dst->buckets[b] += src->buckets[b];
+}
+
+static void hist_print(const char* name, const struct lat_hist* h) {
+  if (h->count == 0) {
+    printf("  %-8s (no samples)\n", name);
+    return;
+  }
+  printf("  %-8s n=%-6lu min=%9.1f p50=%9.1f p90=%9.1f p99=%9.1f max=%9.1f avg=%9.1f us\n",
+         name, h->count, h->min_us, hist_pct(h, 50), hist_pct(h, 90),
+         hist_pct(h, 99), h->max_us, h->sum_us / h->count);
+}
+
+/*
+ * 자식 준비 완료 알림
+ *
+ * 부모가 --ready-fd로 넘겨준 파이프에 1바이트를 쓰고 닫습니다.
+ * 부모는 이 바이트를 받은 시점을 "자식이 실제로 작업을 시작한 시점"으로 봅니다.
+ */
+static void signal_ready(void) {
+  if (ready_fd < 0) return;
+  char c = 'R';
+  ssize_t n;
+  do {
+    n = write(ready_fd, &c, 1);
+  } while (n < 0 && errno == EINTR);
+  close(ready_fd);
+  ready_fd = -1;
+}
+
+/*
+ * 시작 배리어와 타임스탬프용 공유 메모리
+ *
+ * 자식은 exec 후 주소 공간이 통째로 바뀌므로 fork 전에 만든 익명 공유 메모리
+ * (MAP_SHARED | MAP_ANONYMOUS)는 사라집니다. 그래서 memfd(이름 없는 메모리 파일)를
+ * 만들고 fd를 --shm-fd로 넘겨, 자식이 exec 후 다시 mmap하도록 합니다.
+ *
+ * go 변수는 futex로 사용됩니다:
+ * - 자식: go == 0인 동안 FUTEX_WAIT로 잠듦 (바쁜 대기 없음)
+ * - 부모: 모든 자식이 준비되면 go = 1로 바꾸고 FUTEX_WAKE로 한꺼번에 깨움
+ * FUTEX_PRIVATE_FLAG를 쓰지 않아야 서로 다른 프로세스 사이에서 동작합니다.
+ */
+#define SLOT_METRICS 4
+
+struct shm_slot {
+  double t_ready;   // 자식이 시작을 알린 시각 (배리어 도착)
+  double t_start;   // 자식이 작업을 시작한 시각 (배리어 통과 직후)
+  double t_end;     // 자식이 작업을 끝낸 시각
+  double metric[SLOT_METRICS];  // 작업별 측정값 (payloads[] 표 참고)
+  double cpu_us;    // 자식이 끝날 때까지 쓴 CPU 시간
+};
+
+struct shm_area {
+  unsigned int go;        // 0: 대기, 1: 출발 (futex 변수)
+  unsigned int nslots;    // 슬롯 개수 (= 자식 수, 풀 모드는 --jobs)
+  unsigned int nready;    // 배리어에 도착한 자식 수 (futex 변수)
+  unsigned int pad;
+  struct shm_slot slot[]; // 자식 #i는 slot[i - 1] 사용 (풀 모드는 칸 번호로 다시 씀)
+};
+
+static struct shm_area* shm = NULL;
+
+static size_t shm_size(int nslots) {
+  return sizeof(struct shm_area) + (size_t)nslots * sizeof(struct shm_slot);
+}
+
+static long futex(unsigned int* uaddr, int op, unsigned int val) {
+  return syscall(SYS_futex, uaddr, op, val, NULL, NULL, 0);
+}
+
+// 자식: 부모가 출발 신호를 줄 때까지 대기
+static void barrier_wait(void) {
+  if (shm == NULL) return;
+  while (__atomic_load_n(&shm->go, __ATOMIC_ACQUIRE) == 0) {
+    // go가 여전히 0일 때만 잠듦 (그 사이 바뀌었으면 EAGAIN으로 즉시 반환)
+    futex(&shm->go, FUTEX_WAIT, 0);
+  }
+}
+
+// 부모: 대기 중인 모든 자식을 동시에 출발시킴
+static void barrier_release(void) {
+  __atomic_store_n(&shm->go, 1, __ATOMIC_RELEASE);
+  futex(&shm->go, FUTEX_WAKE, INT_MAX);
+}
+
+// 자식: --shm-fd로 받은 공유 메모리를 다시 매핑
+static void shm_attach(void) {
+  if (shm_fd < 0) return;
+  struct stat st;
+  void* p = MAP_FAILED;
+  if (fstat(shm_fd, &st) == 0 && (size_t)st.st_size >= sizeof(struct shm_area)) {
+    p = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+  }
+  close(shm_fd);
+  shm_fd = -1;
+  if (p == MAP_FAILED) return;
+  shm = p;
+  if (child_slot == 0) child_slot = child_idx;
+  if (child_slot < 1 || (unsigned int)child_slot > shm->nslots ||
+      shm_size((int)shm->nslots) > (size_t)st.st_size) {
+    munmap(p, (size_t)st.st_size);
+    shm = NULL;
+  }
+}
+
+/*
+ * 자식 작업(payload)들
+ *
+ * sleep: 지정한 시간만큼 잠듦 (원래 예제의 sleep(1)과 같은 동작)
+ * spin:  지정한 CPU 시간만큼 계산을 계속함 (병렬 확장성 측정용)
+ * alloc: 큰 버퍼를 확보하고 페이지 폴트 비용을 측정
+ * table: 큰 조회 테이블을 만들거나 스냅샷에서 붙인 뒤 조회를 반복
+ *
+ * 각 작업은 최대 4개의 측정값(m[0..3])을 남길 수 있고, 공유 메모리 슬롯을 통해
+ * 부모에게 전달되어 자식 전체에 대한 요약으로 출력됩니다.
+ * 작업의 시스템 콜이 실패하면(예: seccomp가 막음) -1을 돌려주고, 자식은 실패로 끝납니다.
+ */
+static int work_sleep(int ms, double* m) {
+  (void)m;
+  struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+  while (nanosleep(&ts, &ts) < 0 && errno == EINTR) {}
+  return 0;
+}
+
+static void work_sleep_ms(int ms) {
+  work_sleep(ms, NULL);
+}
+
+// 벽시계가 아니라 이 프로세스가 실제로 쓴 CPU 시간 기준 (CPU가 부족하면 더 오래 걸림)
+static double cpu_time_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int work_spin(int ms, double* m) {
+  (void)m;
+  double end = cpu_time_us() + ms * 1e3;
+  volatile unsigned long x = 0;
+  while (cpu_time_us() < end) {
+    for (int k = 0; k < 1000; ++k) x = x * 6364136223846793005UL + 1;
+  }
+  return 0;
+}
+
+/*
+ * syscall: 가장 가벼운 시스템 콜(getppid)을 반복 호출
+ *
+ * 호출 하나하나가 커널 진입/복귀 비용만 내므로, seccomp 필터가
+ * 시스템 콜마다 더하는 비용을 재기에 알맞습니다.
+ * (glibc 래퍼가 값을 캐시하지 않도록 syscall()로 직접 호출)
+ */
+static int work_syscall(int ms, double* m) {
+  double t0 = now_us();
+  double end = t0 + ms * 1e3;
+  unsigned long calls = 0;
+  do {
+    for (int k = 0; k < 1000; ++k) syscall(SYS_getppid);
+    calls += 1000;
+  } while (now_us() < end);
+  m[0] = (now_us() - t0) * 1e3 / calls;
+  m[1] = (double)calls;
+  return 0;
+}
+
+/*
+ * wakeup: 1ms마다 깨어나서 "예정 시각보다 얼마나 늦게 깨어났나"를 잼
+ *
+ * 지연 시간에 민감한 작업(요청 처리, 오디오 등)을 흉내 냅니다.
+ * 같은 CPU에서 spin 자식들이 돌고 있으면, 스케줄링 정책에 따라
+ * 깨어난 뒤 CPU를 받기까지의 지연이 크게 달라집니다.
+ */
+#define WAKEUP_PERIOD_US 1000
+
+static int work_wakeup(int ms, double* m) {
+  struct lat_hist h;
+  memset(&h, 0, sizeof(h));
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  double end = now_us() + ms * 1e3;
+  while (now_us() < end) {
+    next.tv_nsec += WAKEUP_PERIOD_US * 1000L;
+    if (next.tv_nsec >= 1000000000L) {
+      next.tv_nsec -= 1000000000L;
+      next.tv_sec++;
+    }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) {}
+    hist_add(&h, now_us() - (next.tv_sec * 1e6 + next.tv_nsec / 1e3));
+  }
+  m[0] = hist_pct(&h, 50);
+  m[1] = hist_pct(&h, 99);
+  m[2] = h.max_us;
+  m[3] = (double)h.count;
+  return 0;
+}
+
+/*
+ * alloc: 큰 작업 버퍼를 확보하고 모든 페이지를 한 번씩 써 봄
+ *
+ * 수명이 짧은 자식에게는 페이지 폴트 비용이 작업 시간보다 클 수 있습니다.
+ * 버퍼를 어떤 방식으로 확보하느냐에 따라 이 비용이 크게 달라집니다.
+ *
+ * --mem-backing=normal  : 일반 4KB 페이지 (첫 접근마다 페이지 폴트)
+ * --mem-backing=thp     : 2MB 정렬 후 madvise(MADV_HUGEPAGE) → 투명 대형 페이지(THP)
+ * --mem-backing=hugetlb : MAP_HUGETLB (미리 예약된 hugetlbfs 페이지 필요,
+ *                         /proc/sys/vm/nr_hugepages가 0이면 일반 페이지로 대체)
+ *
+ * --prefault=none       : 접근할 때 폴트 발생 (기본값)
+ * --prefault=populate   : mmap(MAP_POPULATE)로 매핑 시점에 미리 채움
+ * --prefault=madvise    : madvise(MADV_POPULATE_WRITE)로 미리 채움 (Linux 5.14+)
+ *
+ * 측정값: 확보 시간, 첫 바이트 접근 시간, 전체 접근 시간, 마이너 폴트 수
+ */
+#ifndef MADV_POPULATE_WRITE
+  #define MADV_POPULATE_WRITE 23
+#endif
+#define HUGE_2MB (2UL * 1024 * 1024)
+
+// 이 프로세스의 누적 (마이너, 메이저) 페이지 폴트 수
+static void fault_counts(long* minflt, long* majflt) {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  *minflt = ru.ru_minflt;
+  *majflt = ru.ru_majflt;
+}
+
+// /proc/self/smaps_rollup에서 "Key:" 항목 값(kB)을 읽음 (없으면 -1)
+static long smaps_rollup_kb(pid_t pid, const char* key) {
+  char path[64], line[256];
+  if (pid > 0) snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", (int)pid);
+  else snprintf(path, sizeof(path), "/proc/self/smaps_rollup");
+  FILE* f = fopen(path, "r");
+  if (f == NULL) return -1;
+  long kb = -1;
+  size_t klen = strlen(key);
+  while (fgets(line, sizeof(line), f)) {
+    if (strncmp(line, key, klen) == 0 && line[klen] == ':') {
+      kb = atol(line + klen + 1);
+      break;
+    }
+  }
+  fclose(f);
+  return kb;
+}
+
+// USS: 이 프로세스만 쓰는 페이지 (Private_Clean + Private_Dirty)
+static long uss_kb_of(pid_t pid) {
+  long clean = smaps_rollup_kb(pid, "Private_Clean");
+  long dirty = smaps_rollup_kb(pid, "Private_Dirty");
+  return (clean < 0 || dirty < 0) ? -1 : clean + dirty;
+}
+
+static void* alloc_buffer(size_t size, size_t* mapped) {
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  if (strcmp(prefault_mode, "populate") == 0) flags |= MAP_POPULATE;
+
+  if (strcmp(mem_backing, "hugetlb") == 0) {
+    size_t len = (size + HUGE_2MB - 1) & ~(HUGE_2MB - 1);
+    void* p = mmap(NULL, len, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+      *mapped = len;
+      return p;
+    }
+    fprintf(stderr, "[child #%d] MAP_HUGETLB failed (%s), falling back to normal pages\n",
+            child_idx, strerror(errno));
+  }
+
+  if (strcmp(mem_backing, "thp") == 0) {
+    // 대형 페이지가 들어가려면 가상 주소가 2MB 경계에 맞아야 하므로 여유 있게 잡고 정렬
+    size_t len = size + HUGE_2MB;
+    char* raw = mmap(NULL, len, PROT_READ | PROT_WRITE, flags & ~MAP_POPULATE, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+    char* p = (char*)(((unsigned long)raw + HUGE_2MB - 1) & ~(HUGE_2MB - 1));
+    if (p > raw) munmap(raw, (size_t)(p - raw));
+    munmap(p + size, (size_t)(raw + len - (p + size)));
+    if (madvise(p, size, MADV_HUGEPAGE) < 0) {
+      fprintf(stderr, "[child #%d] madvise(MADV_HUGEPAGE) failed: %s\n", child_idx, strerror(errno));
+    }
+    // MAP_POPULATE는 madvise 전에 채워 버리므로 THP에서는 직접 채움
+    if (flags & MAP_POPULATE) madvise(p, size, MADV_POPULATE_WRITE);
+    *mapped = size;
+    return p;
+  }
+
+  void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (p == MAP_FAILED) return NULL;
+  *mapped = size;
+  return p;
+}
+
+static int work_alloc(int ms, double* m) {
+  size_t size = (size_t)mem_mb * 1024 * 1024;
+  size_t mapped = 0;
+  long min0, maj0, min1, maj1;
+  long page = sysconf(_SC_PAGESIZE);
+
+  fault_counts(&min0, &maj0);
+
+  // 1. 확보 (+ 선택적으로 미리 채우기)
+  double t0 = now_us();
+  char* buf = alloc_buffer(size, &mapped);
+  if (buf == NULL) {
+    fprintf(stderr, "[child #%d] buffer allocation failed: %s\n", child_idx, strerror(errno));
+    return -1;
+  }
+  if (strcmp(prefault_mode, "madvise") == 0 && madvise(buf, size, MADV_POPULATE_WRITE) < 0) {
+    fprintf(stderr, "[child #%d] madvise(MADV_POPULATE_WRITE) failed: %s\n",
+            child_idx, strerror(errno));
+  }
+  double t1 = now_us();
+
+  // 2. 첫 바이트 접근 (폴트가 나면 여기서 페이지 하나(또는 2MB)를 0으로 채움)
+  buf[0] = 1;
+  double t2 = now_us();
+
+  // 3. 모든 페이지 접근
+  for (size_t off = 0; off < size; off += (size_t)page) buf[off] = 1;
+  double t3 = now_us();
+
+  fault_counts(&min1, &maj1);
+  long thp_kb = smaps_rollup_kb(0, "AnonHugePages");
+
+  m[0] = t1 - t0;
+  m[1] = t2 - t1;
+  m[2] = t3 - t2;
+  m[3] = (double)(min1 - min0);
+  if (!quiet) printf("[child #%d] alloc %dMB backing=%s prefault=%s: setup %.1f us, first touch %.1f us, "
+         "touch all %.1f us, minflt %ld, majflt %ld, AnonHugePages %ld kB\n",
+         child_idx, mem_mb, mem_backing, prefault_mode, m[0], m[1], m[2],
+         min1 - min0, maj1 - maj0, thp_kb);
+
+  // 남은 작업 시간은 버퍼를 쥔 채로 대기 (상주 메모리 관찰용)
+  work_sleep_ms(ms);
+  munmap(buf, mapped);
+  return 0;
+}
+
+/*
+ * table: 큰 조회 테이블을 만들고 조회를 반복하는 작업 (+ 스냅샷으로 웜 재시작)
+ *
+ * 테이블 만들기는 비싼 계산이므로, --snapshot-dir=DIR을 주면 종료할 때
+ * 테이블을 DIR/proc_demo-<id>.snap 파일로 저장합니다. 같은 --id로 다시 실행된
+ * 자식은 계산 대신 이 파일을 mmap(MAP_PRIVATE)으로 붙여 씁니다.
+ *
+ * 파일은 포인터 없이 "파일 처음부터의 오프셋"으로만 구성되어 있어서
+ * 어느 주소에 매핑되든 그대로 쓸 수 있습니다:
+ *
+ *   [snap_header][keys: u64 × slots][vals: u64 × slots]
+ *
+ * MAP_PRIVATE 매핑은 읽기만 하면 페이지 캐시를 공유하고, 쓰면 그 페이지만
+ * 복사(COW)되므로 여러 자식이 같은 스냅샷을 붙여도 메모리가 늘지 않습니다.
+ */
+#define SNAP_MAGIC   "PDSNAP1"
+#define SNAP_VERSION 1
+
+struct snap_header {
+  char magic[8];            // "PDSNAP1\0"
+  unsigned int version;     // 형식 버전
+  unsigned int child_id;    // 이 스냅샷을 만든 자식의 --id
+  unsigned long file_size;  // 파일 전체 크기 (잘린 파일 감지용)
+  unsigned long entries;    // 저장된 항목 수 (--table-entries)
+  unsigned long slots;      // 해시 테이블 슬롯 수 (2의 거듭제곱)
+  unsigned long keys_off;   // 키 배열 오프셋
+  unsigned long vals_off;   // 값 배열 오프셋
+};
+
+// 항목 하나를 만드는 비싼 계산 (splitmix64를 여러 번 반복)
+static unsigned long table_value(unsigned long key) {
+  unsigned long z = key;
+  for (int r = 0; r < 64; ++r) {
+    z += 0x9e3779b97f4a7c15UL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9UL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebUL;
+    z ^= z >> 31;
+  }
+  return z;
+}
+
+static unsigned long table_hash(unsigned long key) {
+  return (key * 0x9e3779b97f4a7c15UL) >> 7;
+}
+
+#define TABLE_KEYS(h)  ((unsigned long*)((char*)(h) + (h)->keys_off))
+#define TABLE_VALS(h)  ((unsigned long*)((char*)(h) + (h)->vals_off))
+
+// 열린 주소법(선형 탐사) 조회, 키 0은 빈 슬롯을 뜻함 (빈 슬롯이 없는 파일이어도 한 바퀴에서 멈춤)
+static int table_lookup(const struct snap_header* h, unsigned long key, unsigned long* val) {
+  const unsigned long* keys = TABLE_KEYS(h);
+  unsigned long mask = h->slots - 1;
+  unsigned long s = table_hash(key) & mask;
+  for (unsigned long probe = 0; probe <= mask; ++probe, s = (s + 1) & mask) {
+    if (keys[s] == key) {
+      *val = TABLE_VALS(h)[s];
+      return 1;
+    }
+    if (keys[s] == 0) return 0;
+  }
+  return 0;
+}
+
+// 파일 안의 배열 하나 (off부터 slots개)가 size 안에 들어가고 정렬되어 있는지
+static int snapshot_array_ok(unsigned long off, unsigned long slots, size_t size) {
+  return off >= sizeof(struct snap_header) && off % sizeof(unsigned long) == 0 && off <= size &&
+         slots <= (size - off) / sizeof(unsigned long);
+}
+
+static void snapshot_path(char* out, size_t len) {
+  snprintf(out, len, "%s/proc_demo-%d.snap", snapshot_dir, child_idx);
+}
+
+// 스냅샷을 붙여 봄. 형식이나 크기가 맞지 않으면 NULL (콜드 스타트)
+static struct snap_header* snapshot_map(size_t* size) {
+  char path[512];
+  snapshot_path(path, sizeof(path));
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return NULL;
+
+  struct stat st;
+  struct snap_header* h = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(*h)) {
+    h = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);  // 매핑은 fd를 닫아도 유지됨
+  if (h == MAP_FAILED) return NULL;
+
+  // 손상되었거나 조작된 파일로 매핑 밖을 읽지 않도록 배치를 모두 확인
+  // (슬롯 수는 2의 거듭제곱, 빈 슬롯이 남도록 항목 수 < 슬롯 수, 두 배열 모두 파일 안)
+  size_t fsize = (size_t)st.st_size;
+  if (memcmp(h->magic, SNAP_MAGIC, 8) != 0 || h->version != SNAP_VERSION ||
+      h->child_id != (unsigned int)child_idx || h->file_size != (unsigned long)fsize ||
+      h->entries != (unsigned long)table_entries ||
+      h->slots == 0 || (h->slots & (h->slots - 1)) != 0 || h->entries >= h->slots ||
+      !snapshot_array_ok(h->keys_off, h->slots, fsize) ||
+      !snapshot_array_ok(h->vals_off, h->slots, fsize)) {
+    fprintf(stderr, "[child #%d] snapshot %s is stale or corrupt, rebuilding\n", child_idx, path);
+    munmap(h, (size_t)st.st_size);
+    return NULL;
+  }
+  *size = (size_t)st.st_size;
+  return h;
+}
+
+// 파일 배치 그대로 메모리에 테이블을 만듦 (그래야 한 번의 write로 저장 가능)
+static struct snap_header* table_build(size_t* size) {
+  unsigned long slots = 1;
+  while (slots < (unsigned long)table_entries * 2) slots <<= 1;  // 적재율 50% 이하
+  size_t bytes = sizeof(struct snap_header) + 2 * slots * sizeof(unsigned long);
+
+  struct snap_header* h = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (h == MAP_FAILED) return NULL;
+  memcpy(h->magic, SNAP_MAGIC, 8);
+  h->version = SNAP_VERSION;
+  h->child_id = (unsigned int)child_idx;
+  h->file_size = bytes;
+  h->entries = (unsigned long)table_entries;
+  h->slots = slots;
+  h->keys_off = sizeof(struct snap_header);
+  h->vals_off = h->keys_off + slots * sizeof(unsigned long);
+
+  unsigned long* keys = TABLE_KEYS(h);
+  unsigned long* vals = TABLE_VALS(h);
+  for (unsigned long i = 1; i <= h->entries; ++i) {
+    unsigned long key = i * 2654435761UL;
+    unsigned long s = table_hash(key) & (slots - 1);
+    while (keys[s] != 0) s = (s + 1) & (slots - 1);
+    keys[s] = key;
+    vals[s] = table_value(key);
+  }
+  *size = bytes;
+  return h;
+}
+
+// 임시 파일에 쓰고 rename하여, 중간에 죽어도 반쯤 쓰인 스냅샷이 남지 않게 함
+static int snapshot_save(const struct snap_header* h, size_t size) {
+  char path[512], tmp[520];
+  snapshot_path(path, sizeof(path));
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return -1;
+  const char* p = (const char*)h;
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = write(fd, p + done, size - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    done += (size_t)n;
+  }
+  close(fd);
+  if (done != size || rename(tmp, path) < 0) {
+    unlink(tmp);
+    return -1;
+  }
+  return 0;
+}
+
+static int work_table(int ms, double* m) {
+  size_t size = 0;
+  int warm = 0;
+
+  // 1. 스냅샷이 있으면 붙이고, 없으면 계산해서 만듦
+  double t0 = now_us();
+  struct snap_header* h = snapshot_dir ? snapshot_map(&size) : NULL;
+  if (h) {
+    warm = 1;
+  } else {
+    h = table_build(&size);
+  }
+  double t1 = now_us();
+  if (h == NULL) {
+    fprintf(stderr, "[child #%d] table allocation failed: %s\n", child_idx, strerror(errno));
+    return -1;
+  }
+
+  // 2. 작업 시간 동안 조회 반복 (1024번에 한 번은 값을 다시 계산해 맞는지 확인)
+  unsigned long lookups = 0, bad = 0, val;
+  double end = now_us() + ms * 1e3;
+  do {
+    for (int k = 0; k < 1024; ++k) {
+      unsigned long key = (lookups % h->entries + 1) * 2654435761UL;
+      if (!table_lookup(h, key, &val) || (k == 0 && val != table_value(key))) bad++;
+      lookups++;
+    }
+  } while (now_us() < end);
+
+  // 3. 콜드 스타트였다면 다음 실행을 위해 스냅샷 저장
+  double t2 = now_us();
+  if (snapshot_dir && !warm && snapshot_save(h, size) < 0) {
+    fprintf(stderr, "[child #%d] snapshot save failed: %s\n", child_idx, strerror(errno));
+  }
+  double t3 = now_us();
+
+  m[0] = t1 - t0;
+  m[1] = warm;
+  m[2] = t3 - t2;
+  m[3] = (double)size / 1024;
+  if (!quiet) printf("[child #%d] table %s start: %lu entries (%zu kB) ready in %.1f us, "
+         "%lu lookups (%lu bad), snapshot save %.1f us\n",
+         child_idx, warm ? "warm" : "cold", h->entries, size / 1024, m[0],
+         lookups, bad, m[2]);
+  munmap(h, size);
+  return 0;
+}
+
+/*
+ * write / read: 디스크 I/O 작업 (--io-dir=DIR 아래에 파일을 만듦)
+ *
+ * write: 일괄 작업 흉내. 1MB씩 계속 쓰고 16MB마다 fsync로 디스크까지 밀어 넣음
+ *        (파일은 --io-file-mb에 닿으면 처음부터 다시 씀)
+ * read : 지연에 민감한 작업 흉내. 공용 읽기 파일에서 4KB를 무작위로 읽고 1ms 쉼.
+ *        페이지 캐시를 건너뛰도록 O_DIRECT로 열어 실제 장치 지연을 잼
+ *        (O_DIRECT를 지원하지 않는 파일 시스템이면 일반 읽기로 대신함)
+ */
+#define IO_CHUNK (1024 * 1024)
+#define IO_SYNC_EVERY (16 * IO_CHUNK)
+#define IO_READ_FILE_MB 64
+#define IO_READ_BLOCK 4096
+
+static void io_path(char* out, size_t len, const char* name) {
+  snprintf(out, len, "%s/proc_demo-io-%s.dat", io_dir, name);
+}
+
+static int work_write(int ms, double* m) {
+  char path[PATH_MAX], name[16];
+  snprintf(name, sizeof(name), "w%d", child_idx);
+  io_path(path, sizeof(path), name);
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  char* buf = malloc(IO_CHUNK);
+  if (fd < 0 || buf == NULL) {
+    fprintf(stderr, "[child #%d] write: cannot open %s: %s\n", child_idx, path, strerror(errno));
+    if (fd >= 0) close(fd);
+    free(buf);
+    return -1;
+  }
+  memset(buf, 'w', IO_CHUNK);
+
+  double t0 = now_us(), end = t0 + ms * 1e3, sync_max = 0;
+  unsigned long long total = 0, since_sync = 0, off = 0, limit = (unsigned long long)io_file_mb << 20;
+  int rc = 0;
+  while (now_us() < end) {
+    if (pwrite(fd, buf, IO_CHUNK, (off_t)off) != IO_CHUNK) {
+      fprintf(stderr, "[child #%d] write: pwrite failed: %s\n", child_idx, strerror(errno));
+      rc = -1;
+      break;
+    }
+    total += IO_CHUNK;
+    since_sync += IO_CHUNK;
+    off = off + IO_CHUNK >= limit ? 0 : off + IO_CHUNK;
+    if (since_sync >= IO_SYNC_EVERY) {
+      double s0 = now_us();
+      if (fsync(fd) < 0) {
+        fprintf(stderr, "[child #%d] write: fsync failed: %s\n", child_idx, strerror(errno));
+        rc = -1;
+        break;
+      }
+      if (now_us() - s0 > sync_max) sync_max = now_us() - s0;
+      since_sync = 0;
+    }
+  }
+  double secs = (now_us() - t0) / 1e6;
+  close(fd);
+  unlink(path);
+  free(buf);
+  m[0] = total / 1048576.0;
+  m[1] = secs > 0 ? m[0] / secs : 0;
+  m[2] = sync_max / 1e3;
+  return rc;
+}
+
+// 읽기 파일이 없으면 만듦 (여러 자식이 동시에 만들어도 rename으로 하나만 남음)
+static int io_open_read_file(int flags) {
+  char path[PATH_MAX];
+  io_path(path, sizeof(path), "read");
+  int fd = open(path, O_RDONLY | O_CLOEXEC | flags);
+  if (fd >= 0 || errno != ENOENT) return fd;
+
+  char tmp[PATH_MAX + 32];
+  snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+  int wfd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  char* buf = malloc(IO_CHUNK);
+  if (wfd < 0 || buf == NULL) {
+    if (wfd >= 0) close(wfd);
+    free(buf);
+    return -1;
+  }
+  memset(buf, 'r', IO_CHUNK);
+  for (int k = 0; k < IO_READ_FILE_MB; ++k) {
+    if (write(wfd, buf, IO_CHUNK) != IO_CHUNK) break;
+  }
+  fsync(wfd);
+  close(wfd);
+  free(buf);
+  rename(tmp, path);
+  return open(path, O_RDONLY | O_CLOEXEC | flags);
+}
+
+static int work_read(int ms, double* m) {
+  int fd = io_open_read_file(O_DIRECT);
+  if (fd < 0 && errno == EINVAL) {
+    fprintf(stderr, "[child #%d] read: O_DIRECT not supported in %s, using page cache\n",
+            child_idx, io_dir);
+    fd = io_open_read_file(0);
+  }
+  void* buf = NULL;
+  if (fd < 0 || posix_memalign(&buf, IO_READ_BLOCK, IO_READ_BLOCK) != 0) {
+    fprintf(stderr, "[child #%d] read: cannot open read file in %s\n", child_idx, io_dir);
+    if (fd >= 0) close(fd);
+    return -1;
+  }
+
+  struct lat_hist h;
+  memset(&h, 0, sizeof(h));
+  unsigned long long nblocks = (unsigned long long)IO_READ_FILE_MB * (IO_CHUNK / IO_READ_BLOCK);
+  unsigned long long x = (unsigned long long)child_idx * 0x9E3779B97F4A7C15ULL + 1;
+  double end = now_us() + ms * 1e3;
+  int rc = 0;
+  while (now_us() < end) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    off_t off = (off_t)((x >> 16) % nblocks) * IO_READ_BLOCK;
+    double r0 = now_us();
+    if (pread(fd, buf, IO_READ_BLOCK, off) != IO_READ_BLOCK) {
+      fprintf(stderr, "[child #%d] read: pread failed: %s\n", child_idx, strerror(errno));
+      rc = -1;
+      break;
+    }
+    hist_add(&h, now_us() - r0);
+    work_sleep_ms(1);
+  }
+  close(fd);
+  free(buf);
+  m[0] = hist_pct(&h, 50);
+  m[1] = hist_pct(&h, 99);
+  m[2] = h.max_us;
+  m[3] = (double)h.count;
+  return rc;
+}
+
+// 작업 이름 → 함수, 측정값 이름 (측정값이 없으면 NULL)
+struct payload {
+  const char* name;
+  int (*fn)(int ms, double* m);  // 실패하면 -1
+  const char* metric[SLOT_METRICS];
+};
+
+static const struct payload payloads[] = {
+  { "sleep", work_sleep, { NULL } },
+  { "spin",  work_spin,  { NULL } },
+  { "alloc", work_alloc, { "setup us", "first-touch us", "touch-all us", "minor faults" } },
+  { "table", work_table, { "prepare us", "warm (0/1)", "save us", "table kB" } },
+  { "syscall", work_syscall, { "ns/syscall", "syscalls" } },
+  { "wakeup", work_wakeup, { "wake p50 us", "wake p99 us", "wake max us", "wakeups" } },
+  { "write",  work_write,  { "MB written", "MB/s", "fsync max ms" } },
+  { "read",   work_read,   { "read p50 us", "read p99 us", "read max us", "reads" } },
+};
+
+static const struct payload* find_payload(const char* name) {
+  for (size_t k = 0; k < sizeof(payloads) / sizeof(payloads[0]); ++k) {
+    if (strcmp(payloads[k].name, name) == 0) return &payloads[k];
+  }
+  return NULL;
+}
+
+static int run_payload(double* m) {
+  const struct payload* pl = find_payload(work_name);
+  if (pl == NULL) {
+    fprintf(stderr, "[child #%d] unknown --work=%s\n", child_idx, work_name);
+    return -1;
+  }
+  return pl->fn(work_ms, m);
+}
+
+/*
+ * 최소 자식 (--minimal)
+ *
+ * 보통의 자식은 printf를 쓰는 순간 stdout 버퍼(4KB)와 malloc 힙이 생기고,
+ * 그만큼 자식마다 따로 쓰는(USS) 페이지가 늘어납니다.
+ * 이 경로는 stdio를 전혀 쓰지 않고 write()로만 출력하므로 libc의 버퍼와 힙을
+ * 건드리지 않습니다. (정적 링크해도 stdio 코드가 따라 들어오지 않는 경로)
+ * 부모는 exec 전에 RLIMIT_STACK도 작게 줄여, 자식 스택이 커질 여지를 막습니다.
+ * 작업은 sleep과 spin만 (나머지는 stdio나 malloc을 쓰므로 parse_args()에서 거부),
+ * --crash, --fail은 보통 자식과 똑같이 따릅니다.
+ */
+#define MINIMAL_STACK (128 * 1024)  // 최소 자식의 RLIMIT_STACK
+
+static void write_str(const char* s) {
+  size_t len = strlen(s);
+  while (len > 0) {
+    ssize_t n = write(STDOUT_FILENO, s, len);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return;
+    s += n;
+    len -= (size_t)n;
+  }
+}
+
+static void child_work_minimal(void) {
+  char line[128];
+  shm_attach();
+  if (shm) {
+    shm->slot[child_slot - 1].t_ready = now_us();
+    __atomic_add_fetch(&shm->nready, 1, __ATOMIC_RELEASE);
+  }
+  signal_ready();
+  barrier_wait();
+  double t_start = now_us();
+  if (!quiet) {
+    snprintf(line, sizeof(line), "[child #%d] pid=%d (minimal): working for %dms (%s)...\n",
+             child_idx, (int)getpid(), work_ms, work_name);
+    write_str(line);
+  }
+  if (shm) shm->slot[child_slot - 1].t_start = t_start;
+  if (strcmp(work_name, "spin") == 0) work_spin(work_ms, NULL);
+  else work_sleep_ms(work_ms);
+  if (shm) {
+    shm->slot[child_slot - 1].t_end = now_us();
+    shm->slot[child_slot - 1].cpu_us = cpu_time_us();
+  }
+  if (inject_crash) {
+    signal(SIGSEGV, SIG_DFL);
+    raise(SIGSEGV);
+  }
+  _exit(inject_fail ? (child_idx ^ 0x80) : child_idx);
+}
+#endif
+
+/*
+ * 자식 프로세스가 수행할 작업
+ * 
+ * 이 함수는 자식 프로세스로 실행될 때만 호출됩니다.
+ * 자신의 PID를 출력하고, 1초간 대기한 후 종료합니다.
+ */
+static void child_work(void) {
+#ifdef _WIN32
+  // Windows에서 현재 프로세스의 PID 얻기
+  int pid = (int)_getpid();
+  printf("[child #%d] pid=%d: hello! working for 1s...\n", child_idx, pid);
+  
+  // Windows Sleep: 밀리초 단위 (1000ms = 1초)
+  Sleep(1000);
+  
+  printf("[child #%d] done.\n", child_idx);
+  
+  // Windows에서 프로세스 종료 (종료 코드 = 자식 인덱스)
+  // ExitProcess()는 즉시 프로세스를 종료시킴
+  ExitProcess((UINT)child_idx);
+  
+#else
+  if (minimal) child_work_minimal();  // stdio 없이 도는 최소 경로 (돌아오지 않음)
+
+  // Unix/Linux에서 현재 프로세스의 PID와 부모 PID 얻기
+  int pid = (int)getpid();   // 현재 프로세스 ID
+  int ppid = (int)getppid(); // 부모 프로세스 ID
+
+  // 공유 메모리를 붙이고, 부모에게 "exec도 끝났고 이제 작업을 시작한다"고 알림
+  shm_attach();
+  if (shm) {
+    shm->slot[child_slot - 1].t_ready = now_us();
+    __atomic_add_fetch(&shm->nready, 1, __ATOMIC_RELEASE);
+  }
+  signal_ready();
+
+  // 시작 배리어: 다른 자식들이 모두 준비될 때까지 대기 (--parallel일 때)
+  barrier_wait();
+  double t_start = now_us();
+  if (!quiet) {
+    printf("[child #%d] pid=%d ppid=%d: hello! working for %dms (%s)...\n",
+           child_idx, pid, ppid, work_ms, work_name);
+  }
+  if (shm) shm->slot[child_slot - 1].t_start = t_start;  // 작업 중임을 부모가 볼 수 있게
+
+  // 작업 수행 (기본값: 1초 sleep)
+  double local_metric[SLOT_METRICS] = { 0 };
+  int work_rc = run_payload(shm ? shm->slot[child_slot - 1].metric : local_metric);
+
+  double t_end = now_us();
+  if (shm) {
+    shm->slot[child_slot - 1].t_end = t_end;
+    shm->slot[child_slot - 1].cpu_us = cpu_time_us();
+  }
+  if (!quiet) printf("[child #%d] done.\n", child_idx);
+  fflush(stdout);
+
+  // 실패 주입 (부모의 --crash-every / --fail-every)
+  if (inject_crash) {
+    signal(SIGSEGV, SIG_DFL);
+    raise(SIGSEGV);
+  }
+  
+  // Unix에서 프로세스 종료 (종료 코드 = 자식 인덱스)
+  // _exit()는 즉시 프로세스를 종료시킴 (cleanup 없이)
+  // stdio 버퍼도 비우지 않으므로 출력이 파이프로 갈 때를 대비해 위에서 직접 비움
+  // 작업이 실패했으면 인덱스와 다른 코드(idx ^ 0x40)로 끝내 부모가 실패로 셈
+  if (work_rc < 0) _exit(child_idx ^ 0x40);
+  _exit(inject_fail ? (child_idx ^ 0x80) : child_idx);
+#endif
+}
+
+#ifndef _WIN32
+/*
+ * 하드웨어 성능 카운터 (--perf=cycles,instructions,...)
+ *
+ * 부모가 fork 직후, 자식이 exec하기 전에 perf_event_open(pid=자식)으로
+ * 카운터를 열어 둡니다. 카운터는 꺼진 상태(disabled)로 열고 enable_on_exec를 켜서
+ * exec가 성공하는 순간부터 세기 시작하므로, fork와 부모 코드의 잡음은 빠집니다.
+ * inherit을 켜 두면 자식이 만든 스레드/프로세스의 이벤트도 함께 셉니다.
+ *
+ * 자식이 카운터가 열리기 전에 exec해 버리면 안 되므로, 자식은 exec 직전에
+ * gate 파이프에서 부모의 신호(EOF)를 기다립니다.
+ *
+ * perf_event_paranoid 설정이나 가상 머신 환경 때문에 열 수 없으면
+ * 경고를 한 번만 출력하고 해당 이벤트(또는 전체)를 끈 채 계속 진행합니다.
+ */
+#define PERF_MAX 8
+
+struct perf_def {
+  const char* name;
+  unsigned int type;
+  unsigned long long config;
+};
+
+static const struct perf_def perf_defs[] = {
+  { "cycles",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+  { "instructions",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+  { "cache-refs",    PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES },
+  { "cache-misses",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+  { "branches",      PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+  { "branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+  { "task-clock",    PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+  { "page-faults",   PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+  { "ctx-switches",  PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+};
+
+static const struct perf_def* perf_events[PERF_MAX];  // --perf로 고른 이벤트
+static int perf_disabled[PERF_MAX];                   // 열기에 실패해 끈 이벤트
+static int n_perf = 0;
+static unsigned long long perf_total[PERF_MAX];       // 모든 자식의 합계
+static unsigned long perf_children = 0;               // 카운터를 읽은 자식 수
+
+// "--perf=" 뒤의 쉼표 목록을 이벤트 표에서 찾아 등록
+static void perf_parse(const char* list) {
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%s", list);
+  for (char* tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+    const struct perf_def* def = NULL;
+    for (size_t k = 0; k < sizeof(perf_defs) / sizeof(perf_defs[0]); ++k) {
+      if (strcmp(perf_defs[k].name, tok) == 0) def = &perf_defs[k];
+    }
+    if (def == NULL) {
+      fprintf(stderr, "[parent] unknown perf event '%s' (ignored)\n", tok);
+    } else if (n_perf < PERF_MAX) {
+      perf_events[n_perf++] = def;
+    }
+  }
+}
+
+// 자식마다 부르므로 처음 한 번만 읽어 둠 (실행 중에 바뀌는 값이 아님)
+static int perf_paranoid_level(void) {
+  static int level = -100;  // -100: 아직 읽지 않음, -99: 읽을 수 없음
+  if (level != -100) return level;
+  level = -99;
+  FILE* f = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+  if (f) {
+    if (fscanf(f, "%d", &level) != 1) level = -99;
+    fclose(f);
+  }
+  return level;
+}
+
+// 자식 pid에 대해 고른 이벤트들을 엶 (실패한 이벤트의 fd는 -1)
+static void perf_open_for(pid_t pid, int* fds) {
+  for (int k = 0; k < n_perf; ++k) {
+    fds[k] = -1;
+    if (perf_disabled[k]) continue;
+
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = perf_events[k]->type;
+    attr.config = perf_events[k]->config;
+    attr.disabled = 1;        // 처음에는 꺼 둠
+    attr.enable_on_exec = 1;  // exec 성공 시 자동으로 켜짐
+    attr.inherit = 1;         // 자식의 자식(스레드 포함)까지 합산
+    attr.exclude_kernel = perf_paranoid_level() >= 2;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    int fd = (int)syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    if (fd >= 0) {
+      fds[k] = fd;
+      continue;
+    }
+    if (errno == EACCES || errno == EPERM) {
+      // 권한 문제는 모든 이벤트에 공통이므로 전부 끔
+      fprintf(stderr, "[parent] perf_event_open not permitted (%s, perf_event_paranoid=%d); "
+              "disabling --perf\n", strerror(errno), perf_paranoid_level());
+      for (int j = 0; j < n_perf; ++j) perf_disabled[j] = 1;
+      for (int j = 0; j < k; ++j) {
+        if (fds[j] >= 0) close(fds[j]);
+        fds[j] = -1;
+      }
+      return;
+    }
+    // ENOENT/EOPNOTSUPP 등: 이 CPU(또는 VM)가 지원하지 않는 이벤트만 끔
+    fprintf(stderr, "[parent] perf event '%s' unavailable (%s); skipping it\n",
+            perf_events[k]->name, strerror(errno));
+    perf_disabled[k] = 1;
+  }
+}
+
+/*
+ * 수거한 자식의 카운터를 읽고 닫음
+ *
+ * 카운터보다 이벤트가 많아 시분할(multiplexing)되었다면
+ * time_enabled / time_running 비율로 값을 보정합니다.
+ * 이벤트가 열리지 않았으면 out[k]는 -1입니다.
+ */
+static void perf_read_close(int* fds, double* out) {
+  for (int k = 0; k < n_perf; ++k) {
+    out[k] = -1;
+    if (fds[k] < 0) continue;
+    unsigned long long v[3];  // value, time_enabled, time_running
+    if (read(fds[k], v, sizeof(v)) == (ssize_t)sizeof(v)) {
+      out[k] = (double)v[0];
+      if (v[2] > 0 && v[2] < v[1]) out[k] = (double)v[0] * v[1] / v[2];
+      perf_total[k] += (unsigned long long)out[k];
+    }
+    close(fds[k]);
+    fds[k] = -1;
+  }
+  perf_children++;
+}
+
+static double perf_value(const double* vals, const char* name) {
+  for (int k = 0; k < n_perf; ++k) {
+    if (strcmp(perf_events[k]->name, name) == 0) return vals[k];
+  }
+  return -1;
+}
+
+// 원시 값과 함께 IPC, 1000 명령당 캐시/분기 미스를 한 줄로 만듦
+static void perf_format(const double* vals, char* out, size_t len) {
+  size_t used = 0;
+  out[0] = '\0';
+  for (int k = 0; k < n_perf && used < len; ++k) {
+    if (vals[k] < 0) continue;
+    used += (size_t)snprintf(out + used, len - used, " %s=%.0f", perf_events[k]->name, vals[k]);
+  }
+  double cyc = perf_value(vals, "cycles"), ins = perf_value(vals, "instructions");
+  double cm = perf_value(vals, "cache-misses"), bm = perf_value(vals, "branch-misses");
+  if (used < len && cyc > 0 && ins >= 0) {
+    used += (size_t)snprintf(out + used, len - used, " IPC=%.2f", ins / cyc);
+  }
+  if (used < len && ins > 0 && cm >= 0) {
+    used += (size_t)snprintf(out + used, len - used, " cache-MPKI=%.2f", cm * 1000 / ins);
+  }
+  if (used < len && ins > 0 && bm >= 0) {
+    snprintf(out + used, len - used, " branch-MPKI=%.2f", bm * 1000 / ins);
+  }
+}
+
+static void print_perf_summary(void) {
+  if (n_perf == 0 || perf_children == 0) return;
+  double vals[PERF_MAX];
+  char line[512];
+  int any = 0;
+  for (int k = 0; k < n_perf; ++k) {
+    vals[k] = perf_disabled[k] ? -1 : (double)perf_total[k];
+    if (vals[k] >= 0) any = 1;
+  }
+  if (!any) return;
+  perf_format(vals, line, sizeof(line));
+  printf("\n[parent] perf counters summed over %lu children:\n ", perf_children);
+  printf("%s\n", line);
+  for (int k = 0; k < n_perf; ++k) {
+    if (vals[k] >= 0) printf("  %-14s avg per child: %.0f\n", perf_events[k]->name,
+                             vals[k] / perf_children);
+  }
+}
+
+/*
+ * 네임스페이스 격리 (--ns=user,pid,mount,net,uts,ipc)
+ *
+ * fork() 대신 clone3()로 자식을 만들면서 CLONE_NEW* 플래그를 주면
+ * 자식은 새 네임스페이스 안에서 시작합니다.
+ *
+ * - user : 새 사용자 네임스페이스. 자식은 그 안에서 root(uid 0)로 보이지만
+ *          바깥에서는 부모와 같은 일반 사용자입니다. 권한 없이도 만들 수 있으므로
+ *          나머지 네임스페이스를 만들 권한도 여기서 얻습니다.
+ * - pid  : 새 PID 네임스페이스. 자식은 그 안에서 PID 1(init)이 됩니다.
+ * - mount: 새 마운트 네임스페이스. 자식이 마운트를 바꿔도 바깥에 보이지 않습니다.
+ * - net  : 새 네트워크 네임스페이스. 루프백(내려간 상태)만 있습니다.
+ *
+ * user 네임스페이스의 uid/gid 매핑은 자식이 exec 전에 직접 씁니다.
+ */
+static const struct { const char* name; unsigned long flag; } ns_defs[] = {
+  { "user",  CLONE_NEWUSER },
+  { "pid",   CLONE_NEWPID },
+  { "mount", CLONE_NEWNS },
+  { "net",   CLONE_NEWNET },
+  { "uts",   CLONE_NEWUTS },
+  { "ipc",   CLONE_NEWIPC },
+};
+
+static unsigned long ns_flags = 0;   // 자식에게 줄 CLONE_NEW* 플래그
+
+static unsigned long ns_parse(const char* list) {
+  unsigned long flags = 0;
+  char buf[128];
+  snprintf(buf, sizeof(buf), "%s", list);
+  for (char* tok = strtok(buf, ",+"); tok; tok = strtok(NULL, ",+")) {
+    int found = 0;
+    for (size_t k = 0; k < sizeof(ns_defs) / sizeof(ns_defs[0]); ++k) {
+      if (strcmp(ns_defs[k].name, tok) == 0) {
+        flags |= ns_defs[k].flag;
+        found = 1;
+      }
+    }
+    if (!found && strcmp(tok, "none") != 0) {
+      fprintf(stderr, "[parent] unknown namespace '%s' (ignored)\n", tok);
+    }
+  }
+  return flags;
+}
+
+static void ns_describe(unsigned long flags, char* out, size_t len) {
+  size_t used = 0;
+  out[0] = '\0';
+  for (size_t k = 0; k < sizeof(ns_defs) / sizeof(ns_defs[0]); ++k) {
+    if (flags & ns_defs[k].flag) {
+      used += (size_t)snprintf(out + used, len > used ? len - used : 0, "%s%s",
+                               used ? "+" : "", ns_defs[k].name);
+    }
+  }
+  if (used == 0) snprintf(out, len, "none");
+}
+
+// 네임스페이스가 없으면 보통의 fork(), 있으면 clone3() (fork처럼 자식에서 0을 반환)
+static pid_t spawn_fork(void) {
+  if (ns_flags == 0) return fork();
+  struct clone_args ca;
+  memset(&ca, 0, sizeof(ca));
+  ca.flags = ns_flags;
+  ca.exit_signal = SIGCHLD;  // 일반 자식처럼 waitpid()로 수거
+  return (pid_t)syscall(SYS_clone3, &ca, sizeof(ca));
+}
+
+static int write_proc_file(const char* path, const char* text) {
+  int fd = open(path, O_WRONLY | O_CLOEXEC);
+  if (fd < 0) return -1;
+  ssize_t n = write(fd, text, strlen(text));
+  close(fd);
+  return n == (ssize_t)strlen(text) ? 0 : -1;
+}
+
+/*
+ * 자식(새 네임스페이스 안)에서 exec 전에 할 준비
+ * uid/gid는 clone 전에 부모 쪽에서 읽어 둔 값 (안에서는 아직 매핑이 없어 65534로 보임)
+ */
+static int ns_setup_child(uid_t outer_uid, gid_t outer_gid) {
+  char map[64];
+  if (ns_flags & CLONE_NEWUSER) {
+    // gid_map을 쓰려면 먼저 setgroups를 막아야 함 (권한 없는 사용자 규칙)
+    if (write_proc_file("/proc/self/setgroups", "deny") < 0 && errno != ENOENT) return -1;
+    snprintf(map, sizeof(map), "0 %d 1", (int)outer_uid);
+    if (write_proc_file("/proc/self/uid_map", map) < 0) return -1;
+    snprintf(map, sizeof(map), "0 %d 1", (int)outer_gid);
+    if (write_proc_file("/proc/self/gid_map", map) < 0) return -1;
+  }
+  if (ns_flags & CLONE_NEWNS) {
+    // 마운트 변경이 바깥으로 전파되지 않도록 전체를 private로
+    if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) < 0) return -1;
+  }
+  return 0;
+}
+
+/*
+ * seccomp 허용 목록 (--seccomp)
+ *
+ * 자식은 exec 직전에 아래 BPF 프로그램을 커널에 설치하고, 필터는 exec 후에도
+ * 그대로 남아 child_work()까지 적용됩니다. 프로그램은 static const 배열이라
+ * 컴파일할 때 한 번 만들어지며, fork된 자식은 부모의 것을 그대로 씁니다.
+ * (자식마다 필터를 새로 조립하지 않으므로 생성 비용에는 prctl 두 번만 더해짐)
+ *
+ * 허용 목록에 없는 시스템 콜은 죽이지 않고 EPERM으로 실패시킵니다.
+ * 필터는 위에서부터 차례로 비교하므로, 자주 쓰는 시스템 콜을 앞에 둡니다.
+ * exec된 프로그램의 시작 과정(동적 링커, libc 초기화)도 통과해야 하므로
+ * execve와 mmap/mprotect/openat 같은 것도 들어 있습니다.
+ */
+#if defined(__x86_64__)
+#define SECCOMP_ARCH AUDIT_ARCH_X86_64
+#elif defined(__aarch64__)
+#define SECCOMP_ARCH AUDIT_ARCH_AARCH64
+#endif
+
+#ifdef SECCOMP_ARCH
+#define SC_ALLOW(name) \
+  BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_##name, 0, 1), \
+  BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW)
+
+static const struct sock_filter seccomp_insns[] = {
+  // 다른 아키텍처의 시스템 콜 번호로 우회하지 못하도록 arch부터 확인
+  BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch)),
+  BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, SECCOMP_ARCH, 1, 0),
+  BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS),
+  BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)),
+  // 작업 중에 자주 부르는 것
+  SC_ALLOW(getppid), SC_ALLOW(clock_gettime), SC_ALLOW(futex), SC_ALLOW(write),
+  SC_ALLOW(clock_nanosleep), SC_ALLOW(nanosleep), SC_ALLOW(read),
+  // 메모리
+  SC_ALLOW(mmap), SC_ALLOW(munmap), SC_ALLOW(madvise), SC_ALLOW(mprotect), SC_ALLOW(brk),
+  // 파일 (공유 메모리, 스냅숏, /proc)
+  SC_ALLOW(openat), SC_ALLOW(close), SC_ALLOW(fstat), SC_ALLOW(newfstatat),
+  SC_ALLOW(pread64), SC_ALLOW(lseek), SC_ALLOW(ioctl), SC_ALLOW(fcntl),
+  SC_ALLOW(renameat), SC_ALLOW(unlinkat), SC_ALLOW(ftruncate), SC_ALLOW(mremap),
+  // I/O 작업 (--work=write|read)
+  SC_ALLOW(pwrite64), SC_ALLOW(fsync), SC_ALLOW(fdatasync), SC_ALLOW(fallocate),
+  // 스케줄링과 I/O 우선순위 (--sched, --ioprio를 exec 뒤에 다시 확인하거나 바꿀 때)
+  SC_ALLOW(sched_yield), SC_ALLOW(sched_getaffinity), SC_ALLOW(sched_setaffinity),
+  SC_ALLOW(sched_getattr), SC_ALLOW(sched_setattr), SC_ALLOW(sched_getparam),
+  SC_ALLOW(sched_getscheduler), SC_ALLOW(ioprio_get), SC_ALLOW(ioprio_set),
+#ifdef __NR_open
+  SC_ALLOW(open), SC_ALLOW(rename), SC_ALLOW(unlink), SC_ALLOW(access),
+#endif
+  // 프로세스 정보, 시그널, 종료
+  SC_ALLOW(getpid), SC_ALLOW(gettid), SC_ALLOW(getrusage), SC_ALLOW(getrandom),
+  SC_ALLOW(rt_sigaction), SC_ALLOW(rt_sigprocmask), SC_ALLOW(rt_sigreturn),
+  SC_ALLOW(tgkill), SC_ALLOW(exit), SC_ALLOW(exit_group),
+  // exec와 libc 초기화
+  SC_ALLOW(execve), SC_ALLOW(set_tid_address), SC_ALLOW(set_robust_list),
+  SC_ALLOW(rseq), SC_ALLOW(prlimit64), SC_ALLOW(faccessat),
+#ifdef __NR_arch_prctl
+  SC_ALLOW(arch_prctl),
+#endif
+#ifdef OS_STUDY_SANITIZED
+  // 새니타이저 런타임의 시작과 보고 (시그널 스택, 자기 경로와 메모리 맵 읽기)
+  SC_ALLOW(sigaltstack), SC_ALLOW(readlinkat), SC_ALLOW(prctl), SC_ALLOW(getrlimit),
+#ifdef __NR_readlink
+  SC_ALLOW(readlink),
+#endif
+#endif
+  BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | (EPERM & SECCOMP_RET_DATA)),
+};
+
+static const struct sock_fprog seccomp_prog = {
+  .len = (unsigned short)(sizeof(seccomp_insns) / sizeof(seccomp_insns[0])),
+  .filter = (struct sock_filter*)seccomp_insns,
+};
+#endif
+
+static int use_seccomp = 0;  // 1이면 자식이 exec 전에 필터 설치 (--seccomp)
+
+// 자식(fork 후, exec 전)에서 호출. 실패하면 -1과 errno
+static int seccomp_install(void) {
+#ifdef SECCOMP_ARCH
+  // 권한 없는 프로세스가 필터를 걸려면 먼저 no_new_privs를 켜야 함
+  if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) < 0) return -1;
+  return prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &seccomp_prog);
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+/*
+ * 백그라운드 샘플러 (--sample-ms=N)
+ *
+ * 부모 안의 스레드 하나가 주기적으로 살아 있는 모든 자식의 /proc 파일을 읽어
+ * 자식별 시계열(CPU 사용률, RSS)을 링 버퍼에 쌓아 두고, 끝날 때 곡선으로 보여 줍니다.
+ *
+ * - /proc/PID/stat      : 상태(R/S/Z...)와 minor 페이지 폴트 수
+ * - /proc/PID/statm     : 상주 페이지 수 (RSS)
+ * - /proc/PID/schedstat : CPU에서 실행한 시간과 실행 대기 시간 (나노초 단위)
+ *
+ * 자식마다 세 파일을 생성 직후 한 번만 열어 두고, 샘플마다 pread(fd, ..., 0)로
+ * 다시 읽습니다. (/proc 파일은 오프셋 0에서 읽을 때마다 내용을 새로 만듦)
+ * 매번 open/close 하는 것보다 시스템 콜이 1/3이고 경로 탐색도 없습니다.
+ *
+ * 샘플러가 부모 CPU를 1% 넘게 쓰지 않도록, 한 바퀴에 든 스레드 CPU 시간을 재서
+ * 다음 바퀴까지의 간격을 그 120배 이상으로 늘립니다. (자식이 많으면 간격이 자동으로 길어짐)
+ *
+ * 추적 표는 자식 인덱스가 아니라 "살아 있는 칸" 단위입니다: 수거한 자식의 칸은 다음 자식이
+ * 다시 쓰므로 메모리는 동시에 살아 있는 자식 수에만 비례하고, 자식이 몇 개든 모두 추적합니다.
+ * 칸을 비울 때 그 자식의 샘플은 CSV로 바로 내보내고, CPU를 가장 많이 쓴 몇 개만 곡선용으로 남깁니다.
+ */
+#define SAMPLE_RING 64               // 자식별로 보관하는 최근 샘플 수
+#define SAMPLER_MAX_OVERHEAD 0.008   // 샘플러 스레드 CPU 사용률 목표 (1% 상한에 여유를 둠)
+#define SAMPLER_SHOW 8               // 끝날 때 곡선을 그려 줄 자식 수
+
+struct sample {
+  double t_us;          // 샘플 시각
+  double cpu_ns;        // 누적 CPU 실행 시간 (schedstat)
+  double wait_ns;       // 누적 실행 대기 시간 (schedstat)
+  long rss_kb;          // 상주 메모리 (statm)
+  unsigned long minflt; // 누적 minor 폴트 (stat)
+  char state;           // 프로세스 상태 (stat)
+};
+
+struct sampled_child {
+  int idx;              // 자식 인덱스
+  pid_t pid;
+  int fd[3];            // stat, statm, schedstat
+  unsigned long n;      // 지금까지 찍은 샘플 수 (링 위치 = n % SAMPLE_RING)
+  struct sample* ring;
+};
+
+static struct {
+  int interval_ms;                // 요청한 간격 (--sample-ms)
+  const char* out_path;           // 모든 샘플을 CSV로 저장할 파일 (--sample-out)
+  FILE* csv;                      // 그 파일 (칸을 비울 때마다 그 자식의 샘플을 씀)
+  int active;
+  volatile int stop;
+  pthread_t thread;
+  pthread_mutex_t lock;           // 아래 추적 목록 보호 (부모 메인 스레드와 공유)
+  struct sampled_child* ch;       // 칸 → 추적 중인 자식
+  int nch;                        // 칸 수 (모자라면 두 배로 늘림)
+  int* live;                      // 칸 목록: 앞 nlive개는 지금 읽어야 할 칸, 나머지는 빈 칸
+  int* live_pos;                  // 칸 → live 안의 위치 (-1: 빈 칸)
+  int nlive;
+  struct sampled_child top[SAMPLER_SHOW];  // 끝난 자식 중 CPU를 가장 많이 쓴 것들 (곡선용)
+  struct sample top_ring[SAMPLER_SHOW][SAMPLE_RING];
+  int ntop;
+  int tracked, sampled;           // 추적한 자식 수, 그중 샘플을 하나라도 찍은 자식 수
+  double t_begin, t_end;
+  double cpu_us;                  // 샘플러 스레드가 쓴 CPU 시간
+  double interval_us;             // 실제로 쓰인 (늘어난) 간격의 마지막 값
+  unsigned long rounds, reads;
+} sampler = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static double thread_cpu_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static ssize_t pread_text(int fd, char* buf, size_t len) {
+  ssize_t n = pread(fd, buf, len - 1, 0);
+  buf[n > 0 ? n : 0] = '\0';
+  return n;
+}
+
+// 자식 하나를 한 번 읽어 링 버퍼에 추가 (잠금을 잡은 상태에서 호출)
+static void sampler_read(struct sampled_child* c) {
+  char buf[512];
+  struct sample s;
+  memset(&s, 0, sizeof(s));
+  s.t_us = now_us();
+
+  if (pread_text(c->fd[0], buf, sizeof(buf)) > 0) {
+    // comm에 공백이나 괄호가 있을 수 있으므로 마지막 ')' 뒤부터 해석
+    char* p = strrchr(buf, ')');
+    if (p) sscanf(p + 2, "%c %*d %*d %*d %*d %*d %*u %lu", &s.state, &s.minflt);
+  }
+  if (pread_text(c->fd[1], buf, sizeof(buf)) > 0) {
+    long pages = 0;
+    sscanf(buf, "%*s %ld", &pages);
+    s.rss_kb = pages * (sysconf(_SC_PAGESIZE) / 1024);
+  }
+  if (pread_text(c->fd[2], buf, sizeof(buf)) > 0) {
+    sscanf(buf, "%lf %lf", &s.cpu_ns, &s.wait_ns);
+  }
+  if (s.state == '\0') return;  // 이미 사라진 자식
+  c->ring[c->n % SAMPLE_RING] = s;
+  c->n++;
+  sampler.reads += 3;
+}
+
+static void* sampler_main(void* arg) {
+  (void)arg;
+  double min_interval = sampler.interval_ms * 1e3;
+  while (!sampler.stop) {
+    double c0 = thread_cpu_us();
+    pthread_mutex_lock(&sampler.lock);
+    for (int k = 0; k < sampler.nlive; ++k) sampler_read(&sampler.ch[sampler.live[k]]);
+    pthread_mutex_unlock(&sampler.lock);
+    sampler.rounds++;
+    double cost = thread_cpu_us() - c0;
+
+    // 다음 바퀴까지의 간격: 요청한 값과 "CPU 1%를 넘지 않는 값" 중 큰 쪽
+    double wait = cost * (1 - SAMPLER_MAX_OVERHEAD) / SAMPLER_MAX_OVERHEAD;
+    sampler.interval_us = wait > min_interval ? wait : min_interval;
+    struct timespec ts = { (time_t)(sampler.interval_us / 1e6),
+                           (long)((long long)sampler.interval_us % 1000000) * 1000 };
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR && !sampler.stop) { }
+  }
+  sampler.cpu_us = thread_cpu_us();
+  return NULL;
+}
+
+// nslots: 동시에 살아 있을 자식 수 (넘으면 표를 늘림)
+static void sampler_start(int nslots) {
+  sampler.nch = nslots > 0 ? nslots : 1;
+  sampler.ch = calloc((size_t)sampler.nch, sizeof(*sampler.ch));
+  sampler.live = calloc((size_t)sampler.nch, sizeof(int));
+  sampler.live_pos = malloc((size_t)sampler.nch * sizeof(int));
+  if (sampler.ch == NULL || sampler.live == NULL || sampler.live_pos == NULL) {
+    perror("[parent] sampler: calloc failed");
+    return;
+  }
+  for (int i = 0; i < sampler.nch; ++i) {
+    sampler.live[i] = i;
+    sampler.live_pos[i] = -1;
+  }
+  if (sampler.out_path) {
+    sampler.csv = fopen(sampler.out_path, "w");
+    if (sampler.csv == NULL) perror("[parent] sampler: cannot write --sample-out");
+    else fprintf(sampler.csv, "child,pid,t_ms,cpu_ms,wait_ms,rss_kb,minflt,state\n");
+  }
+
+  // 자식마다 fd 3개를 열어 두므로 열린 파일 수 한도를 최대로 올려 둠
+  struct rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+
+  sampler.t_begin = now_us();
+  if (pthread_create(&sampler.thread, NULL, sampler_main, NULL) != 0) {
+    perror("[parent] sampler: pthread_create failed");
+    return;
+  }
+  sampler.active = 1;
+}
+
+// 빈 칸 하나 (없으면 표를 두 배로 늘림, 잠금을 잡은 상태에서 호출), 실패하면 -1
+static int sampler_slot_alloc(void) {
+  if (sampler.nlive == sampler.nch) {
+    int n = sampler.nch * 2;
+    struct sampled_child* ch = realloc(sampler.ch, (size_t)n * sizeof(*ch));
+    if (ch == NULL) return -1;
+    sampler.ch = ch;
+    memset(ch + sampler.nch, 0, (size_t)(n - sampler.nch) * sizeof(*ch));
+    int* live = realloc(sampler.live, (size_t)n * sizeof(int));
+    if (live == NULL) return -1;
+    sampler.live = live;
+    int* pos = realloc(sampler.live_pos, (size_t)n * sizeof(int));
+    if (pos == NULL) return -1;
+    sampler.live_pos = pos;
+    for (int i = sampler.nch; i < n; ++i) {
+      sampler.live[i] = i;
+      sampler.live_pos[i] = -1;
+    }
+    sampler.nch = n;
+  }
+  return sampler.live[sampler.nlive];
+}
+
+// 부모: 자식을 만든 직후 호출 (열기에 실패한 파일은 건너뜀), 칸 번호 + 1 (추적하지 않으면 0)
+static int sampler_track(int idx, pid_t pid) {
+  static const char* const files[3] = { "stat", "statm", "schedstat" };
+  if (!sampler.active) return 0;
+  int fd[3];
+  for (int k = 0; k < 3; ++k) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/%s", (int)pid, files[k]);
+    fd[k] = open(path, O_RDONLY | O_CLOEXEC);
+  }
+  pthread_mutex_lock(&sampler.lock);
+  int i = fd[0] >= 0 && fd[1] >= 0 && fd[2] >= 0 ? sampler_slot_alloc() : -1;
+  struct sampled_child* c = i >= 0 ? &sampler.ch[i] : NULL;
+  if (c && c->ring == NULL) c->ring = calloc(SAMPLE_RING, sizeof(struct sample));
+  if (c == NULL || c->ring == NULL) {
+    pthread_mutex_unlock(&sampler.lock);
+    for (int k = 0; k < 3; ++k) if (fd[k] >= 0) close(fd[k]);
+    return 0;
+  }
+  c->idx = idx;
+  c->pid = pid;
+  c->n = 0;
+  memcpy(c->fd, fd, sizeof(fd));
+  sampler.live_pos[i] = sampler.nlive;
+  sampler.live[sampler.nlive++] = i;
+  sampler.tracked++;
+  pthread_mutex_unlock(&sampler.lock);
+  return i + 1;
+}
+
+// 링 버퍼 안의 i번째(오래된 순) 샘플
+static const struct sample* sample_at(const struct sampled_child* c, unsigned long i) {
+  unsigned long first = c->n > SAMPLE_RING ? c->n - SAMPLE_RING : 0;
+  return &c->ring[(first + i) % SAMPLE_RING];
+}
+
+static double sampled_cpu_ns(const struct sampled_child* c) {
+  return c->ring[(c->n - 1) % SAMPLE_RING].cpu_ns;
+}
+
+// 끝난 자식의 샘플을 CSV로 내보내고, CPU 상위면 곡선용으로 복사
+static void sampler_retire(const struct sampled_child* c) {
+  if (c->n == 0) return;
+  sampler.sampled++;
+  unsigned long n = c->n > SAMPLE_RING ? SAMPLE_RING : c->n;
+  if (sampler.csv) {
+    for (unsigned long k = 0; k < n; ++k) {
+      const struct sample* s = sample_at(c, k);
+      fprintf(sampler.csv, "%d,%d,%.3f,%.3f,%.3f,%ld,%lu,%c\n", c->idx, (int)c->pid,
+              (s->t_us - sampler.t_begin) / 1e3, s->cpu_ns / 1e6, s->wait_ns / 1e6, s->rss_kb,
+              s->minflt, s->state);
+    }
+  }
+  if (c->n < 2) return;
+  int t = sampler.ntop;
+  if (t == SAMPLER_SHOW) {
+    t = 0;
+    for (int k = 1; k < SAMPLER_SHOW; ++k) {
+      if (sampled_cpu_ns(&sampler.top[k]) < sampled_cpu_ns(&sampler.top[t])) t = k;
+    }
+    if (sampled_cpu_ns(c) <= sampled_cpu_ns(&sampler.top[t])) return;
+  } else {
+    sampler.ntop++;
+  }
+  sampler.top[t] = *c;
+  sampler.top[t].ring = sampler.top_ring[t];
+  memcpy(sampler.top_ring[t], c->ring, sizeof(sampler.top_ring[t]));
+}
+
+// 부모: 자식을 수거한 뒤 호출 (마지막으로 한 번 읽어 보고 fd를 닫고 칸을 비움)
+static void sampler_untrack(int slot) {
+  if (!sampler.active || slot < 1) return;
+  int i = slot - 1;
+  pthread_mutex_lock(&sampler.lock);
+  int pos = sampler.live_pos[i];
+  struct sampled_child* c = &sampler.ch[i];
+  if (pos >= 0) {
+    sampler_read(c);
+    for (int k = 0; k < 3; ++k) close(c->fd[k]);
+    int last = sampler.live[--sampler.nlive];
+    sampler.live[pos] = last;
+    sampler.live_pos[last] = pos;
+    sampler.live[sampler.nlive] = i;
+    sampler.live_pos[i] = -1;
+  }
+  pthread_mutex_unlock(&sampler.lock);
+  // 빈 칸은 이 스레드(sampler_track)만 다시 쓰므로 잠금 없이 내보내도 됨
+  if (pos >= 0) sampler_retire(c);
+}
+
+static void sampler_stop(void) {
+  if (!sampler.active) return;
+  sampler.stop = 1;
+  pthread_join(sampler.thread, NULL);
+  sampler.t_end = now_us();
+  // 수거되지 않은 채 남은 자식 (보통은 없음)
+  while (sampler.nlive > 0) sampler_untrack(sampler.live[0] + 1);
+}
+
+// 마지막 샘플의 누적 CPU 시간이 큰 순서
+static int cmp_sampled_cpu(const void* a, const void* b) {
+  double d = sampled_cpu_ns((const struct sampled_child*)b) - sampled_cpu_ns((const struct sampled_child*)a);
+  return (d > 0) - (d < 0);
+}
+
+// 값 배열을 " .:-=+*#%@" 10단계 문자로 그린 작은 곡선
+static void sparkline(const double* v, int n, double vmax, char* out) {
+  static const char levels[] = " .:-=+*#%@";
+  for (int i = 0; i < n; ++i) {
+    int l = vmax > 0 ? (int)(v[i] / vmax * 9 + 0.5) : 0;
+    out[i] = levels[l < 0 ? 0 : (l > 9 ? 9 : l)];
+  }
+  out[n] = '\0';
+}
+
+static void print_sampler_report(void) {
+  if (!sampler.active) return;
+  double wall = sampler.t_end - sampler.t_begin;
+
+  printf("\n[parent] Sampler: %lu rounds, %lu /proc reads, %d children tracked (%d sampled)\n",
+         sampler.rounds, sampler.reads, sampler.tracked, sampler.sampled);
+  printf("  interval %d ms requested, %.1f ms last used; sampler CPU %.1f ms = %.2f%% of %.1f s\n",
+         sampler.interval_ms, sampler.interval_us / 1e3, sampler.cpu_us / 1e3,
+         wall > 0 ? sampler.cpu_us / wall * 100 : 0.0, wall / 1e6);
+
+  // CPU를 가장 많이 쓴 자식 몇 개의 곡선 (각 구간의 CPU%와 RSS)
+  int ntop = sampler.ntop;
+  if (ntop == 0) return;
+  qsort(sampler.top, (size_t)ntop, sizeof(sampler.top[0]), cmp_sampled_cpu);
+
+  printf("  per-child curves (oldest -> newest, last %d samples, top %d by CPU):\n",
+         SAMPLE_RING, ntop);
+  for (int t = 0; t < ntop; ++t) {
+    const struct sampled_child* c = &sampler.top[t];
+    int n = (int)(c->n > SAMPLE_RING ? SAMPLE_RING : c->n);
+    double cpu[SAMPLE_RING], rss[SAMPLE_RING], cmax = 0, rmax = 0;
+    char cline[SAMPLE_RING + 1], rline[SAMPLE_RING + 1];
+    cpu[0] = 0;
+    for (int i = 0; i < n; ++i) {
+      const struct sample* s = sample_at(c, (unsigned long)i);
+      if (i > 0) {
+        const struct sample* p = sample_at(c, (unsigned long)i - 1);
+        double dt = s->t_us - p->t_us;
+        cpu[i] = dt > 0 ? (s->cpu_ns - p->cpu_ns) / 1e3 / dt * 100 : 0;
+      }
+      rss[i] = (double)s->rss_kb;
+      if (cpu[i] > cmax) cmax = cpu[i];
+      if (rss[i] > rmax) rmax = rss[i];
+    }
+    sparkline(cpu, n, cmax, cline);
+    sparkline(rss, n, rmax, rline);
+    printf("    child #%-6d cpu |%-*s| max %5.1f%%\n", c->idx, SAMPLE_RING, cline, cmax);
+    printf("    %-13s rss |%-*s| max %5.0f kB\n", "", SAMPLE_RING, rline, rmax);
+  }
+}
+
+// 샘플 CSV 마무리 (--sample-out=FILE, 자식별 샘플은 칸을 비울 때마다 이미 씀)
+static void write_sampler_csv(void) {
+  if (!sampler.active || sampler.csv == NULL) return;
+  if (fclose(sampler.csv) != 0) perror("[parent] sampler: cannot write --sample-out");
+  else printf("  samples written to %s\n", sampler.out_path);
+  sampler.csv = NULL;
+}
+
+/*
+ * 자식별 스케줄링 정책 (--sched=RANGE:POLICY[:WORK], 여러 번 줄 수 있음)
+ *
+ * RANGE : 자식 인덱스 하나(3), 범위(1-4), 또는 전부(*)
+ * POLICY: default            정책은 그대로 두고 WORK만 바꿈
+ *         nice=N             보통(CFS/EEVDF) 정책, nice 값만 바꿈 (-20..19)
+ *         batch[=N]          SCHED_BATCH: 깨어날 때 선점하지 않는 일괄 작업 (N은 nice)
+ *         idle               SCHED_IDLE: 다른 작업이 없을 때만 실행
+ *         fifo=P, rr=P       실시간 SCHED_FIFO / SCHED_RR, 우선순위 P (1..99, 권한 필요)
+ *         deadline=R/P[/D]   SCHED_DEADLINE: 주기 P마다 R만큼 보장 (마이크로초, D는 마감)
+ * WORK  : 이 자식들만 다른 작업으로 실행 (예: spin, wakeup)
+ *
+ * 정책은 fork된 자식이 exec 직전에 sched_setattr()로 설정하며 exec 후에도 유지됩니다.
+ * 같은 자식에 여러 규칙이 맞으면 나중 규칙이 이깁니다.
+ * 예: --sched=1-3:batch:spin --sched=4:fifo=10:wakeup
+ *     (일괄 작업 3개와 같은 CPU에서 지연에 민감한 자식 하나를 보호)
+ */
+#define SCHED_RULES_MAX 8
+
+// 자식 범위 "3", "1-4", "*"를 [lo, hi]로 (규칙 옵션들이 함께 씀)
+static int parse_child_range(const char* s, int* lo, int* hi) {
+  if (strcmp(s, "*") == 0) {
+    *lo = 1;
+    *hi = INT_MAX;
+    return 0;
+  }
+  char end;
+  if (sscanf(s, "%d-%d%c", lo, hi, &end) == 2) return *lo >= 1 && *lo <= *hi ? 0 : -1;
+  if (sscanf(s, "%d%c", lo, &end) != 1 || *lo < 1) return -1;
+  *hi = *lo;
+  return 0;
+}
+
+// 10진 정수 하나 (비었거나 뒤에 다른 글자가 있으면 -1)
+static int parse_ll(const char* s, long long* out) {
+  char* end;
+  errno = 0;
+  *out = strtoll(s, &end, 10);
+  return end == s || *end != '\0' || errno != 0 ? -1 : 0;
+}
+
+// 규칙 옵션의 잘못된 값: 조용히 버리면 엉뚱한 정책으로 측정하게 되므로 시작 전에 거부
+static void rule_error(const char* opt, const char* spec, const char* why) {
+  char arg[160];
+  snprintf(arg, sizeof(arg), "%s=%s", opt, spec);
+  usage_error(arg, why);
+}
+
+// 커널의 struct sched_attr (SCHED_ATTR_SIZE_VER0, glibc에는 래퍼가 없음)
+struct pd_sched_attr {
+  unsigned int size;
+  unsigned int sched_policy;
+  unsigned long long sched_flags;
+  int sched_nice;
+  unsigned int sched_priority;
+  unsigned long long sched_runtime;   // 나노초
+  unsigned long long sched_deadline;
+  unsigned long long sched_period;
+};
+
+struct sched_rule {
+  int lo, hi;                 // 적용할 자식 인덱스 범위
+  struct pd_sched_attr attr;
+  char desc[64];              // 보고용 이름 (예: "fifo/10")
+  char work_arg[32];          // 자식에게 덧붙일 --work=NAME (없으면 빈 문자열)
+  const struct payload* work; // 이 규칙의 작업 (없으면 NULL: --work 그대로)
+  int keep;                   // 1이면 정책은 바꾸지 않음 (POLICY가 default)
+};
+
+static struct sched_rule sched_rules[SCHED_RULES_MAX];
+static int n_sched_rules = 0;
+
+// "RANGE:POLICY[:WORK]" 하나를 해석해 규칙에 추가 (잘못된 규칙이면 종료 코드 2로 끝냄)
+static void sched_parse(const char* spec) {
+  char buf[96];
+  long long v;
+  snprintf(buf, sizeof(buf), "%s", spec);
+  char* range = buf;
+  char* policy = strchr(buf, ':');
+  if (policy == NULL) rule_error("--sched", spec, "expected RANGE:POLICY[:WORK]");
+  if (n_sched_rules >= SCHED_RULES_MAX) rule_error("--sched", spec, "too many rules (at most 8)");
+  *policy++ = '\0';
+  char* work = strchr(policy, ':');
+  if (work) *work++ = '\0';
+
+  struct sched_rule r;
+  memset(&r, 0, sizeof(r));
+  if (parse_child_range(range, &r.lo, &r.hi) < 0) rule_error("--sched", spec, "bad child range");
+
+  r.attr.size = sizeof(r.attr);
+  char* val = strchr(policy, '=');
+  if (val) *val++ = '\0';
+  if (strcmp(policy, "default") == 0) {
+    r.keep = 1;
+    snprintf(r.desc, sizeof(r.desc), "default");
+  } else if (strcmp(policy, "nice") == 0 || strcmp(policy, "batch") == 0) {
+    r.attr.sched_policy = policy[0] == 'n' ? SCHED_OTHER : SCHED_BATCH;
+    if (val == NULL && policy[0] == 'n') rule_error("--sched", spec, "nice needs a value");
+    if (val && (parse_ll(val, &v) < 0 || v < -20 || v > 19)) {
+      rule_error("--sched", spec, "nice must be -20..19");
+    }
+    r.attr.sched_nice = val ? (int)v : 0;
+    if (policy[0] == 'n') snprintf(r.desc, sizeof(r.desc), "nice %d", r.attr.sched_nice);
+    else snprintf(r.desc, sizeof(r.desc), "batch/nice %d", r.attr.sched_nice);
+  } else if (strcmp(policy, "idle") == 0) {
+    r.attr.sched_policy = SCHED_IDLE;
+    snprintf(r.desc, sizeof(r.desc), "idle");
+  } else if (strcmp(policy, "fifo") == 0 || strcmp(policy, "rr") == 0) {
+    r.attr.sched_policy = policy[0] == 'f' ? SCHED_FIFO : SCHED_RR;
+    int lo = sched_get_priority_min((int)r.attr.sched_policy);
+    int hi = sched_get_priority_max((int)r.attr.sched_policy);
+    if (val == NULL || parse_ll(val, &v) < 0 || v < lo || v > hi) {
+      char why[64];
+      snprintf(why, sizeof(why), "%s priority must be %d..%d", policy, lo, hi);
+      rule_error("--sched", spec, why);
+    }
+    r.attr.sched_priority = (unsigned int)v;
+    snprintf(r.desc, sizeof(r.desc), "%s/%u", policy, r.attr.sched_priority);
+  } else if (strcmp(policy, "deadline") == 0 && val) {
+    unsigned long long rt = 0, period = 0, dl = 0;
+    char end;
+    int got = sscanf(val, "%llu/%llu/%llu%c", &rt, &period, &dl, &end);
+    if (got < 2 || got > 3) rule_error("--sched", spec, "expected deadline=RUNTIME/PERIOD[/DEADLINE]");
+    if (got == 2) dl = period;
+    if (rt == 0 || rt > dl || dl > period) {
+      rule_error("--sched", spec, "need 0 < runtime <= deadline <= period");
+    }
+    r.attr.sched_policy = SCHED_DEADLINE;
+    r.attr.sched_runtime = rt * 1000;
+    r.attr.sched_period = period * 1000;
+    r.attr.sched_deadline = dl * 1000;
+    snprintf(r.desc, sizeof(r.desc), "deadline %llu/%llu us", rt, period);
+  } else {
+    rule_error("--sched", spec, "unknown policy");
+  }
+  if (work) {
+    r.work = find_payload(work);
+    if (r.work == NULL) rule_error("--sched", spec, "unknown work");
+    snprintf(r.work_arg, sizeof(r.work_arg), "--work=%s", work);
+  }
+  sched_rules[n_sched_rules++] = r;
+}
+
+// 자식 idx에 적용할 규칙 (없으면 NULL)
+static const struct sched_rule* sched_rule_for(int idx) {
+  const struct sched_rule* found = NULL;
+  for (int k = 0; k < n_sched_rules; ++k) {
+    if (idx >= sched_rules[k].lo && idx <= sched_rules[k].hi) found = &sched_rules[k];
+  }
+  return found;
+}
+
+// 자식(fork 후, exec 전)에서 호출. 실패하면 -1과 errno (실시간/데드라인은 권한 필요)
+static int sched_apply(const struct sched_rule* r) {
+  if (r->keep) return 0;
+  struct pd_sched_attr attr = r->attr;
+  return (int)syscall(SYS_sched_setattr, 0, &attr, 0);
+}
+
+/*
+ * I/O 우선순위와 cgroup I/O 제한 (--ioprio, --io-cgroup)
+ *
+ * --ioprio=RANGE:CLASS[/LEVEL]
+ *     CLASS: rt(실시간, 권한 필요), be(보통), idle(다른 I/O가 없을 때만)
+ *     LEVEL: 0(높음)..7(낮음), rt/be에만 의미가 있음
+ *     fork된 자식이 exec 전에 ioprio_set()으로 설정하며 exec 후에도 유지됩니다.
+ *     I/O 스케줄러가 우선순위를 보는 경우(BFQ, 일부 mq-deadline)에만 효과가 있습니다.
+ *
+ * --io-cgroup=RANGE:KEY=VAL[,KEY=VAL...]
+ *     KEY: weight(io.weight, 1..10000), rbps/wbps/riops/wiops(io.max, --io-dir 장치 기준)
+ *     부모가 자기 cgroup(v2) 아래에 proc_demo-<PID>/rK 그룹을 만들어 값을 쓰고,
+ *     자식은 exec 전에 자기를 그 그룹의 cgroup.procs에 넣습니다.
+ *     cgroup v2에 io 컨트롤러가 없으면 경고 후 이 옵션만 무시합니다.
+ *
+ *     cgroup v2는 프로세스가 들어 있는 그룹에서 하위 컨트롤러를 켤 수 없으므로
+ *     (no internal process 규칙, EBUSY) 부모는 먼저 proc_demo-<PID>/parent 잎 그룹으로
+ *     자기를 옮긴 뒤 컨트롤러를 켭니다. 끝나면 원래 그룹으로 돌아가고, 자기가 켠
+ *     컨트롤러는 다시 끕니다.
+ */
+#define IO_RULES_MAX 8
+
+#ifndef IOPRIO_CLASS_SHIFT
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_PRIO_VALUE(cls, lvl) (((cls) << IOPRIO_CLASS_SHIFT) | (lvl))
+#define IOPRIO_WHO_PROCESS 1
+enum { IOPRIO_CLASS_NONE, IOPRIO_CLASS_RT, IOPRIO_CLASS_BE, IOPRIO_CLASS_IDLE };
+#endif
+
+struct ioprio_rule {
+  int lo, hi;
+  int value;          // ioprio_set()에 넘길 값
+  char desc[16];
+};
+
+struct io_cgroup_rule {
+  int lo, hi;
+  char settings[96];  // "weight=100,wbps=1048576"
+  char procs[1300];   // 자식이 자기 PID를 쓸 cgroup.procs 경로 (준비 안 됐으면 빈 문자열)
+};
+
+static struct ioprio_rule ioprio_rules[IO_RULES_MAX];
+static int n_ioprio_rules = 0;
+static struct io_cgroup_rule io_cg_rules[IO_RULES_MAX];
+static int n_io_cg_rules = 0;
+static char io_cg_base[1100];  // 부모가 만든 proc_demo-<PID> 그룹 (없으면 빈 문자열)
+static char io_cg_self[1024];  // 부모가 원래 있던 cgroup
+static int io_cg_moved = 0;    // 1이면 부모가 proc_demo-<PID>/parent로 옮겨 가 있음
+static int io_cg_enabled = 0;  // 1이면 원래 cgroup의 subtree_control에 +io를 우리가 씀
+
+static void ioprio_parse(const char* spec) {
+  char buf[64];
+  long long level = 4;
+  snprintf(buf, sizeof(buf), "%s", spec);
+  char* cls = strchr(buf, ':');
+  struct ioprio_rule r;
+  memset(&r, 0, sizeof(r));
+  if (cls == NULL) rule_error("--ioprio", spec, "expected RANGE:CLASS[/LEVEL]");
+  if (n_ioprio_rules >= IO_RULES_MAX) rule_error("--ioprio", spec, "too many rules (at most 8)");
+  *cls++ = '\0';
+  if (parse_child_range(buf, &r.lo, &r.hi) < 0) rule_error("--ioprio", spec, "bad child range");
+  char* lvl = strchr(cls, '/');
+  if (lvl) *lvl++ = '\0';
+  if (lvl && (parse_ll(lvl, &level) < 0 || level < 0 || level > 7)) {
+    rule_error("--ioprio", spec, "level must be 0..7");
+  }
+  if (strcmp(cls, "rt") == 0) r.value = IOPRIO_PRIO_VALUE(IOPRIO_CLASS_RT, (int)level);
+  else if (strcmp(cls, "be") == 0) r.value = IOPRIO_PRIO_VALUE(IOPRIO_CLASS_BE, (int)level);
+  else if (strcmp(cls, "idle") == 0) r.value = IOPRIO_PRIO_VALUE(IOPRIO_CLASS_IDLE, 0);
+  else rule_error("--ioprio", spec, "class must be rt, be or idle");
+  if (strcmp(cls, "idle") == 0) snprintf(r.desc, sizeof(r.desc), "idle");
+  else snprintf(r.desc, sizeof(r.desc), "%s/%d", cls, (int)level);
+  ioprio_rules[n_ioprio_rules++] = r;
+}
+
+static void io_cgroup_parse(const char* spec) {
+  struct io_cgroup_rule r;
+  memset(&r, 0, sizeof(r));
+  const char* colon = strchr(spec, ':');
+  char range[32], settings[sizeof(r.settings)];
+  if (colon == NULL || (size_t)(colon - spec) >= sizeof(range)) {
+    rule_error("--io-cgroup", spec, "expected RANGE:KEY=VAL[,KEY=VAL...]");
+  }
+  if (n_io_cg_rules >= IO_RULES_MAX) rule_error("--io-cgroup", spec, "too many rules (at most 8)");
+  memcpy(range, spec, (size_t)(colon - spec));
+  range[colon - spec] = '\0';
+  if (parse_child_range(range, &r.lo, &r.hi) < 0) rule_error("--io-cgroup", spec, "bad child range");
+  if (strlen(colon + 1) >= sizeof(r.settings)) rule_error("--io-cgroup", spec, "settings too long");
+  snprintf(r.settings, sizeof(r.settings), "%s", colon + 1);
+
+  // 키와 값 범위를 미리 확인 (커널에 써 보고서야 알면 자식들이 이미 떠 있음)
+  snprintf(settings, sizeof(settings), "%s", r.settings);
+  for (char* kv = strtok(settings, ","); kv; kv = strtok(NULL, ",")) {
+    char* val = strchr(kv, '=');
+    long long v;
+    if (val == NULL) rule_error("--io-cgroup", spec, "expected KEY=VAL");
+    *val++ = '\0';
+    if (strcmp(kv, "weight") == 0) {
+      if (parse_ll(val, &v) < 0 || v < 1 || v > 10000) rule_error("--io-cgroup", spec, "weight must be 1..10000");
+    } else if (strcmp(kv, "rbps") == 0 || strcmp(kv, "wbps") == 0 || strcmp(kv, "riops") == 0 ||
+               strcmp(kv, "wiops") == 0) {
+      if (strcmp(val, "max") != 0 && (parse_ll(val, &v) < 0 || v < 1)) {
+        rule_error("--io-cgroup", spec, "limits must be positive or max");
+      }
+    } else {
+      rule_error("--io-cgroup", spec, "key must be weight, rbps, wbps, riops or wiops");
+    }
+  }
+  io_cg_rules[n_io_cg_rules++] = r;
+}
+
+static const struct ioprio_rule* ioprio_rule_for(int idx) {
+  const struct ioprio_rule* found = NULL;
+  for (int k = 0; k < n_ioprio_rules; ++k) {
+    if (idx >= ioprio_rules[k].lo && idx <= ioprio_rules[k].hi) found = &ioprio_rules[k];
+  }
+  return found;
+}
+
+static const struct io_cgroup_rule* io_cgroup_rule_for(int idx) {
+  const struct io_cgroup_rule* found = NULL;
+  for (int k = 0; k < n_io_cg_rules; ++k) {
+    if (idx >= io_cg_rules[k].lo && idx <= io_cg_rules[k].hi && io_cg_rules[k].procs[0]) {
+      found = &io_cg_rules[k];
+    }
+  }
+  return found;
+}
+
+// 부모 자신이 속한 cgroup v2 디렉터리 (/proc/self/mountinfo와 /proc/self/cgroup로 찾음)
+static int cgroup2_self_dir(char* out, size_t len) {
+  char line[1024], mnt[PATH_MAX] = "", rel[PATH_MAX] = "";
+  FILE* f = fopen("/proc/self/mountinfo", "r");
+  if (f == NULL) return -1;
+  while (fgets(line, sizeof(line), f)) {
+    char* sep = strstr(line, " - cgroup2 ");
+    char point[PATH_MAX];
+    if (sep && sscanf(line, "%*s %*s %*s %*s %4095s", point) == 1) {
+      snprintf(mnt, sizeof(mnt), "%s", point);
+      break;
+    }
+  }
+  fclose(f);
+  f = fopen("/proc/self/cgroup", "r");
+  if (f == NULL || mnt[0] == '\0') {
+    if (f) fclose(f);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), f)) {
+    if (strncmp(line, "0::", 3) == 0) {
+      line[strcspn(line, "\n")] = '\0';
+      snprintf(rel, sizeof(rel), "%s", line + 3);
+    }
+  }
+  fclose(f);
+  snprintf(out, len, "%s%s", mnt, strcmp(rel, "/") == 0 ? "" : rel);
+  return 0;
+}
+
+// --io-dir가 있는 장치의 "MAJ:MIN" (파티션이면 디스크 전체, io.max는 디스크 단위)
+static int io_device_id(char* out, size_t len) {
+  struct stat st;
+  char path[128];
+  if (stat(io_dir, &st) < 0) return -1;
+  snprintf(out, len, "%u:%u", major(st.st_dev), minor(st.st_dev));
+  snprintf(path, sizeof(path), "/sys/dev/block/%s/partition", out);
+  if (access(path, F_OK) == 0) {
+    snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/../dev", major(st.st_dev), minor(st.st_dev));
+    FILE* f = fopen(path, "r");
+    if (f == NULL) return -1;
+    if (fgets(out, (int)len, f) == NULL) out[0] = '\0';
+    out[strcspn(out, "\n")] = '\0';
+    fclose(f);
+  }
+  return out[0] ? 0 : -1;
+}
+
+// cgroup 파일(공백으로 구분된 이름 목록)에 name이 단어 그대로 들어 있나 ("io"가 "pids" 등에 걸리지 않게)
+static int cgroup_list_has(const char* file, const char* name) {
+  char line[512];
+  FILE* f = fopen(file, "r");
+  if (f == NULL) return 0;
+  int found = 0;
+  if (fgets(line, sizeof(line), f)) {
+    for (char* w = strtok(line, " \n"); w && !found; w = strtok(NULL, " \n")) {
+      found = strcmp(w, name) == 0;
+    }
+  }
+  fclose(f);
+  return found;
+}
+
+static void io_cgroup_cleanup(void);
+
+// 부모: 잎 그룹으로 옮겨 간 뒤, 규칙마다 하위 그룹을 만들고 io.weight / io.max를 씀
+static void io_cgroup_setup(void) {
+  char path[1300], dev[32], val[160];
+  if (n_io_cg_rules == 0) return;
+  if (cgroup2_self_dir(io_cg_self, sizeof(io_cg_self)) < 0) {
+    fprintf(stderr, "[parent] --io-cgroup: cgroup v2 not mounted (ignored)\n");
+    return;
+  }
+  snprintf(path, sizeof(path), "%s/cgroup.controllers", io_cg_self);
+  if (!cgroup_list_has(path, "io")) {
+    fprintf(stderr, "[parent] --io-cgroup: io controller not available in %s (ignored)\n",
+            io_cg_self);
+    return;
+  }
+
+  // 1. proc_demo-<PID>/parent 잎 그룹을 만들고 부모 자신을 그리로 옮김
+  snprintf(io_cg_base, sizeof(io_cg_base), "%s/proc_demo-%d", io_cg_self, (int)getpid());
+  if (mkdir(io_cg_base, 0755) < 0) {
+    fprintf(stderr, "[parent] --io-cgroup: cannot create %s: %s (ignored)\n", io_cg_base,
+            strerror(errno));
+    io_cg_base[0] = '\0';
+    return;
+  }
+  snprintf(path, sizeof(path), "%s/parent", io_cg_base);
+  if (mkdir(path, 0755) < 0) goto fail;
+  snprintf(path, sizeof(path), "%s/parent/cgroup.procs", io_cg_base);
+  if (write_proc_file(path, "0") < 0) goto fail;
+  io_cg_moved = 1;
+
+  // 2. 원래 그룹 → proc_demo-<PID> 순서로 io 컨트롤러를 켬 (이미 켜져 있으면 그대로 둠)
+  snprintf(path, sizeof(path), "%s/cgroup.subtree_control", io_cg_self);
+  if (!cgroup_list_has(path, "io")) {
+    if (write_proc_file(path, "+io") < 0) goto fail;
+    io_cg_enabled = 1;
+  }
+  snprintf(path, sizeof(path), "%s/cgroup.subtree_control", io_cg_base);
+  if (write_proc_file(path, "+io") < 0) goto fail;
+  int have_dev = io_device_id(dev, sizeof(dev)) == 0;
+
+  for (int k = 0; k < n_io_cg_rules; ++k) {
+    struct io_cgroup_rule* r = &io_cg_rules[k];
+    char dir[1200], settings[96];
+    snprintf(dir, sizeof(dir), "%s/r%d", io_cg_base, k);
+    if (mkdir(dir, 0755) < 0) continue;
+    snprintf(settings, sizeof(settings), "%s", r->settings);
+    for (char* kv = strtok(settings, ","); kv; kv = strtok(NULL, ",")) {
+      int rc;
+      if (strncmp(kv, "weight=", 7) == 0) {
+        snprintf(path, sizeof(path), "%s/io.weight", dir);
+        snprintf(val, sizeof(val), "default %s", kv + 7);
+        rc = write_proc_file(path, val);
+      } else if (have_dev) {
+        snprintf(path, sizeof(path), "%s/io.max", dir);
+        snprintf(val, sizeof(val), "%s %s", dev, kv);
+        rc = write_proc_file(path, val);
+      } else {
+        errno = ENODEV;
+        rc = -1;
+      }
+      if (rc < 0) fprintf(stderr, "[parent] --io-cgroup: %s in %s: %s\n", kv, dir, strerror(errno));
+    }
+    snprintf(r->procs, sizeof(r->procs), "%s/cgroup.procs", dir);
+  }
+  return;
+
+fail:
+  // 다른 프로세스가 남아 있는 그룹이면 +io가 EBUSY로 실패함 (예: 셸과 같은 그룹)
+  fprintf(stderr, "[parent] --io-cgroup: cannot set up %s: %s (ignored)\n", path, strerror(errno));
+  io_cgroup_cleanup();
+}
+
+// 부모: 모든 자식을 수거한 뒤 원래 cgroup으로 돌아가고, 만든 그룹과 켠 컨트롤러를 되돌림
+static void io_cgroup_cleanup(void) {
+  char path[1300];
+  if (io_cg_base[0] == '\0') return;
+  for (int k = 0; k < n_io_cg_rules; ++k) {
+    snprintf(path, sizeof(path), "%s/r%d", io_cg_base, k);
+    rmdir(path);
+    io_cg_rules[k].procs[0] = '\0';
+  }
+  if (io_cg_moved) {
+    snprintf(path, sizeof(path), "%s/cgroup.procs", io_cg_self);
+    if (write_proc_file(path, "0") < 0) {
+      fprintf(stderr, "[parent] --io-cgroup: cannot move back to %s: %s\n", io_cg_self,
+              strerror(errno));
+    }
+    io_cg_moved = 0;
+  }
+  snprintf(path, sizeof(path), "%s/parent", io_cg_base);
+  rmdir(path);
+  rmdir(io_cg_base);
+  io_cg_base[0] = '\0';
+  if (io_cg_enabled) {
+    snprintf(path, sizeof(path), "%s/cgroup.subtree_control", io_cg_self);
+    write_proc_file(path, "-io");
+    io_cg_enabled = 0;
+  }
+}
+
+// 자식(fork 후, exec 전)에서 호출
+static int io_isolation_apply(int idx) {
+  const struct ioprio_rule* pr = ioprio_rule_for(idx);
+  if (pr && syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, pr->value) < 0) return -1;
+  const struct io_cgroup_rule* cr = io_cgroup_rule_for(idx);
+  if (cr && write_proc_file(cr->procs, "0") < 0) return -1;
+  return 0;
+}
+
+/*
+ * exec 전 fd 정리 (--fd-hygiene=cloexec|close|off, 기본값 cloexec)
+ *
+ * fork된 자식은 부모가 연 fd를 모두 물려받고, FD_CLOEXEC가 없는 fd는 exec 후에도 남습니다.
+ * 부모가 파이프나 pidfd를 수천 개 들고 있으면 자식마다 그만큼 새어 나가고
+ * (파이프 EOF가 오지 않는 버그의 흔한 원인) 자식이 끝날 때 닫는 비용도 커집니다.
+ *
+ * - cloexec: close_range(3, ~0, CLOSE_RANGE_CLOEXEC)로 3번 이상 모든 fd에 CLOEXEC를
+ *            한 번에 표시하고, 남겨야 할 fd(ready 파이프, 공유 메모리)만 다시 해제
+ * - close  : 남길 fd 목록(keep-list) 사이의 구간을 close_range()로 바로 닫음
+ * - off    : 아무것도 하지 않음 (비교용)
+ *
+ * close_range가 없는 커널이면 /proc/self/fd를 훑어 하나씩 처리합니다.
+ * (fork 후 자식에서는 malloc을 피해야 하므로 opendir 대신 getdents64와 스택 버퍼 사용)
+ */
+#ifndef CLOSE_RANGE_CLOEXEC
+#define CLOSE_RANGE_CLOEXEC (1U << 2)
+#endif
+
+enum { FD_HYGIENE_OFF, FD_HYGIENE_CLOEXEC, FD_HYGIENE_CLOSE };
+static int fd_hygiene = FD_HYGIENE_CLOEXEC;
+
+static int is_kept(int fd, const int* keep, int nkeep) {
+  for (int k = 0; k < nkeep; ++k) {
+    if (keep[k] == fd) return 1;
+  }
+  return 0;
+}
+
+// getdents64가 돌려주는 항목 (glibc는 이 구조체를 공개하지 않음)
+struct pd_dirent64 {
+  unsigned long long d_ino;
+  long long d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+// close_range 대신 /proc/self/fd 목록으로 처리
+static void fd_hygiene_slow(const int* keep, int nkeep, int mode) {
+  int dfd = open("/proc/self/fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dfd < 0) return;
+  char buf[4096];
+  long n;
+  while ((n = syscall(SYS_getdents64, dfd, buf, sizeof(buf))) > 0) {
+    for (long off = 0; off < n;) {
+      struct pd_dirent64* d = (struct pd_dirent64*)(buf + off);
+      int fd = atoi(d->d_name);
+      if (d->d_name[0] != '.' && fd > 2 && fd != dfd && !is_kept(fd, keep, nkeep)) {
+        if (mode == FD_HYGIENE_CLOSE) close(fd);
+        else fcntl(fd, F_SETFD, FD_CLOEXEC);
+      }
+      off += d->d_reclen;
+    }
+  }
+  close(dfd);
+}
+
+static int cmp_int(const void* a, const void* b) {
+  return (*(const int*)a > *(const int*)b) - (*(const int*)a < *(const int*)b);
+}
+
+// 자식(fork 후, exec 전)에서 호출. keep: exec 후에도 살려 둘 fd 목록 (-1은 무시)
+static void fd_hygiene_apply(int* keep, int nkeep) {
+  if (fd_hygiene == FD_HYGIENE_OFF) return;
+  if (fd_hygiene == FD_HYGIENE_CLOEXEC) {
+    if (syscall(SYS_close_range, 3U, ~0U, CLOSE_RANGE_CLOEXEC) < 0) {
+      fd_hygiene_slow(keep, nkeep, FD_HYGIENE_CLOEXEC);
+    }
+    return;  // 남길 fd의 CLOEXEC는 호출한 쪽에서 다시 해제
+  }
+
+  // close: 정렬한 keep-list 사이의 빈 구간만 닫음
+  qsort(keep, (size_t)nkeep, sizeof(int), cmp_int);
+  unsigned int from = 3;
+  for (int k = 0; k <= nkeep; ++k) {
+    if (k < nkeep && (keep[k] < 0 || (unsigned int)keep[k] < from)) continue;
+    unsigned int to = k < nkeep ? (unsigned int)keep[k] - 1 : ~0U;
+    if (to >= from && syscall(SYS_close_range, from, to, 0) < 0) {
+      fd_hygiene_slow(keep, nkeep, FD_HYGIENE_CLOSE);
+      return;
+    }
+    if (k < nkeep) from = (unsigned int)keep[k] + 1;
+  }
+}
+
+/*
+ * 자식 프로세스 한 개의 생성 기록 (부모가 관리)
+ *
+ * 부모는 fork() 반환만으로는 자식이 "준비되었는지" 알 수 없습니다.
+ * 그래서 두 개의 파이프로 단계를 구분합니다:
+ *
+ * 1. err 파이프 (양쪽 모두 O_CLOEXEC)
+ *    - exec가 성공하면 커널이 쓰기 끝을 자동으로 닫으므로 부모는 EOF를 읽음
+ *    - exec가 실패하면 자식이 errno를 써 넣으므로 부모는 종료 코드 127을
+ *      기다리지 않고 바로 실패 원인을 알 수 있음
+ * 2. ready 파이프 (쓰기 끝만 exec 후에도 유지)
+ *    - 자식이 child_work()를 시작할 때 1바이트를 써서 준비 완료를 알림
+ *
+ * 이렇게 fork → exec → ready 세 단계를 각각 측정할 수 있습니다.
+ *
+ * 부모가 exec 전에 자식에 대해 할 일이 있으면(예: perf 카운터 열기)
+ * 세 번째 gate 파이프를 만들어 자식이 exec 직전에 부모를 기다리게 합니다.
+ */
+struct child_rec {
+  int idx;            // 자식 인덱스 (1, 2, ...)
+  pid_t pid;          // 자식 PID (fork 실패 시 -1)
+  int err_fd;         // exec 실패 감지용 파이프 읽기 끝
+  int ready_fd;       // 준비 완료 신호용 파이프 읽기 끝
+  int exec_errno;     // exec 실패 시 자식이 보내온 errno (성공이면 0)
+  int slot;           // 공유 메모리 슬롯 번호 (0이면 idx와 같음, --slot=N으로 전달)
+  int ready;          // 준비 완료 바이트를 받았으면 1
+  double t_fork;      // fork() 호출 직전
+  double t_forked;    // fork() 반환 직후 (부모 쪽)
+  double t_exec;      // exec 성공(err 파이프 EOF) 또는 실패 보고를 받은 시각
+  double t_ready;     // 준비 완료 바이트를 받은 시각
+  int perf_fd[PERF_MAX];  // 이 자식의 perf 카운터 fd (-1이면 없음)
+  int ns_fd;          // --ns=pid: init이 작업 프로세스의 종료 상태를 보내는 파이프 (-1이면 없음)
+  int ns_status;      // 그 파이프에서 받은 종료 상태 (-1이면 아직 없음)
+  int ns_marked;      // 그 파이프에서 손자 fork 알림을 이미 읽었으면 1
+  int sample_slot;    // 샘플러 칸 번호 + 1 (0이면 추적하지 않음)
+};
+
+// 단계별 지연 시간 분포
+static struct lat_hist h_fork;   // fork() 호출 자체
+static struct lat_hist h_exec;   // fork 반환 → exec 완료
+static struct lat_hist h_ready;  // exec 완료 → child_work 시작
+static struct lat_hist h_total;  // fork 호출 → child_work 시작
+static int exec_failures = 0;
+
+// EINTR에 안전한 read()
+static ssize_t read_full(int fd, void* buf, size_t len) {
+  size_t got = 0;
+  while (got < len) {
+    ssize_t n = read(fd, (char*)buf + got, len - got);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    got += (size_t)n;
+  }
+  return (ssize_t)got;
+}
+
+/*
+ * 새 PID 네임스페이스의 init (--ns=pid)
+ *
+ * clone3(CLONE_NEWPID)로 만든 자식은 네임스페이스 안에서 PID 1(init)이 되고,
+ * 커널은 init이 핸들러를 걸지 않은 시그널을 버립니다. (--timeout-ms의 SIGALRM도,
+ * --crash의 raise(SIGSEGV)도, 바깥에서 보낸 SIGTERM도 모두 무시됨)
+ * 그래서 init은 한 번 더 fork해서 실제 작업은 손자(PID 2)에게 맡기고, 자기는
+ * - 받은 시그널을 손자에게 넘겨 주고
+ * - 고아가 된 프로세스를 수거하다가
+ * - 손자가 끝나면 그 종료 상태를 파이프로 부모에게 보낸 뒤 끝납니다.
+ * init 자신은 시그널로 죽을 수 없으므로, 부모는 init의 종료 상태 대신 파이프로 받은 값을 씁니다.
+ * 파이프에는 손자를 fork한 직후 알림(int 하나)을 먼저 쓰므로, 부모는 perf 카운터와 샘플러를
+ * init이 아니라 손자에게 붙일 수 있습니다. (init은 exec하지 않으므로 init에 붙이면 아무것도 못 셈)
+ */
+static pid_t ns_worker = 0;  // init 안에서: 실제 작업을 하는 손자의 PID
+
+static void ns_forward_signal(int sig) {
+  if (ns_worker > 0) kill(ns_worker, sig);
+}
+
+// 자식(새 네임스페이스 안, exec 전)에서 호출. 손자에서는 0을 반환하고, init은 돌아오지 않음
+static int ns_init_fork(int relay_fd, const int* fds, int nfds) {
+  pid_t w = fork();
+  if (w < 0) return -1;
+  if (w == 0) {
+    close(relay_fd);
+    return 0;
+  }
+
+  // init: 손자가 쓸 파이프와 공유 메모리는 닫아야 부모가 EOF로 exec/종료를 알 수 있음
+  ns_worker = w;
+  if (write(relay_fd, &w, sizeof(w)) < 0) { /* 부모는 init에 그대로 붙임 */ }
+  for (int k = 0; k < nfds; ++k) {
+    if (fds[k] >= 0) close(fds[k]);
+  }
+  static const int fwd[] = { SIGTERM, SIGINT, SIGHUP, SIGQUIT, SIGUSR1, SIGUSR2 };
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = ns_forward_signal;
+  sigemptyset(&sa.sa_mask);
+  for (size_t k = 0; k < sizeof(fwd) / sizeof(fwd[0]); ++k) sigaction(fwd[k], &sa, NULL);
+
+  int status = 0;
+  for (;;) {
+    int st;
+    pid_t p = waitpid(-1, &st, 0);
+    if (p == w) {
+      status = st;
+      break;
+    }
+    if (p < 0 && errno != EINTR) {
+      status = 127 << 8;
+      break;
+    }
+  }
+  if (write(relay_fd, &status, sizeof(status)) < 0) { /* 부모는 init의 종료 상태를 씀 */ }
+  _exit(WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+}
+
+// 부모: waitpid로 받은 상태 대신 쓸 실제 종료 상태 (--ns=pid면 init이 보낸 손자의 상태)
+static int child_real_status(struct child_rec* rec, int status) {
+  if (rec->ns_fd >= 0) {
+    int s;
+    // 손자 fork 알림을 아직 읽지 않았으면 먼저 건너뜀 (알림도 없으면 init이 fork 전에 끝난 것)
+    if (rec->ns_marked || read_full(rec->ns_fd, &s, sizeof(s)) == (ssize_t)sizeof(s)) {
+      if (read_full(rec->ns_fd, &s, sizeof(s)) == (ssize_t)sizeof(s)) rec->ns_status = s;
+    }
+    close(rec->ns_fd);
+    rec->ns_fd = -1;
+  }
+  return rec->ns_status >= 0 ? rec->ns_status : status;
+}
+
+/*
+ * 부모: init(pid)이 fork한 손자의 바깥 네임스페이스 PID
+ *
+ * init이 보낸 fork 알림을 기다린 뒤 /proc/PID/task/PID/children에서 읽습니다.
+ * (네임스페이스 안의 PID는 바깥에서 쓸 수 없음) 알 수 없으면 pid를 그대로 돌려줌
+ */
+static pid_t ns_worker_pid(struct child_rec* rec, pid_t pid) {
+  int marker;
+  rec->ns_marked = 1;
+  if (read_full(rec->ns_fd, &marker, sizeof(marker)) != (ssize_t)sizeof(marker)) return pid;
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/task/%d/children", (int)pid, (int)pid);
+  FILE* f = fopen(path, "r");
+  int w = 0;
+  if (f == NULL) return pid;
+  if (fscanf(f, "%d", &w) != 1) w = 0;
+  fclose(f);
+  return w > 0 ? (pid_t)w : pid;
+}
+
+/*
+ * 자식 프로세스 하나를 fork + exec로 생성
+ *
+ * 성공하면 0, fork 자체가 실패하면 -1을 반환합니다.
+ * exec 실패 여부는 await_child_ready()에서 알 수 있습니다.
+ */
+static int spawn_child(const char* exe, int idx, struct child_rec* rec) {
+  int err_pipe[2], ready_pipe[2], gate_pipe[2] = { -1, -1 }, ns_pipe[2] = { -1, -1 };
+  int use_gate = n_perf > 0;  // exec 전에 부모가 할 일이 있는지
+  int use_ns_init = (ns_flags & CLONE_NEWPID) != 0;  // 새 PID 네임스페이스면 init을 끼움
+  int slot = rec->slot;       // 호출한 쪽이 정한 슬롯은 유지
+
+  memset(rec, 0, sizeof(*rec));
+  rec->idx = idx;
+  rec->slot = slot;
+  rec->pid = -1;
+  rec->err_fd = rec->ready_fd = -1;
+  rec->ns_fd = rec->ns_status = -1;
+  for (int k = 0; k < PERF_MAX; ++k) rec->perf_fd[k] = -1;
+
+  // 1. 두 파이프 모두 O_CLOEXEC로 생성 (부모의 다른 자식에게 새어 나가지 않도록)
+  if (pipe2(err_pipe, O_CLOEXEC) < 0) {
+    perror("[parent] pipe2 failed");
+    return -1;
+  }
+  if (pipe2(ready_pipe, O_CLOEXEC) < 0) {
+    perror("[parent] pipe2 failed");
+    close(err_pipe[0]);
+    close(err_pipe[1]);
+    return -1;
+  }
+  if (use_gate && pipe2(gate_pipe, O_CLOEXEC) < 0) {
+    perror("[parent] pipe2 failed");
+    close(err_pipe[0]); close(err_pipe[1]);
+    close(ready_pipe[0]); close(ready_pipe[1]);
+    return -1;
+  }
+  if (use_ns_init && pipe2(ns_pipe, O_CLOEXEC) < 0) {
+    perror("[parent] pipe2 failed");
+    close(err_pipe[0]); close(err_pipe[1]);
+    close(ready_pipe[0]); close(ready_pipe[1]);
+    if (use_gate) { close(gate_pipe[0]); close(gate_pipe[1]); }
+    return -1;
+  }
+
+  // 2. fork() 시스템 콜로 프로세스 복제
+  // fork()는 현재 프로세스를 완전히 복사하여 새로운 프로세스 생성
+  // (stdio 버퍼도 복사되므로 미리 비워 두어야 출력이 중복되지 않음)
+  fflush(stdout);
+  uid_t outer_uid = getuid();
+  gid_t outer_gid = getgid();
+  rec->t_fork = now_us();
+  pid_t pid = spawn_fork();  // --ns가 없으면 fork(), 있으면 clone3()
+  rec->t_forked = now_us();
+
+  if (pid < 0) {
+    // fork() 실패 (음수 반환)
+    perror("[parent] fork failed");
+    close(err_pipe[0]); close(err_pipe[1]);
+    close(ready_pipe[0]); close(ready_pipe[1]);
+    if (use_gate) { close(gate_pipe[0]); close(gate_pipe[1]); }
+    if (use_ns_init) { close(ns_pipe[0]); close(ns_pipe[1]); }
+    return -1;
+  }
+
+  if (pid == 0) {
+    // ========== 자식 프로세스 영역 ==========
+    // fork() 후 자식 프로세스에서는 pid가 0으로 반환됨
+    close(err_pipe[0]);
+    close(ready_pipe[0]);
+    if (use_ns_init) close(ns_pipe[0]);
+
+    // 막아 둔 시그널은 exec 후에도 유지되므로 풀어 줌 (데몬은 SIGCHLD/SIGTERM을 막고 signalfd로 받음)
+    sigset_t none;
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, NULL);
+
+    // 부모에게서 물려받은 나머지 fd 정리 (--fd-hygiene)
+    int keep[5] = { err_pipe[1], ready_pipe[1], shm_fd, use_gate ? gate_pipe[0] : -1, ns_pipe[1] };
+    fd_hygiene_apply(keep, 5);
+
+    // ready 파이프 쓰기 끝과 공유 메모리 fd는 exec 후에도 살아 있어야 하므로 FD_CLOEXEC 해제
+    fcntl(ready_pipe[1], F_SETFD, 0);
+    if (shm_fd >= 0) fcntl(shm_fd, F_SETFD, 0);
+
+    // 새 네임스페이스 안이라면 uid/gid 매핑 등 준비 (실패는 exec 실패처럼 부모에게 전달)
+    if (ns_flags && ns_setup_child(outer_uid, outer_gid) < 0) {
+      int e = errno;
+      perror("[child] namespace setup failed");
+      if (write(err_pipe[1], &e, sizeof(e)) < 0) { /* 부모가 EOF로 처리 */ }
+      _exit(127);
+    }
+
+    // 새 PID 네임스페이스면 여기서 init과 작업 프로세스로 나뉨 (아래 준비와 exec는 손자가 함)
+    if (use_ns_init) {
+      int init_closes[5] = { err_pipe[1], ready_pipe[1], shm_fd,
+                             use_gate ? gate_pipe[0] : -1, use_gate ? gate_pipe[1] : -1 };
+      if (ns_init_fork(ns_pipe[1], init_closes, 5) < 0) {
+        int e = errno;
+        perror("[child] fork inside the pid namespace failed");
+        if (write(err_pipe[1], &e, sizeof(e)) < 0) { /* 부모가 EOF로 처리 */ }
+        _exit(127);
+      }
+    }
+
+    // 최소 자식은 스택 한도도 작게 (exec된 프로그램의 스택이 이 이상 자라지 못함)
+    if (minimal) {
+      struct rlimit rl = { MINIMAL_STACK, MINIMAL_STACK };
+      setrlimit(RLIMIT_STACK, &rl);
+    }
+
+    // 실행 시간 제한: ITIMER_REAL 타이머는 exec 후에도 유지되므로 (fork로는 상속 안 됨)
+    // 여기서 걸어 두면 부모가 감시 스레드 없이도 시간을 넘긴 자식은 SIGALRM으로 끝남
+    if (timeout_ms > 0) {
+      struct itimerval it;
+      memset(&it, 0, sizeof(it));
+      it.it_value.tv_sec = timeout_ms / 1000;
+      it.it_value.tv_usec = (timeout_ms % 1000) * 1000;
+      setitimer(ITIMER_REAL, &it, NULL);
+    }
+
+    // 스케줄링 정책 (--sched): exec 후에도 유지됨
+    const struct sched_rule* srule = sched_rule_for(idx);
+    if (srule && sched_apply(srule) < 0) {
+      int e = errno;
+      perror("[child] sched_setattr failed");
+      if (write(err_pipe[1], &e, sizeof(e)) < 0) { /* 부모가 EOF로 처리 */ }
+      _exit(127);
+    }
+
+    // I/O 우선순위와 cgroup (--ioprio, --io-cgroup)
+    if ((n_ioprio_rules > 0 || n_io_cg_rules > 0) && io_isolation_apply(idx) < 0) {
+      int e = errno;
+      perror("[child] I/O isolation setup failed");
+      if (write(err_pipe[1], &e, sizeof(e)) < 0) { /* 부모가 EOF로 처리 */ }
+      _exit(127);
+    }
+
+    // seccomp 필터는 exec 직전에 설치 (exec 후에도 유지되어 child_work()에 적용)
+    if (use_seccomp && seccomp_install() < 0) {
+      int e = errno;
+      perror("[child] seccomp install failed");
+      if (write(err_pipe[1], &e, sizeof(e)) < 0) { /* 부모가 EOF로 처리 */ }
+      _exit(127);
+    }
+
+    if (!quiet) {
+      printf("[child #%d] I'm the child! My PID: %d, Parent PID: %d\n",
+             idx, getpid(), getppid());
+    }
+
+    // 3. exec 계열 함수로 새로운 프로그램 실행
+    // execvp()는 현재 프로세스 이미지를 새로운 프로그램으로 교체
+    char idarg[16], slotarg[24], fdarg[32], shmarg[32];
+    snprintf(idarg, sizeof(idarg), "--id=%d", idx);
+    snprintf(slotarg, sizeof(slotarg), "--slot=%d", slot);
+    snprintf(fdarg, sizeof(fdarg), "--ready-fd=%d", ready_pipe[1]);
+    snprintf(shmarg, sizeof(shmarg), "--shm-fd=%d", shm_fd);
+
+    // 실행할 프로그램의 인수 배열 (NULL로 끝나야 함)
+    char* args[10 + MAX_FWD_ARGS];
+    int n = 0;
+    args[n++] = (char*)exe;  // 프로그램 이름 (기본값: 자기 자신)
+    args[n++] = "--child";   // 자식 모드 플래그
+    args[n++] = idarg;       // 자식 인덱스 (--id=1, --id=2, ...)
+    args[n++] = fdarg;       // 준비 완료 알림 fd
+    if (shm_fd >= 0) args[n++] = shmarg;  // 공유 메모리 fd
+    if (shm_fd >= 0 && slot > 0) args[n++] = slotarg;  // 풀 모드: 인덱스 대신 칸 번호 슬롯
+    for (int k = 0; k < n_fwd_args; ++k) args[n++] = fwd_args[k];  // 작업 옵션
+    if (srule && srule->work) args[n++] = (char*)srule->work_arg;  // 규칙별 작업 (뒤의 것이 이김)
+    if (fail_every > 0 && idx % fail_every == 0) args[n++] = "--fail";
+    if (crash_every > 0 && idx % crash_every == 0) args[n++] = "--crash";
+    args[n] = NULL;          // 배열 끝 표시
+
+    if (!quiet) {
+      printf("[child #%d] Executing: %s %s %s %s\n", idx, args[0], args[1], args[2], args[3]);
+      fflush(stdout);
+    }
+
+    // 부모가 exec 전 준비(perf 카운터 열기 등)를 끝낼 때까지 대기 (EOF가 신호)
+    if (use_gate) {
+      char c;
+      close(gate_pipe[1]);
+      while (read(gate_pipe[0], &c, 1) < 0 && errno == EINTR) {}
+      close(gate_pipe[0]);
+    }
+
+    // execvp() 실행: 성공하면 이 지점으로 돌아오지 않음
+    execvp(args[0], args);
+
+    // execvp()가 실패한 경우에만 여기 도달
+    // 부모가 exit 코드 127을 기다리지 않도록 errno를 err 파이프로 즉시 전달
+    int e = errno;
+    if (write(err_pipe[1], &e, sizeof(e)) < 0) { /* 부모가 EOF로 처리 */ }
+    perror("[child] execvp failed");
+    _exit(127);  // 표준 실패 코드로 즉시 종료
+  }
+
+  // ========== 부모 프로세스 영역 ==========
+  // 자식이 사용할 쓰기 끝은 부모에게 필요 없으므로 닫음
+  // (닫지 않으면 자식이 죽어도 EOF를 받을 수 없음)
+  close(err_pipe[1]);
+  close(ready_pipe[1]);
+  if (use_ns_init) close(ns_pipe[1]);
+  rec->ns_fd = ns_pipe[0];
+
+  // perf 카운터와 샘플러는 실제로 exec할 프로세스에 붙임 (--ns=pid면 init이 아니라 손자)
+  pid_t worker = pid;
+  if (use_ns_init && (n_perf > 0 || sampler.active)) worker = ns_worker_pid(rec, pid);
+
+  // exec 전 준비: perf 카운터를 열고 gate를 닫아 자식을 exec로 보냄
+  if (use_gate) {
+    close(gate_pipe[0]);
+    if (n_perf > 0) perf_open_for(worker, rec->perf_fd);
+    close(gate_pipe[1]);
+  }
+  rec->pid = pid;
+  rec->sample_slot = sampler_track(idx, worker);
+  rec->err_fd = err_pipe[0];
+  rec->ready_fd = ready_pipe[0];
+  return 0;
+}
+
+/*
+ * 자식의 exec 완료와 준비 완료를 차례로 기다림
+ *
+ * 반환값: 자식이 준비 완료를 알렸으면 1, 그 전에 exec 실패나 종료가 있었으면 0
+ */
+static int await_child_ready(struct child_rec* rec) {
+  int e = 0;
+
+  // 1. err 파이프: EOF(0바이트)면 exec 성공, errno가 오면 exec 실패
+  ssize_t n = read_full(rec->err_fd, &e, sizeof(e));
+  rec->t_exec = now_us();
+  close(rec->err_fd);
+  rec->err_fd = -1;
+
+  if (n == (ssize_t)sizeof(e)) {
+    rec->exec_errno = e;
+    exec_failures++;
+    if (!quiet) printf("[parent] Child #%d exec failed: %s (detected in %.1f us, before exit)\n",
+           rec->idx, strerror(e), rec->t_exec - rec->t_forked);
+  } else {
+    // 2. ready 파이프: 자식이 child_work()에 진입하면 1바이트가 도착
+    char c;
+    if (read_full(rec->ready_fd, &c, 1) == 1) {
+      rec->t_ready = now_us();
+      rec->ready = 1;
+    }
+  }
+  close(rec->ready_fd);
+  rec->ready_fd = -1;
+
+  hist_add(&h_fork, rec->t_forked - rec->t_fork);
+  if (rec->exec_errno == 0) hist_add(&h_exec, rec->t_exec - rec->t_forked);
+  if (rec->ready) {
+    hist_add(&h_ready, rec->t_ready - rec->t_exec);
+    hist_add(&h_total, rec->t_ready - rec->t_fork);
+  }
+  return rec->ready;
+}
+
+// 단계별 지연 시간 분포 출력
+static void print_phase_report(void) {
+  printf("\n[parent] Spawn phase latency (%d exec failure(s)):\n", exec_failures);
+  hist_print("fork", &h_fork);
+  hist_print("exec", &h_exec);
+  hist_print("ready", &h_ready);
+  hist_print("total", &h_total);
+}
+
+/*
+ * 작업별 측정값 요약
+ *
+ * 각 자식이 공유 메모리 슬롯에 남긴 측정값(m[0..3])을 모아 최소/평균/최대로 출력합니다.
+ * 예를 들어 alloc 작업이면 자식 하나당 시작 시 메모리 비용이 얼마인지 알 수 있습니다.
+ */
+static struct {
+  int n;
+  double mn[SLOT_METRICS], mx[SLOT_METRICS], sum[SLOT_METRICS];
+} metric_acc;
+
+static struct {
+  int n, nwake;
+  double share, p50, p99, wmax;
+} sched_acc[SCHED_RULES_MAX + 1];  // 규칙 k번, 마지막 칸은 규칙이 없는 기본 클래스
+
+/*
+ * 끝난 자식 하나의 슬롯 값을 누적
+ *
+ * 풀 모드는 슬롯을 --jobs개만 만들어 다음 자식이 다시 쓰므로 자식을 수거할 때마다 부르고 슬롯을 비웁니다.
+ * 다른 모드는 보고 직전에 slots_harvest_all()로 한꺼번에 옮깁니다.
+ */
+static void slot_harvest(int idx, const struct shm_slot* sl) {
+  if (sl->t_end <= 0) return;  // 작업을 끝내지 못한 자식 제외
+  for (int k = 0; k < SLOT_METRICS; ++k) {
+    double v = sl->metric[k];
+    if (metric_acc.n == 0 || v < metric_acc.mn[k]) metric_acc.mn[k] = v;
+    if (metric_acc.n == 0 || v > metric_acc.mx[k]) metric_acc.mx[k] = v;
+    metric_acc.sum[k] += v;
+  }
+  metric_acc.n++;
+
+  const struct sched_rule* r = sched_rule_for(idx);
+  const struct payload* pl = (r && r->work) ? r->work : find_payload(work_name);
+  int k = r ? (int)(r - sched_rules) : n_sched_rules;
+  double run = sl->t_end - sl->t_start;
+  sched_acc[k].share += run > 0 ? sl->cpu_us / run : 0;
+  sched_acc[k].n++;
+  if (pl && pl->fn == work_wakeup && sl->metric[3] > 0) {
+    sched_acc[k].p50 += sl->metric[0];
+    sched_acc[k].p99 += sl->metric[1];
+    if (sl->metric[2] > sched_acc[k].wmax) sched_acc[k].wmax = sl->metric[2];
+    sched_acc[k].nwake++;
+  }
+}
+
+// 풀 모드가 아니면 슬롯 i가 곧 자식 #i+1
+static void slots_harvest_all(void) {
+  if (shm == NULL || (jobs > 1 && !parallel)) return;  // 풀 모드는 수거할 때 이미 옮김
+  for (unsigned int i = 0; i < shm->nslots; ++i) slot_harvest((int)i + 1, &shm->slot[i]);
+}
+
+static void print_metric_report(void) {
+  const struct payload* pl = find_payload(work_name);
+  if (shm == NULL || pl == NULL || pl->metric[0] == NULL) return;
+
+  printf("\n[parent] Per-child %s metrics:\n", pl->name);
+  for (int k = 0; k < SLOT_METRICS && pl->metric[k]; ++k) {
+    int n = metric_acc.n;
+    if (n > 0) {
+      printf("  %-16s n=%-6d min=%12.1f avg=%12.1f max=%12.1f\n",
+             pl->metric[k], n, metric_acc.mn[k], metric_acc.sum[k] / n, metric_acc.mx[k]);
+    }
+  }
+}
+
+/*
+ * 스케줄링 클래스별 결과 (--sched를 줬을 때)
+ *
+ * - cpu share: 작업 시간(t_start..t_end) 동안 자식이 실제로 받은 CPU 비율
+ * - wake p50/p99/max: wakeup 작업을 한 자식의 깨어남 지연 (클래스 안의 평균/최댓값)
+ */
+static void print_sched_report(void) {
+  if (shm == NULL || n_sched_rules == 0) return;
+
+  printf("\n[parent] Scheduling classes:\n");
+  printf("  %-24s %-8s %8s %10s %11s %11s %11s\n", "class", "work", "children", "cpu share",
+         "wake p50", "wake p99", "wake max");
+  for (int k = 0; k <= n_sched_rules; ++k) {
+    const struct sched_rule* r = k < n_sched_rules ? &sched_rules[k] : NULL;
+    const struct payload* pl = (r && r->work) ? r->work : find_payload(work_name);
+    int n = sched_acc[k].n, nwake = sched_acc[k].nwake;
+    if (n == 0) continue;
+    char wake[3][16];
+    if (nwake > 0) {
+      snprintf(wake[0], sizeof(wake[0]), "%.1f us", sched_acc[k].p50 / nwake);
+      snprintf(wake[1], sizeof(wake[1]), "%.1f us", sched_acc[k].p99 / nwake);
+      snprintf(wake[2], sizeof(wake[2]), "%.1f us", sched_acc[k].wmax);
+    } else {
+      for (int j = 0; j < 3; ++j) snprintf(wake[j], sizeof(wake[j]), "-");
+    }
+    printf("  %-24s %-8s %8d %9.1f%% %11s %11s %11s\n", r ? r->desc : "default",
+           pl ? pl->name : "?", n, sched_acc[k].share / n * 100, wake[0], wake[1], wake[2]);
+  }
+}
+
+/*
+ * 종료 상태 집계
+ *
+ * 자식이 수십 개를 넘어가면 자식마다 한 줄씩 찍는 출력은 읽을 수 없고,
+ * 자식마다 기록을 쌓아 두면 10만 개에서는 메모리도 문제가 됩니다.
+ * 그래서 수거(reap)할 때마다 아래 고정 크기 구조체에 누적만 하고 버립니다.
+ *
+ * - 종료 코드별 / 시그널별 개수
+ * - 실행 시간(fork → 수거) 히스토그램
+ * - 이상치: 처음 실패한 자식 몇 개와 가장 오래 걸린 자식 몇 개만 보관
+ *
+ * 이 예제에서 자식의 "정상" 종료 코드는 자신의 인덱스입니다.
+ * 종료 코드는 8비트이므로 인덱스 300인 자식은 300 & 0xff = 44로 끝나야 정상입니다.
+ */
+#define OUTLIER_MAX 8
+
+struct outlier {
+  int idx;            // 자식 인덱스
+  int status;         // waitpid() 상태값
+  double runtime_us;  // fork → 수거까지 걸린 시간
+};
+
+struct exit_agg {
+  unsigned long total;                // 수거한 자식 수
+  unsigned long ok;                   // 기대한 종료 코드로 끝난 자식 수
+  unsigned long bad_code[256];        // 기대와 다른 종료 코드별 개수
+  unsigned long by_signal[65];        // 시그널 번호별 개수
+  unsigned long other;                // 그 밖의 상태
+  unsigned long timed_out;            // --timeout-ms를 넘겨 SIGALRM으로 끝난 자식 수
+  struct lat_hist runtime;            // 실행 시간 분포
+  struct outlier failed[OUTLIER_MAX]; // 처음 실패한 자식들
+  int nfailed;
+  struct outlier slowest[OUTLIER_MAX];  // 가장 오래 걸린 자식들 (순서 없음)
+  int nslowest;
+};
+
+static struct exit_agg agg;
+
+static int expected_exit_code(int idx) {
+  return idx & 0xff;
+}
+
+// exec_errno: exec 실패면 그 errno (127로 끝나므로 인덱스 127인 자식의 정상 종료와 구분해야 함)
+static void agg_add(int idx, int status, int exec_errno, double runtime_us) {
+  struct outlier o = { idx, status, runtime_us };
+  int ok = 0;
+
+  agg.total++;
+  if (WIFEXITED(status)) {
+    if (exec_errno == 0 && WEXITSTATUS(status) == expected_exit_code(idx)) ok = 1;
+    else agg.bad_code[WEXITSTATUS(status)]++;
+  } else if (WIFSIGNALED(status) && WTERMSIG(status) < 65) {
+    agg.by_signal[WTERMSIG(status)]++;
+    if (timeout_ms > 0 && WTERMSIG(status) == SIGALRM) agg.timed_out++;
+  } else {
+    agg.other++;
+  }
+  hist_add(&agg.runtime, runtime_us);
+
+  if (ok) {
+    agg.ok++;
+  } else if (agg.nfailed < OUTLIER_MAX) {
+    agg.failed[agg.nfailed++] = o;
+  }
+
+  // 가장 느린 자식 목록: 가득 찼으면 그중 가장 빠른 것과 교체
+  if (agg.nslowest < OUTLIER_MAX) {
+    agg.slowest[agg.nslowest++] = o;
+  } else {
+    int fastest = 0;
+    for (int k = 1; k < OUTLIER_MAX; ++k) {
+      if (agg.slowest[k].runtime_us < agg.slowest[fastest].runtime_us) fastest = k;
+    }
+    if (runtime_us > agg.slowest[fastest].runtime_us) agg.slowest[fastest] = o;
+  }
+}
+
+static void describe_status(int status, char* out, size_t len) {
+  if (WIFEXITED(status)) snprintf(out, len, "exit %d", WEXITSTATUS(status));
+  else if (WIFSIGNALED(status)) snprintf(out, len, "signal %d (%s)", WTERMSIG(status),
+                                         strsignal(WTERMSIG(status)));
+  else snprintf(out, len, "status 0x%x", status);
+}
+
+static int cmp_outlier_slowest(const void* a, const void* b) {
+  double d = ((const struct outlier*)b)->runtime_us - ((const struct outlier*)a)->runtime_us;
+  return (d > 0) - (d < 0);
+}
+
+// 실행 시간 히스토그램을 2배 간격 구간으로 묶어 막대로 출력
+static void print_runtime_bars(const struct lat_hist* h) {
+  if (h->count == 0) return;
+  int lo = -1, hi = -1;
+  unsigned long per_octave[64] = { 0 }, peak = 0;
+  for (int b = 0; b < HIST_BUCKETS; ++b) {
+    if (h->buckets[b] == 0) continue;
+    int e = b < 4 ? 0 : b / 4;
+    per_octave[e] += h->buckets[b];
+    if (lo < 0) lo = e;
+    hi = e;
+  }
+  for (int e = lo; e <= hi; ++e) {
+    if (per_octave[e] > peak) peak = per_octave[e];
+  }
+  for (int e = lo; e <= hi; ++e) {
+    int width = (int)(40.0 * per_octave[e] / peak + 0.5);
+    printf("  %10.1f ms+ | %-40.*s %lu\n", (double)(1ULL << e) / 1e6, width,
+           "########################################", per_octave[e]);
+  }
+}
+
+static void print_exit_summary(void) {
+  char desc[64];
+
+  printf("\n[parent] Exit summary: %lu reaped, %lu ok, %lu failed\n",
+         agg.total, agg.ok, agg.total - agg.ok);
+  for (int c = 0; c < 256; ++c) {
+    if (agg.bad_code[c]) printf("  unexpected exit code %3d: %lu\n", c, agg.bad_code[c]);
+  }
+  for (int sig = 1; sig < 65; ++sig) {
+    if (agg.by_signal[sig]) printf("  killed by signal %2d (%s): %lu\n",
+                                   sig, strsignal(sig), agg.by_signal[sig]);
+  }
+  if (agg.other) printf("  other status: %lu\n", agg.other);
+  if (agg.timed_out) printf("  timed out (--timeout-ms=%d): %lu\n", timeout_ms, agg.timed_out);
+
+  printf("  runtime (fork -> reap):\n");
+  hist_print("runtime", &agg.runtime);
+  print_runtime_bars(&agg.runtime);
+
+  if (agg.nfailed > 0) {
+    printf("  first %d failure(s):\n", agg.nfailed);
+    for (int k = 0; k < agg.nfailed; ++k) {
+      describe_status(agg.failed[k].status, desc, sizeof(desc));
+      printf("    child #%-7d %-28s (expected exit %d) %.1f ms\n", agg.failed[k].idx, desc,
+             expected_exit_code(agg.failed[k].idx), agg.failed[k].runtime_us / 1e3);
+    }
+  }
+  qsort(agg.slowest, (size_t)agg.nslowest, sizeof(agg.slowest[0]), cmp_outlier_slowest);
+  if (agg.total > OUTLIER_MAX) {
+    printf("  slowest %d:\n", agg.nslowest);
+    for (int k = 0; k < agg.nslowest; ++k) {
+      describe_status(agg.slowest[k].status, desc, sizeof(desc));
+      printf("    child #%-7d %-28s %.1f ms\n", agg.slowest[k].idx, desc,
+             agg.slowest[k].runtime_us / 1e3);
+    }
+  }
+}
+
+/*
+ * PID → 자식 기록 위치 매핑 (열린 주소법 해시 테이블)
+ *
+ * waitpid(-1, ...)은 "아무 자식이나" 끝난 순서대로 돌려주므로,
+ * 돌려받은 PID가 어느 자식인지 상수 시간에 찾기 위해 사용합니다.
+ */
+struct pid_map {
+  pid_t* pids;   // 0이면 빈 칸, -1이면 지워진 칸
+  int* vals;
+  unsigned int mask;
+  unsigned int live;  // 들어 있는 pid 수 (0이 되면 지워진 칸을 한꺼번에 비움)
+};
+
+static int pidmap_init(struct pid_map* m, int capacity) {
+  unsigned int size = 16;
+  while (size < (unsigned int)capacity * 2) size <<= 1;
+  m->pids = calloc(size, sizeof(pid_t));
+  m->vals = calloc(size, sizeof(int));
+  m->mask = size - 1;
+  m->live = 0;
+  return (m->pids && m->vals) ? 0 : -1;
+}
+
+static void pidmap_free(struct pid_map* m) {
+  free(m->pids);
+  free(m->vals);
+}
+
+static void pidmap_put(struct pid_map* m, pid_t pid, int val) {
+  unsigned int s = ((unsigned int)pid * 2654435761u) & m->mask;
+  while (m->pids[s] > 0) s = (s + 1) & m->mask;
+  m->pids[s] = pid;
+  m->vals[s] = val;
+  m->live++;
+}
+
+/*
+ * 찾으면 값을 돌려주고 그 칸을 지움, 없으면 -1
+ *
+ * 지워진 칸(-1)은 탐사를 멈추지 않으므로, 모든 칸이 한 번씩 쓰이고 나면 빈 칸(0)이 없을 수 있습니다.
+ * 그래서 탐사는 표 크기만큼으로 제한하고, 표가 비면 지워진 칸을 모두 빈 칸으로 되돌립니다.
+ */
+static int pidmap_take(struct pid_map* m, pid_t pid) {
+  unsigned int s = ((unsigned int)pid * 2654435761u) & m->mask;
+  for (unsigned int probe = 0; probe <= m->mask && m->pids[s] != 0; ++probe) {
+    if (m->pids[s] == pid) {
+      int val = m->vals[s];
+      m->pids[s] = -1;
+      if (--m->live == 0) memset(m->pids, 0, (m->mask + 1) * sizeof(pid_t));
+      return val;
+    }
+    s = (s + 1) & m->mask;
+  }
+  return -1;
+}
+
+// 찾으면 값, 없으면 -1 (칸은 그대로 둠)
+static int pidmap_get(const struct pid_map* m, pid_t pid) {
+  unsigned int s = ((unsigned int)pid * 2654435761u) & m->mask;
+  for (unsigned int probe = 0; probe <= m->mask && m->pids[s] != 0; ++probe) {
+    if (m->pids[s] == pid) return m->vals[s];
+    s = (s + 1) & m->mask;
+  }
+  return -1;
+}
+
+// 자식 프로세스 종료 상태 분석 및 출력 (집계에도 반영)
+static void report_exit(struct child_rec* rec, int status) {
+  int idx = rec->idx;
+  double perf_vals[PERF_MAX];
+  char perf_line[512] = "";
+
+  status = child_real_status(rec, status);
+  agg_add(idx, status, rec->exec_errno, now_us() - rec->t_fork);
+  sampler_untrack(rec->sample_slot);
+  if (n_perf > 0) {
+    perf_read_close(rec->perf_fd, perf_vals);
+    perf_format(perf_vals, perf_line, sizeof(perf_line));
+  }
+  if (quiet) return;
+
+  if (WIFEXITED(status)) {
+    // 정상 종료: exit() 또는 return으로 종료
+    int exit_code = WEXITSTATUS(status);
+    printf("[parent] Child #%d exited normally with code %d\n", idx, exit_code);
+    if (perf_line[0]) printf("[parent]   perf:%s\n", perf_line);
+  } else if (WIFSIGNALED(status)) {
+    // 시그널에 의한 종료: 강제 종료 등
+    int signal_num = WTERMSIG(status);
+    if (timeout_ms > 0 && signal_num == SIGALRM) {
+      printf("[parent] Child #%d timed out after %d ms (signal %d)\n", idx, timeout_ms, signal_num);
+    } else {
+      printf("[parent] Child #%d was killed by signal %d\n", idx, signal_num);
+    }
+    if (perf_line[0]) printf("[parent]   perf:%s\n", perf_line);
+  } else {
+    // 기타 종료 상황
+    printf("[parent] Child #%d terminated with status 0x%x\n", idx, status);
+  }
+}
+
+/*
+ * 부모: 자식 수만큼 슬롯을 가진 공유 메모리 생성
+ *
+ * memfd는 O_CLOEXEC(MFD_CLOEXEC)로 만들고, 자식 쪽에서만 fork 후 해제하여 넘깁니다.
+ */
+static int shm_create(int nslots) {
+  int fd = memfd_create("proc_demo-shm", MFD_CLOEXEC);
+  if (fd < 0) {
+    perror("[parent] memfd_create failed");
+    return -1;
+  }
+  size_t size = shm_size(nslots);
+  void* p = MAP_FAILED;
+  if (ftruncate(fd, (off_t)size) == 0) {
+    p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if (p == MAP_FAILED) {
+    perror("[parent] shared memory setup failed");
+    close(fd);
+    return -1;
+  }
+  shm = p;
+  shm->nslots = (unsigned int)nslots;
+  shm->go = 0;
+  shm_fd = fd;
+  return 0;
+}
+
+/*
+ * 상주 메모리 보고 (--mem-report)
+ *
+ * 모든 자식이 출발해 작업(보통 sleep) 안에서 잠들어 있는 동안(= 대기 워커 상태)
+ * /proc/PID/smaps_rollup에서 다음 값을 읽습니다.
+ *
+ * - RSS: 물리 메모리에 올라온 페이지 전체 (공유 페이지는 프로세스마다 중복 계산)
+ * - PSS: 공유 페이지를 공유한 프로세스 수로 나눠 더한 값 (모두 더하면 실제 사용량)
+ * - USS: 이 프로세스만 쓰는 페이지 (프로세스를 끝내면 돌려받는 양)
+ *
+ * 수천 개의 대기 워커를 띄워 둘 때 중요한 것은 자식 하나당 USS입니다.
+ */
+struct mem_stat {
+  long n, min, max, sum;
+};
+
+static void mem_stat_add(struct mem_stat* s, long kb) {
+  if (kb < 0) return;
+  if (s->n == 0 || kb < s->min) s->min = kb;
+  if (s->n == 0 || kb > s->max) s->max = kb;
+  s->sum += kb;
+  s->n++;
+}
+
+static void mem_stat_print(const char* name, const struct mem_stat* s) {
+  if (s->n == 0) return;
+  printf("  %-4s n=%-6ld min=%8ld avg=%10.1f max=%8ld total=%10ld kB\n", name, s->n, s->min,
+         (double)s->sum / s->n, s->max, s->sum);
+}
+
+static void print_mem_report(const struct child_rec* recs, int n) {
+  // 모든 자식이 출발 인사를 찍고 작업(sleep)에 들어갈 때까지 잠시 기다림
+  double deadline = now_us() + 1e6;
+  for (int i = 0; i < n; ++i) {
+    if (recs[i].pid <= 0 || !recs[i].ready) continue;
+    while (shm->slot[i].t_start <= 0 && now_us() < deadline) work_sleep_ms(1);
+  }
+
+  struct mem_stat rss, pss, uss;
+  memset(&rss, 0, sizeof(rss));
+  memset(&pss, 0, sizeof(pss));
+  memset(&uss, 0, sizeof(uss));
+  for (int i = 0; i < n; ++i) {
+    if (recs[i].pid <= 0 || !recs[i].ready) continue;
+    mem_stat_add(&rss, smaps_rollup_kb(recs[i].pid, "Rss"));
+    mem_stat_add(&pss, smaps_rollup_kb(recs[i].pid, "Pss"));
+    mem_stat_add(&uss, uss_kb_of(recs[i].pid));
+  }
+  long ppss = smaps_rollup_kb(0, "Pss");
+  printf("\n[parent] Idle memory footprint (%s children):\n", minimal ? "minimal" : "normal");
+  printf("  parent: RSS %ld kB, PSS %ld kB, USS %ld kB\n", smaps_rollup_kb(0, "Rss"), ppss,
+         uss_kb_of(0));
+  mem_stat_print("RSS", &rss);
+  mem_stat_print("PSS", &pss);
+  mem_stat_print("USS", &uss);
+  if (pss.n > 0) {
+    printf("  parent + children PSS: %.1f MB (%.1f kB per child)\n",
+           (ppss + pss.sum) / 1024.0, (double)pss.sum / pss.n);
+  }
+}
+
+/*
+ * 동시 실행 모드 (--parallel)
+ *
+ * 1. 모든 자식을 fork + exec하고 각자 준비 완료를 보낼 때까지 기다림
+ * 2. 전원이 준비되면 시작 배리어를 열어 동시에 작업 시작
+ * 3. 모든 자식을 수거하고, 공유 메모리의 시작/종료 시각으로 확장성을 계산
+ *
+ * 배리어가 없으면 1번 자식은 N번 자식이 fork되기도 전에 작업을 시작하므로
+ * "동시에 돌렸을 때 얼마나 걸리나"를 제대로 잴 수 없습니다.
+ */
+static void run_parallel(const char* exe) {
+  struct child_rec* recs = calloc((size_t)num_children, sizeof(*recs));
+  if (recs == NULL) {
+    perror("[parent] calloc failed");
+    return;
+  }
+
+  // 배리어를 쓰지 않으면 처음부터 출발 상태로 둠
+  if (!use_barrier) shm->go = 1;
+
+  // 1. 모든 자식 생성
+  printf("\n[parent] Spawning %d children in parallel (barrier %s)...\n",
+         num_children, use_barrier ? "on" : "off");
+  double t_begin = now_us();
+  for (int i = 1; i <= num_children; ++i) {
+    if (spawn_child(exe, i, &recs[i - 1]) < 0) recs[i - 1].pid = -1;
+  }
+
+  // 2. 모두 준비될 때까지 대기
+  int nready = 0;
+  for (int i = 0; i < num_children; ++i) {
+    if (recs[i].pid > 0 && await_child_ready(&recs[i])) nready++;
+  }
+  double t_release = now_us();
+  printf("[parent] %d/%d children ready after %.1f ms, releasing barrier\n",
+         nready, num_children, (t_release - t_begin) / 1e3);
+  if (use_barrier) barrier_release();
+  if (mem_report) print_mem_report(recs, num_children);
+
+  // 3. 끝나는 순서대로 모든 자식 수거
+  struct pid_map live;
+  if (pidmap_init(&live, num_children) < 0) {
+    perror("[parent] calloc failed");
+    exit(1);
+  }
+  int nlive = 0;
+  for (int i = 0; i < num_children; ++i) {
+    if (recs[i].pid > 0) {
+      pidmap_put(&live, recs[i].pid, i);
+      nlive++;
+    }
+  }
+  while (nlive > 0) {
+    int status = 0;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) {
+      if (errno == EINTR) continue;
+      perror("[parent] waitpid failed");
+      break;
+    }
+    int i = pidmap_take(&live, pid);
+    if (i < 0) continue;
+    report_exit(&recs[i], status);
+    nlive--;
+  }
+  pidmap_free(&live);
+  double t_done = now_us();
+
+  // 4. 시작 시각 편차와 병렬 확장성 계산
+  struct lat_hist h_skew, h_run;
+  memset(&h_skew, 0, sizeof(h_skew));
+  memset(&h_run, 0, sizeof(h_run));
+  double first_start = 0, last_start = 0, last_end = 0, sum_run = 0;
+  int nrun = 0;
+  for (int i = 0; i < num_children; ++i) {
+    const struct shm_slot* sl = &shm->slot[i];
+    if (sl->t_end <= 0) continue;  // 작업을 끝내지 못한 자식
+    if (nrun == 0 || sl->t_start < first_start) first_start = sl->t_start;
+    if (nrun == 0 || sl->t_start > last_start) last_start = sl->t_start;
+    if (nrun == 0 || sl->t_end > last_end) last_end = sl->t_end;
+    // 배리어를 쓰지 않았다면 첫 자식의 시작 시각을 기준으로 편차를 잼
+    hist_add(&h_skew, sl->t_start - (use_barrier ? t_release : t_begin));
+    hist_add(&h_run, sl->t_end - sl->t_start);
+    sum_run += sl->t_end - sl->t_start;
+    nrun++;
+  }
+
+  printf("\n[parent] Parallel run report (%d children finished work):\n", nrun);
+  hist_print("skew", &h_skew);
+  hist_print("run", &h_run);
+  if (nrun > 0) {
+    double wall = last_end - first_start;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("  start spread (first..last start): %.1f us\n", last_start - first_start);
+    // 각 자식의 작업량은 work_ms이므로 하나씩 실행했다면 nrun * work_ms가 걸렸을 것
+    double serial = (double)nrun * work_ms * 1e3;
+    printf("  work wall time: %.1f ms (serial would be %.1f ms)\n", wall / 1e3, serial / 1e3);
+    printf("  avg child run time: %.1f ms (stretch %.2fx over --work-ms)\n",
+           sum_run / nrun / 1e3, sum_run / nrun / (work_ms * 1e3));
+    printf("  speedup: %.2fx on %ld CPU(s) (parallel efficiency %.0f%%)\n",
+           serial / wall, ncpu, 100.0 * serial / wall / (ncpu < nrun ? ncpu : nrun));
+  }
+  printf("  total time incl. spawn and reap: %.1f ms\n", (t_done - t_begin) / 1e3);
+  free(recs);
+}
+
+/*
+ * 작업 풀 모드 (--jobs=K, K > 1)
+ *
+ * 자식을 한꺼번에 만들지 않고 최대 K개만 살아 있게 유지합니다.
+ * 하나가 끝나면(waitpid(-1)) 그 자리에 다음 자식을 생성하므로
+ * 부모가 들고 있는 기록은 K개뿐이고, 자식 10만 개도 일정한 메모리로 처리됩니다.
+ * 공유 메모리 슬롯도 칸 수(K)만큼만 만들고, 자식 #i 대신 칸 번호로 씁니다. (--slot=N)
+ * 빈 칸을 모두 채운 뒤에 준비 완료를 기다리므로 새로 띄운 자식들의 exec는 서로 겹칩니다.
+ */
+static void run_pool(const char* exe) {
+  struct child_rec* recs = calloc((size_t)jobs, sizeof(*recs));
+  struct pid_map live;
+  if (recs == NULL || pidmap_init(&live, jobs) < 0) {
+    perror("[parent] calloc failed");
+    exit(1);
+  }
+  for (int k = 0; k < jobs; ++k) recs[k].pid = -1;
+
+  // 풀 모드에서는 배리어 없이 준비되는 대로 출발
+  shm->go = 1;
+
+  printf("\n[parent] Running %d children with up to %d at a time...\n", num_children, jobs);
+  double t_begin = now_us();
+  int next = 1, nlive = 0, spawned = 0;
+  while (next <= num_children || nlive > 0) {
+    // 1. 빈 칸이 있으면 다음 자식 생성
+    for (int k = 0; k < jobs && next <= num_children; ++k) {
+      if (recs[k].pid > 0) continue;
+      int idx = next++;
+      memset(&shm->slot[k], 0, sizeof(shm->slot[k]));  // 앞선 자식의 값은 수거할 때 옮김
+      recs[k].slot = k + 1;
+      if (spawn_child(exe, idx, &recs[k]) < 0) {
+        recs[k].pid = -1;
+        continue;
+      }
+      pidmap_put(&live, recs[k].pid, k);
+      nlive++;
+      spawned++;
+    }
+    // err 파이프가 아직 열려 있으면 이번에 띄운 자식 (await_child_ready()가 닫음)
+    for (int k = 0; k < jobs; ++k) {
+      if (recs[k].pid > 0 && recs[k].err_fd >= 0) await_child_ready(&recs[k]);
+    }
+    if (nlive == 0) break;
+
+    // 2. 아무 자식이나 하나 끝나기를 기다렸다가 수거
+    int status = 0;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) {
+      if (errno == EINTR) continue;
+      perror("[parent] waitpid failed");
+      break;
+    }
+    int k = pidmap_take(&live, pid);
+    if (k < 0) continue;
+    report_exit(&recs[k], status);
+    slot_harvest(recs[k].idx, &shm->slot[k]);
+    recs[k].pid = -1;
+    nlive--;
+  }
+  double wall = now_us() - t_begin;
+  printf("[parent] %d children in %.1f ms (%.0f children/s)\n",
+         spawned, wall / 1e3, spawned / (wall / 1e6));
+  pidmap_free(&live);
+  free(recs);
+}
+
+/*
+ * 순차 생성 벤치마크
+ *
+ * 자식을 하나씩 생성 → 준비 완료 → 수거하기를 n번 반복하며
+ * fork 호출부터 준비 완료까지(ready)와 수거까지(reap)의 지연을 잽니다.
+ * 자식의 작업은 0ms이므로 순수한 생성/정리 비용만 남습니다.
+ * 반환값: 준비 완료까지 간 자식 수
+ */
+static int spawn_bench(const char* exe, int n, struct lat_hist* ready, struct lat_hist* reap) {
+  int ok = 0;
+  shm->go = 1;
+  for (int i = 1; i <= n; ++i) {
+    struct child_rec rec = { 0 };  // slot 0: 자식 인덱스와 같은 슬롯
+    if (spawn_child(exe, i, &rec) < 0) continue;
+    if (await_child_ready(&rec)) {
+      hist_add(ready, rec.t_ready - rec.t_fork);
+      ok++;
+    }
+    int status = 0;
+    waitpid(rec.pid, &status, 0);
+    child_real_status(&rec, status);
+    hist_add(reap, now_us() - rec.t_fork);
+    for (int k = 0; k < PERF_MAX; ++k) {
+      if (rec.perf_fd[k] >= 0) close(rec.perf_fd[k]);
+    }
+  }
+  return ok;
+}
+
+// 벤치마크 결과 한 줄 (기준선 대비 증가분 포함)
+static void bench_row(const char* label, int ok, int n, const struct lat_hist* ready,
+                      const struct lat_hist* reap, double base_p50) {
+  if (ok == 0) {
+    printf("  %-22s unavailable (0/%d children became ready)\n", label, n);
+    return;
+  }
+  double p50 = hist_pct(ready, 50);
+  printf("  %-22s %5d/%-5d %10.1f %10.1f %10.1f %+11.1f\n", label, ok, n, p50,
+         hist_pct(ready, 99), hist_pct(reap, 50), base_p50 >= 0 ? p50 - base_p50 : 0.0);
+}
+
+static void bench_header(void) {
+  printf("  %-22s %11s %10s %10s %10s %11s\n", "config", "ready", "ready p50", "ready p99",
+         "reap p50", "vs base p50");
+}
+
+/*
+ * 네임스페이스 종류별 생성 비용 (--ns-bench=N)
+ *
+ * 권한 없는 사용자도 쓸 수 있도록 user 네임스페이스를 기본으로 두고
+ * 나머지를 하나씩 더해 가며 각각이 생성 지연에 얼마나 더하는지 봅니다.
+ * (네트워크 네임스페이스는 정리 비용이 커서 reap 열에서 차이가 두드러집니다)
+ */
+static void run_ns_bench(const char* exe, int n) {
+  static const unsigned long configs[] = {
+    0,
+    CLONE_NEWUSER,
+    CLONE_NEWUSER | CLONE_NEWPID,
+    CLONE_NEWUSER | CLONE_NEWNS,
+    CLONE_NEWUSER | CLONE_NEWNET,
+    CLONE_NEWUSER | CLONE_NEWUTS | CLONE_NEWIPC,
+    CLONE_NEWUSER | CLONE_NEWPID | CLONE_NEWNS | CLONE_NEWNET,
+  };
+  double base_p50 = -1;
+  char label[64];
+
+  printf("\n[parent] Namespace spawn cost, %d sequential children per config (us):\n", n);
+  bench_header();
+  for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); ++c) {
+    struct lat_hist ready, reap;
+    memset(&ready, 0, sizeof(ready));
+    memset(&reap, 0, sizeof(reap));
+    ns_flags = configs[c];
+    ns_describe(ns_flags, label, sizeof(label));
+    int ok = spawn_bench(exe, n, &ready, &reap);
+    bench_row(label, ok, n, &ready, &reap, base_p50);
+    if (c == 0 && ok > 0) base_p50 = hist_pct(&ready, 50);
+  }
+  ns_flags = 0;
+}
+
+/*
+ * seccomp 비용 (--seccomp-bench=N)
+ *
+ * 1. 생성 비용: 필터 없이 / 필터를 설치하고 자식 N개를 하나씩 생성
+ * 2. 시스템 콜 비용: 자식이 getppid()를 반복하는 syscall 작업을 돌려
+ *    필터가 시스템 콜 하나마다 더하는 시간을 비교
+ */
+static double syscall_cost_ns(const char* exe, int n) {
+  struct lat_hist ready, reap;
+  memset(&ready, 0, sizeof(ready));
+  memset(&reap, 0, sizeof(reap));
+  for (int i = 0; i < n; ++i) shm->slot[i].metric[0] = 0;
+  spawn_bench(exe, n, &ready, &reap);
+  double sum = 0;
+  int got = 0;
+  for (int i = 0; i < n; ++i) {
+    if (shm->slot[i].metric[0] > 0) {
+      sum += shm->slot[i].metric[0];
+      got++;
+    }
+  }
+  return got ? sum / got : -1;
+}
+
+static void run_seccomp_bench(const char* exe, int n) {
+  double base_p50 = -1;
+  double cost[2];
+
+  printf("\n[parent] seccomp spawn cost, %d sequential children per config (us):\n", n);
+  bench_header();
+  for (int on = 0; on <= 1; ++on) {
+    struct lat_hist ready, reap;
+    memset(&ready, 0, sizeof(ready));
+    memset(&reap, 0, sizeof(reap));
+    use_seccomp = on;
+    int ok = spawn_bench(exe, n, &ready, &reap);
+    bench_row(on ? "seccomp allowlist" : "none", ok, n, &ready, &reap, base_p50);
+    if (on == 0 && ok > 0) base_p50 = hist_pct(&ready, 50);
+  }
+
+  // 두 번째 단계: 자식 몇 개가 100ms씩 getppid()를 반복 (뒤에 준 옵션이 앞의 것을 덮어씀)
+  static char syscall_args[][16] = { "--work=syscall", "--work-ms=100" };
+  for (size_t k = 0; k < sizeof(syscall_args) / sizeof(syscall_args[0]); ++k) {
+    forward_arg(syscall_args[k]);
+  }
+  int m = n < 5 ? n : 5;
+  for (int on = 0; on <= 1; ++on) {
+    use_seccomp = on;
+    cost[on] = syscall_cost_ns(exe, m);
+  }
+  use_seccomp = 0;
+
+  printf("\n[parent] getppid() cost inside the child, %d children x 100ms:\n", m);
+  printf("  %-22s %10.1f ns/syscall\n", "none", cost[0]);
+  if (cost[1] < 0) {
+    printf("  %-22s unavailable\n", "seccomp allowlist");
+  } else {
+    printf("  %-22s %10.1f ns/syscall (%+.1f ns, %+.1f%%)\n", "seccomp allowlist", cost[1],
+           cost[1] - cost[0], cost[0] > 0 ? (cost[1] / cost[0] - 1) * 100 : 0.0);
+  }
+}
+
+/*
+ * exec → main 지연 (--exec-bench=N)
+ *
+ * 자식 프로그램을 어떤 방식으로 링크했느냐(동적, 정적, static-pie, -z now/lazy)에 따라
+ * exec 직후 동적 링커가 하는 일이 달라집니다. --exec=로 빌드 변형을 골라
+ * 작업 없는 자식 N개를 하나씩 띄우고 단계별 지연을 봅니다.
+ * (ready 단계 = exec 성공 → 자식의 child_work() 시작, 즉 로딩과 libc 초기화 시간)
+ */
+static void run_exec_bench(const char* exe, int n) {
+  struct lat_hist ready, reap;
+  memset(&ready, 0, sizeof(ready));
+  memset(&reap, 0, sizeof(reap));
+  int ok = spawn_bench(exe, n, &ready, &reap);
+  printf("\n[parent] exec-to-main latency for %s, %d/%d children ready (us):\n", exe, ok, n);
+  hist_print("fork", &h_fork);
+  hist_print("exec", &h_exec);
+  hist_print("ready", &h_ready);
+  hist_print("total", &h_total);
+}
+
+/*
+ * I/O 격리 벤치마크 (--io-bench=N)
+ *
+ * 읽기 자식 2개(1, 2번)가 4KB 무작위 읽기 지연을 재는 동안
+ * 쓰기 자식 N개(3번부터)가 디스크에 계속 씁니다. 세 가지 경우를 비교합니다.
+ *
+ *   1. 읽기 자식만
+ *   2. 쓰기 자식과 함께, 격리 없음
+ *   3. 쓰기 자식과 함께, 격리: 쓰기 ioprio idle / 읽기 be/0,
+ *      cgroup io 컨트롤러가 있으면 io.weight 10 대 1000도 함께
+ *
+ * 각 경우는 --work-ms 동안 배리어로 동시에 출발합니다.
+ */
+#define IO_BENCH_READERS 2
+
+struct io_bench_row {
+  const char* label;
+  int readers;
+  double p50, p99, max;   // 읽기 자식들의 p50/p99 평균과 최댓값 (us)
+  double reads;
+  double write_mbps;      // 쓰기 자식들의 합계
+};
+
+static void io_bench_round(const char* exe, int n, struct io_bench_row* row) {
+  struct child_rec* recs = calloc((size_t)n, sizeof(*recs));
+  if (recs == NULL) return;
+  memset(shm->slot, 0, (size_t)n * sizeof(shm->slot[0]));
+  shm->nready = 0;
+  shm->go = 0;
+
+  int made = 0;
+  for (int i = 1; i <= n; ++i) {
+    if (spawn_child(exe, i, &recs[made]) == 0) made++;
+  }
+  for (int i = 0; i < made; ++i) await_child_ready(&recs[i]);
+  barrier_release();
+  for (int i = 0; i < made; ++i) {
+    int status = 0;
+    waitpid(recs[i].pid, &status, 0);
+  }
+  free(recs);
+
+  for (int i = 0; i < n; ++i) {
+    const struct shm_slot* sl = &shm->slot[i];
+    if (i < IO_BENCH_READERS) {
+      if (sl->metric[3] <= 0) continue;
+      row->p50 += sl->metric[0];
+      row->p99 += sl->metric[1];
+      if (sl->metric[2] > row->max) row->max = sl->metric[2];
+      row->reads += sl->metric[3];
+      row->readers++;
+    } else {
+      row->write_mbps += sl->metric[1];
+    }
+  }
+  if (row->readers > 0) {
+    row->p50 /= row->readers;
+    row->p99 /= row->readers;
+  }
+}
+
+static void run_io_bench(const char* exe, int nwriters) {
+  struct io_bench_row rows[3];
+  char label[3][48], range[32];
+  int n = IO_BENCH_READERS + nwriters;
+  memset(rows, 0, sizeof(rows));
+
+  // 읽기 파일은 미리 만들어 둠 (자식이 만들면 그 시간이 측정에 섞임)
+  int fd = io_open_read_file(0);
+  if (fd < 0) {
+    fprintf(stderr, "[parent] io-bench: cannot create read file in %s: %s\n", io_dir, strerror(errno));
+    return;
+  }
+  close(fd);
+
+  snprintf(range, sizeof(range), "1-%d:default:read", IO_BENCH_READERS);
+  sched_parse(range);
+  snprintf(range, sizeof(range), "%d-%d:default:write", IO_BENCH_READERS + 1, n);
+  sched_parse(range);
+
+  printf("\n[parent] I/O isolation: %d readers (4KB O_DIRECT random reads) vs %d writers, %d ms, dir %s\n",
+         IO_BENCH_READERS, nwriters, work_ms, io_dir);
+  snprintf(label[0], sizeof(label[0]), "readers only");
+  rows[0].label = label[0];
+  io_bench_round(exe, IO_BENCH_READERS, &rows[0]);
+
+  snprintf(label[1], sizeof(label[1]), "+%d writers", nwriters);
+  rows[1].label = label[1];
+  io_bench_round(exe, n, &rows[1]);
+
+  // 격리: 쓰기는 idle 클래스, 읽기는 best-effort 최고 수준 (+ cgroup 가중치)
+  snprintf(range, sizeof(range), "1-%d:be/0", IO_BENCH_READERS);
+  ioprio_parse(range);
+  snprintf(range, sizeof(range), "%d-%d:idle", IO_BENCH_READERS + 1, n);
+  ioprio_parse(range);
+  snprintf(range, sizeof(range), "1-%d:weight=1000", IO_BENCH_READERS);
+  io_cgroup_parse(range);
+  snprintf(range, sizeof(range), "%d-%d:weight=10", IO_BENCH_READERS + 1, n);
+  io_cgroup_parse(range);
+  io_cgroup_setup();
+  snprintf(label[2], sizeof(label[2]), "+%d writers, isolated%s", nwriters,
+           io_cg_base[0] ? "" : " (ioprio)");
+  rows[2].label = label[2];
+  io_bench_round(exe, n, &rows[2]);
+  io_cgroup_cleanup();
+  n_ioprio_rules = n_io_cg_rules = n_sched_rules = 0;
+
+  printf("  %-30s %8s %11s %11s %11s %12s\n", "config", "reads", "read p50", "read p99",
+         "read max", "write MB/s");
+  for (int k = 0; k < 3; ++k) {
+    printf("  %-30s %8.0f %8.1f us %8.1f us %8.1f us %12.1f\n", rows[k].label, rows[k].reads,
+           rows[k].p50, rows[k].p99, rows[k].max, rows[k].write_mbps);
+  }
+}
+
+/*
+ * 부모가 fd를 많이 들고 있는 상황 만들기 (--hold-fds=N)
+ *
+ * CLOEXEC 없이 파이프를 열어 둡니다. (정리하지 않으면 모든 자식에게 새어 나감)
+ * 반환값: 지금까지 들고 있는 fd 수
+ */
+static int held_fds = 0;
+
+static int hold_fds(int n) {
+  struct rlimit rl;
+  rlim_t want = (rlim_t)n + 1024;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < want) {
+    rl.rlim_cur = want;
+    if (rl.rlim_max < want) rl.rlim_max = want;  // 하드 한도를 올리려면 권한 필요
+    if (setrlimit(RLIMIT_NOFILE, &rl) < 0) {
+      getrlimit(RLIMIT_NOFILE, &rl);
+      rl.rlim_cur = rl.rlim_max;
+      setrlimit(RLIMIT_NOFILE, &rl);
+    }
+  }
+  while (held_fds + 2 <= n) {
+    int p[2];
+    if (pipe(p) < 0) break;
+    held_fds += 2;
+  }
+  return held_fds;
+}
+
+/*
+ * fd 정리 비용 (--fd-bench=N)
+ *
+ * 부모가 fd를 0, 1만, 10만 개 들고 있을 때 정리 방식(off, cloexec, close)별로
+ * 작업 없는 자식 N개를 하나씩 만들어 생성/수거 지연을 비교합니다.
+ */
+static void run_fd_bench(const char* exe, int n) {
+  static const int held[] = { 0, 10000, 100000 };
+  static const struct { int mode; const char* name; } modes[] = {
+    { FD_HYGIENE_OFF, "off" },
+    { FD_HYGIENE_CLOEXEC, "cloexec" },
+    { FD_HYGIENE_CLOSE, "close" },
+  };
+  int saved = fd_hygiene;
+  char label[48];
+  double base_p50 = -1;
+
+  printf("\n[parent] fd hygiene cost, %d sequential children per config (us):\n", n);
+  bench_header();
+  for (size_t h = 0; h < sizeof(held) / sizeof(held[0]); ++h) {
+    if (hold_fds(held[h]) < held[h]) {
+      printf("  held=%-6d unavailable (could only open %d fds)\n", held[h], held_fds);
+      break;
+    }
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m) {
+      struct lat_hist ready, reap;
+      memset(&ready, 0, sizeof(ready));
+      memset(&reap, 0, sizeof(reap));
+      fd_hygiene = modes[m].mode;
+      snprintf(label, sizeof(label), "held=%d %s", held_fds, modes[m].name);
+      int ok = spawn_bench(exe, n, &ready, &reap);
+      bench_row(label, ok, n, &ready, &reap, base_p50);
+      if (base_p50 < 0 && ok > 0) base_p50 = hist_pct(&ready, 50);
+    }
+  }
+  fd_hygiene = saved;
+}
+
+/*
+ * 스레드 vs 프로세스 비교 모드 (--compare=N)
+ *
+ * 같은 작업(--work)을 N번, 세 가지 방식으로 실행하고 한 표로 비교합니다.
+ *
+ *   thread    : pthread_create (주소 공간 공유, 가장 가벼움)
+ *   fork      : fork만 하고 exec하지 않음 (COW로 부모 페이지 공유)
+ *   fork+exec : 지금까지의 자식 생성 방식 (완전히 새 프로그램 이미지)
+ *
+ * 모든 방식이 같은 계측을 거칩니다:
+ * 1. 생성 호출 직전 시각 → 실행 단위가 시작을 알린 시각 = 생성 비용
+ * 2. N개 모두 시작 배리어에서 대기 중일 때 메모리(PSS/USS) 측정
+ * 3. 배리어를 열고 모두 끝날 때까지의 시간 → 처리량 (units/s)
+ */
+struct compare_row {
+  const char* mode;
+  int units;             // 실제로 만들어진 실행 단위 수
+  int failed;            // 만들지 못했거나 작업이 실패한 실행 단위 수
+  struct lat_hist create;
+  long pss_kb, uss_kb;   // N개 전체의 메모리 (스레드는 프로세스 증가분)
+  double wall_us;        // 첫 생성 호출 → 마지막 수거
+};
+
+// 실행 단위(스레드/fork 자식) 공통 본문: 시작 알림 → 배리어 → 작업 → 종료 기록, 작업이 실패하면 -1
+static int compare_unit(int i) {
+  struct shm_slot* sl = &shm->slot[i];
+  sl->t_ready = now_us();
+  __atomic_add_fetch(&shm->nready, 1, __ATOMIC_RELEASE);
+  futex(&shm->nready, FUTEX_WAKE, 1);
+  barrier_wait();
+  sl->t_start = now_us();
+  int rc = run_payload(sl->metric);
+  sl->t_end = now_us();
+  return rc;
+}
+
+static void* compare_thread_main(void* arg) {
+  return (void*)(long)compare_unit((int)(long)arg);
+}
+
+// 부모: n개가 모두 시작을 알릴 때까지 대기
+static void compare_wait_ready(unsigned int n) {
+  unsigned int v;
+  while ((v = __atomic_load_n(&shm->nready, __ATOMIC_ACQUIRE)) < n) {
+    futex(&shm->nready, FUTEX_WAIT, v);
+  }
+}
+
+static void compare_reset(int n) {
+  memset(shm->slot, 0, (size_t)n * sizeof(shm->slot[0]));
+  shm->nready = 0;
+  shm->go = 0;
+}
+
+static void compare_threads(int n, struct compare_row* row, double* t_create) {
+  pthread_t* th = calloc((size_t)n, sizeof(*th));
+  if (th == NULL) {
+    perror("[parent] calloc failed");
+    exit(1);
+  }
+  long pss0 = smaps_rollup_kb(0, "Pss"), uss0 = uss_kb_of(0);
+  double t0 = now_us();
+  int made = 0;
+  for (int i = 0; i < n; ++i) {
+    t_create[i] = now_us();
+    if (pthread_create(&th[i], NULL, compare_thread_main, (void*)(long)i) != 0) break;
+    made++;
+  }
+  compare_wait_ready((unsigned int)made);
+  row->pss_kb = smaps_rollup_kb(0, "Pss") - pss0;
+  row->uss_kb = uss_kb_of(0) - uss0;
+  barrier_release();
+  row->failed = n - made;
+  for (int i = 0; i < made; ++i) {
+    void* rc = NULL;
+    pthread_join(th[i], &rc);
+    if ((long)rc < 0) row->failed++;
+  }
+  row->wall_us = now_us() - t0;
+  row->units = made;
+  free(th);
+}
+
+static void compare_forks(int n, struct compare_row* row, double* t_create) {
+  pid_t* pids = calloc((size_t)n, sizeof(*pids));
+  if (pids == NULL) {
+    perror("[parent] calloc failed");
+    exit(1);
+  }
+  double t0 = now_us();
+  int made = 0;
+  fflush(stdout);
+  for (int i = 0; i < n; ++i) {
+    t_create[i] = now_us();
+    pid_t pid = fork();
+    if (pid < 0) break;
+    if (pid == 0) _exit(compare_unit(i) < 0 ? 1 : 0);
+    pids[made++] = pid;
+  }
+  compare_wait_ready((unsigned int)made);
+  row->pss_kb = row->uss_kb = 0;
+  for (int i = 0; i < made; ++i) {
+    row->pss_kb += smaps_rollup_kb(pids[i], "Pss");
+    row->uss_kb += uss_kb_of(pids[i]);
+  }
+  barrier_release();
+  row->failed = n - made;
+  for (int i = 0; i < made; ++i) {
+    int status = 0;
+    if (waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      row->failed++;
+    }
+  }
+  row->wall_us = now_us() - t0;
+  row->units = made;
+  free(pids);
+}
+
+static void compare_execs(const char* exe, int n, struct compare_row* row, double* t_create) {
+  struct child_rec* recs = calloc((size_t)n, sizeof(*recs));
+  if (recs == NULL) {
+    perror("[parent] calloc failed");
+    exit(1);
+  }
+  double t0 = now_us();
+  int made = 0;
+  for (int i = 0; i < n; ++i) {
+    if (spawn_child(exe, i + 1, &recs[made]) < 0) break;
+    t_create[i] = recs[made].t_fork;
+    made++;
+  }
+  for (int i = 0; i < made; ++i) await_child_ready(&recs[i]);
+  row->pss_kb = row->uss_kb = 0;
+  for (int i = 0; i < made; ++i) {
+    row->pss_kb += smaps_rollup_kb(recs[i].pid, "Pss");
+    row->uss_kb += uss_kb_of(recs[i].pid);
+  }
+  barrier_release();
+  // exec된 자식은 보통 자식과 같은 규칙으로 끝남 (정상이면 자기 인덱스가 종료 코드)
+  row->failed = n - made;
+  for (int i = 0; i < made; ++i) {
+    int status = 0;
+    if (waitpid(recs[i].pid, &status, 0) < 0) status = -1;
+    else status = child_real_status(&recs[i], status);
+    if (status < 0 || recs[i].exec_errno != 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != expected_exit_code(recs[i].idx)) {
+      row->failed++;
+    }
+  }
+  row->wall_us = now_us() - t0;
+  row->units = made;
+  free(recs);
+}
+
+// 실패한 실행 단위가 있었으면 1
+static int run_compare(const char* exe, int n) {
+  struct compare_row rows[3];
+  double* t_create = calloc((size_t)n, sizeof(double));
+  if (t_create == NULL) {
+    perror("[parent] calloc failed");
+    exit(1);
+  }
+  memset(rows, 0, sizeof(rows));
+  rows[0].mode = "thread";
+  rows[1].mode = "fork";
+  rows[2].mode = "fork+exec";
+
+  printf("\n[parent] Comparing %d x '%s' (%dms) as threads, forks and fork+exec...\n",
+         n, work_name, work_ms);
+  for (int m = 0; m < 3; ++m) {
+    compare_reset(n);
+    if (m == 0) compare_threads(n, &rows[m], t_create);
+    else if (m == 1) compare_forks(n, &rows[m], t_create);
+    else compare_execs(exe, n, &rows[m], t_create);
+    for (int i = 0; i < rows[m].units; ++i) {
+      if (shm->slot[i].t_ready > 0) hist_add(&rows[m].create, shm->slot[i].t_ready - t_create[i]);
+    }
+  }
+
+  printf("\n  %-10s %6s %12s %12s %12s %12s %10s %10s\n", "mode", "units", "create p50",
+         "create p99", "PSS/unit", "USS/unit", "wall ms", "units/s");
+  for (int m = 0; m < 3; ++m) {
+    const struct compare_row* r = &rows[m];
+    int u = r->units > 0 ? r->units : 1;
+    printf("  %-10s %6d %9.1f us %9.1f us %9.1f kB %9.1f kB %10.1f %10.0f\n", r->mode, r->units,
+           hist_pct(&r->create, 50), hist_pct(&r->create, 99), (double)r->pss_kb / u,
+           (double)r->uss_kb / u, r->wall_us / 1e3, r->units / (r->wall_us / 1e6));
+  }
+  printf("  (memory is measured while all units wait at the start barrier;\n"
+         "   thread rows are the growth of the parent process itself)\n");
+  free(t_create);
+  int failed = 0;
+  for (int m = 0; m < 3; ++m) {
+    if (rows[m].failed == 0) continue;
+    printf("[parent] %s: %d of %d unit(s) failed\n", rows[m].mode, rows[m].failed, n);
+    failed = 1;
+  }
+  return failed;
+}
+
+/*
+ * 사용자 공간 파이버(코루틴) 실행기 (--fibers=N)
+ *
+ * 아주 작은 작업에는 스레드도 무겁습니다 (스레드마다 커널 객체 + 8MB 가상 스택).
+ * 파이버는 커널이 모르는 "스택 + 저장된 레지스터"일 뿐이어서, 몇 개의 OS 스레드
+ * 위에서 수백만 개를 협력적으로(cooperative) 번갈아 실행할 수 있습니다.
+ *
+ * - 문맥 전환: x86_64에서는 콜리 저장 레지스터만 스택에 push/pop하는 직접 작성한
+ *   어셈블리 (시그널 마스크를 건드리지 않으므로 시스템 콜이 없음),
+ *   그 밖의 아키텍처에서는 ucontext(swapcontext)를 사용
+ * - 스택: 큰 mmap 덩어리에서 잘라 쓰고, 끝난 파이버의 스택은 풀로 되돌림
+ * - sleep: 자식의 sleep(1)은 "깨어날 시각을 타이머 힙에 넣고 스케줄러로 양보"가 됨
+ *
+ * 가드 페이지가 없으므로 파이버 안에서는 printf처럼 스택을 많이 쓰는 일을 하면 안 됩니다.
+ */
+struct fiber {
+  void* sp;             // 저장된 스택 포인터 (x86_64)
+#ifndef __x86_64__
+  ucontext_t ctx;       // 저장된 문맥 (ucontext 대체 구현)
+#endif
+  char* stack;          // 스택 메모리 (풀에서 할당)
+  double wake_us;       // 타이머 힙 키: 깨어날 시각
+  double t_start;       // 작업 시작 시각
+  int idx;              // 파이버 번호
+  int done;             // 작업이 끝났으면 1
+};
+
+struct stack_pool {
+  char* chunk;          // 현재 잘라 쓰고 있는 mmap 덩어리 (맨 앞에 이전 덩어리 주소를 저장)
+  size_t used, cap;
+  void* free_list;      // 반납된 스택 (스택 메모리 안에 다음 포인터를 저장)
+};
+
+struct fsched {
+  void* sp;                  // 스케줄러 자신의 저장된 스택 포인터
+#ifndef __x86_64__
+  ucontext_t ctx;
+#endif
+  struct fiber* cur;         // 지금 실행 중인 파이버
+  struct fiber** runq;       // 실행 가능 큐 (원형 버퍼)
+  size_t rq_head, rq_len, rq_cap;
+  struct fiber** heap;       // 잠든 파이버의 최소 힙 (wake_us 기준)
+  size_t nheap;
+  struct stack_pool pool;
+  struct lat_hist late;      // 목표 시각보다 늦게 깨어난 정도
+  long yields;               // 스위치 벤치마크용 양보 횟수
+};
+
+static __thread struct fsched* fs_cur;    // 이 OS 스레드의 스케줄러
+static unsigned int fibers_started = 0;   // 작업을 시작한 파이버 수 (모든 스레드 합계)
+static unsigned int fiber_workers_done = 0;  // 스케줄러 루프를 마친 OS 스레드 수
+
+#ifdef __x86_64__
+/*
+ * void fiber_switch(void** save_sp, void* new_sp)
+ * 현재 콜리 저장 레지스터를 스택에 넣고 rsp를 save_sp에 저장한 뒤,
+ * new_sp 스택에서 레지스터를 꺼내고 ret으로 그쪽 실행을 이어 감
+ */
+__asm__(
+  ".text\n"
+  ".type pd_fiber_switch, @function\n"
+  "pd_fiber_switch:\n"
+  "  pushq %rbp\n  pushq %rbx\n  pushq %r12\n  pushq %r13\n  pushq %r14\n  pushq %r15\n"
+  "  movq %rsp, (%rdi)\n"
+  "  movq %rsi, %rsp\n"
+  "  popq %r15\n  popq %r14\n  popq %r13\n  popq %r12\n  popq %rbx\n  popq %rbp\n"
+  "  ret\n"
+  ".size pd_fiber_switch, .-pd_fiber_switch\n");
+void pd_fiber_switch(void** save_sp, void* new_sp);
+#endif
+
+static char* stack_alloc(struct stack_pool* p) {
+  if (p->free_list) {
+    char* s = p->free_list;
+    p->free_list = *(void**)s;
+    return s;
+  }
+  if (p->chunk == NULL || p->used + fiber_stack > p->cap) {
+    // 64MB씩 예약만 해 두고 (MAP_NORESERVE), 실제 메모리는 쓰는 페이지만 할당됨
+    size_t cap = (64UL << 20) / fiber_stack * fiber_stack;
+    char* chunk = mmap(NULL, cap, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (chunk == MAP_FAILED) return NULL;
+    *(char**)chunk = p->chunk;     // 덩어리 목록 연결 (첫 스택 한 칸은 머리로 사용)
+    p->chunk = chunk;
+    p->cap = cap;
+    p->used = fiber_stack;
+  }
+  char* s = p->chunk + p->used;
+  p->used += fiber_stack;
+  return s;
+}
+
+static void stack_free(struct stack_pool* p, char* s) {
+  *(void**)s = p->free_list;
+  p->free_list = s;
+}
+
+static void stack_pool_destroy(struct stack_pool* p) {
+  while (p->chunk) {
+    char* prev = *(char**)p->chunk;
+    munmap(p->chunk, p->cap);
+    p->chunk = prev;
+  }
+  p->free_list = NULL;
+}
+
+static void fsched_runq_push(struct fsched* s, struct fiber* f) {
+  s->runq[(s->rq_head + s->rq_len) % s->rq_cap] = f;
+  s->rq_len++;
+}
+
+static struct fiber* fsched_runq_pop(struct fsched* s) {
+  struct fiber* f = s->runq[s->rq_head];
+  s->rq_head = (s->rq_head + 1) % s->rq_cap;
+  s->rq_len--;
+  return f;
+}
+
+static void fsched_heap_push(struct fsched* s, struct fiber* f) {
+  size_t i = s->nheap++;
+  while (i > 0 && s->heap[(i - 1) / 2]->wake_us > f->wake_us) {
+    s->heap[i] = s->heap[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  s->heap[i] = f;
+}
+
+static struct fiber* fsched_heap_pop(struct fsched* s) {
+  struct fiber* top = s->heap[0];
+  struct fiber* last = s->heap[--s->nheap];
+  size_t i = 0;
+  for (;;) {
+    size_t c = 2 * i + 1;
+    if (c >= s->nheap) break;
+    if (c + 1 < s->nheap && s->heap[c + 1]->wake_us < s->heap[c]->wake_us) c++;
+    if (last->wake_us <= s->heap[c]->wake_us) break;
+    s->heap[i] = s->heap[c];
+    i = c;
+  }
+  if (s->nheap > 0) s->heap[i] = last;
+  return top;
+}
+
+// 파이버 → 스케줄러로 전환
+static void fiber_to_sched(void) {
+  struct fsched* s = fs_cur;
+#ifdef __x86_64__
+  pd_fiber_switch(&s->cur->sp, s->sp);
+#else
+  swapcontext(&s->cur->ctx, &s->ctx);
+#endif
+}
+
+// 스케줄러 → 파이버로 전환
+static void sched_to_fiber(struct fsched* s, struct fiber* f) {
+  s->cur = f;
+#ifdef __x86_64__
+  pd_fiber_switch(&s->sp, f->sp);
+#else
+  swapcontext(&s->ctx, &f->ctx);
+#endif
+}
+
+// 파이버용 sleep: 타이머 힙에 넣고 양보 (OS 스레드는 다른 파이버를 실행)
+static void fiber_sleep(int ms) {
+  struct fsched* s = fs_cur;
+  s->cur->wake_us = now_us() + ms * 1e3;
+  fsched_heap_push(s, s->cur);
+  fiber_to_sched();
+}
+
+// 파이버용 yield: 실행 큐 맨 뒤로 가서 양보
+static void fiber_yield(void) {
+  struct fsched* s = fs_cur;
+  fsched_runq_push(s, s->cur);
+  fiber_to_sched();
+}
+
+// child_work()와 같은 모양의 파이버 작업: 시작 기록 → sleep → 종료
+static void fiber_task(struct fiber* f) {
+  f->t_start = now_us();
+  __atomic_add_fetch(&fibers_started, 1, __ATOMIC_RELAXED);
+  fiber_sleep(work_ms);
+}
+
+// 스위치 지연 측정용 작업: 양보만 반복
+static long fiber_switch_rounds = 0;
+
+static void fiber_pingpong(struct fiber* f) {
+  (void)f;
+  for (long k = 0; k < fiber_switch_rounds; ++k) {
+    fs_cur->yields++;
+    fiber_yield();
+  }
+}
+
+static void (*fiber_body)(struct fiber*) = fiber_task;
+
+// 모든 파이버의 시작 지점: 작업을 실행하고 끝났다고 표시한 뒤 다시는 돌아오지 않음
+static void fiber_entry(void) {
+  struct fsched* s = fs_cur;
+  fiber_body(s->cur);
+  s->cur->done = 1;
+  fiber_to_sched();
+}
+
+static int fiber_init(struct fsched* s, struct fiber* f, int idx) {
+  f->idx = idx;
+  f->done = 0;
+  f->stack = stack_alloc(&s->pool);
+  if (f->stack == NULL) return -1;
+#ifdef __x86_64__
+  // 스택 꼭대기에 fiber_entry를 "돌아갈 주소"로 두고 레지스터 6개 자리를 0으로 채움
+  // (ret 직후 rsp ≡ 8 (mod 16)이 되도록 정렬: 일반 함수 호출 직후와 같은 상태)
+  unsigned long top = ((unsigned long)(f->stack + fiber_stack)) & ~15UL;
+  void** sp = (void**)(top - 16);
+  sp[0] = (void*)fiber_entry;
+  sp[1] = NULL;
+  sp -= 6;
+  memset(sp, 0, 6 * sizeof(void*));
+  f->sp = sp;
+#else
+  getcontext(&f->ctx);
+  f->ctx.uc_stack.ss_sp = f->stack;
+  f->ctx.uc_stack.ss_size = fiber_stack;
+  f->ctx.uc_link = NULL;
+  makecontext(&f->ctx, fiber_entry, 0);
+#endif
+  return 0;
+}
+
+/*
+ * OS 스레드 하나의 스케줄러 루프
+ *
+ * 실행 큐가 비면 타이머 힙에서 시간이 된 파이버를 꺼내고,
+ * 그래도 없으면 가장 이른 깨어날 시각까지 잠듭니다 (바쁜 대기 없음).
+ */
+struct fiber_worker {
+  pthread_t th;
+  int first, count;         // 이 스레드가 맡은 파이버 번호 범위
+  struct fiber* fibers;
+  struct fsched sched;
+  double t_created;         // 파이버 생성을 마친 시각
+  size_t stack_hiwater;     // 표본 파이버의 스택 최대 사용량
+  int completed;            // 끝까지 실행된 파이버 수
+};
+
+static void* fiber_worker_main(void* arg) {
+  struct fiber_worker* w = arg;
+  struct fsched* s = &w->sched;
+  fs_cur = s;
+  s->rq_cap = (size_t)w->count + 1;
+  s->runq = calloc(s->rq_cap, sizeof(*s->runq));
+  s->heap = calloc((size_t)w->count + 1, sizeof(*s->heap));
+  w->fibers = calloc((size_t)w->count, sizeof(*w->fibers));
+  int live = 0;
+  if (!s->runq || !s->heap || !w->fibers) {
+    fprintf(stderr, "[parent] fiber worker: out of memory for %d fibers\n", w->count);
+    goto out;  // 부모가 끝나기를 기다리고 있으므로 완료 표시는 반드시 남김
+  }
+
+  for (int k = 0; k < w->count; ++k) {
+    if (fiber_init(s, &w->fibers[k], w->first + k) < 0) {
+      fprintf(stderr, "[parent] fiber worker: stack allocation failed after %d fibers\n", k);
+      break;
+    }
+    // 첫 파이버의 스택만 무늬로 칠해 두고 나중에 얼마나 썼는지 확인 (전부 칠하면 RSS가 늘어남)
+    if (k == 0) memset(w->fibers[k].stack + 64, 0xA5, fiber_stack - 64 - 80);
+    fsched_runq_push(s, &w->fibers[k]);
+    live++;
+  }
+  w->t_created = now_us();
+
+  while (live > 0) {
+    if (s->rq_len == 0) {
+      if (s->nheap == 0) break;
+      double now = now_us();
+      if (s->heap[0]->wake_us > now) {
+        double wait = s->heap[0]->wake_us - now;
+        struct timespec ts;
+        ts.tv_sec = (time_t)(wait / 1e6);
+        ts.tv_nsec = (long)((wait - ts.tv_sec * 1e6) * 1e3);
+        nanosleep(&ts, NULL);
+        now = now_us();
+      }
+      while (s->nheap > 0 && s->heap[0]->wake_us <= now) {
+        struct fiber* f = fsched_heap_pop(s);
+        hist_add(&s->late, now - f->wake_us);
+        fsched_runq_push(s, f);
+      }
+      continue;
+    }
+    struct fiber* f = fsched_runq_pop(s);
+    sched_to_fiber(s, f);
+    if (f->done) {
+      stack_free(&s->pool, f->stack);
+      live--;
+      w->completed++;
+    }
+  }
+
+  // 표본 스택에서 무늬가 지워진 가장 낮은 주소 = 최대 사용 깊이 (스택을 못 받았으면 건너뜀)
+  if (w->count > 0 && w->fibers[0].stack != NULL) {
+    char* st = w->fibers[0].stack;
+    size_t untouched = 64;
+    while (untouched < fiber_stack - 80 && (unsigned char)st[untouched] == 0xA5) untouched++;
+    w->stack_hiwater = fiber_stack - untouched;
+  }
+
+out:
+  free(s->runq);
+  free(s->heap);
+  free(w->fibers);
+  stack_pool_destroy(&s->pool);
+  __atomic_add_fetch(&fiber_workers_done, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+static long statm_rss_kb(void) {
+  long size = 0, rss = 0;
+  FILE* f = fopen("/proc/self/statm", "r");
+  if (f) {
+    if (fscanf(f, "%ld %ld", &size, &rss) != 2) rss = 0;
+    fclose(f);
+  }
+  return rss * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// 스레드를 만들지 못하면 거기서 멈추고, 만든 스레드만 기다림 (그 뒤의 파이버는 실행되지 않음)
+static double run_fiber_workers(int n, int nthreads, struct fiber_worker* w, long* rss_delta) {
+  long rss0 = statm_rss_kb();
+  double t0 = now_us();
+  int made = 0;
+  __atomic_store_n(&fibers_started, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&fiber_workers_done, 0, __ATOMIC_RELAXED);
+  for (int t = 0; t < nthreads; ++t) {
+    w[t].first = n / nthreads * t + (t < n % nthreads ? t : n % nthreads);
+    w[t].count = n / nthreads + (t < n % nthreads);
+    int rc = pthread_create(&w[t].th, NULL, fiber_worker_main, &w[t]);
+    if (rc != 0) {
+      fprintf(stderr, "[parent] fiber worker %d: pthread_create failed: %s\n", t, strerror(rc));
+      break;
+    }
+    made++;
+  }
+  // 모든 파이버가 시작해서 잠든 상태일 때 메모리를 잼
+  if (rss_delta) {
+    while (__atomic_load_n(&fibers_started, __ATOMIC_RELAXED) < (unsigned int)n &&
+           __atomic_load_n(&fiber_workers_done, __ATOMIC_ACQUIRE) < (unsigned int)made) {
+      work_sleep_ms(1);
+    }
+    *rss_delta = statm_rss_kb() - rss0;
+  }
+  for (int t = 0; t < made; ++t) pthread_join(w[t].th, NULL);
+  return now_us() - t0;
+}
+
+// 반환값: 모든 파이버가 끝까지 실행되었으면 0, 아니면 1
+static int run_fibers(int n, int nthreads) {
+  if (nthreads < 1) nthreads = 1;
+  struct fiber_worker* w = calloc((size_t)nthreads, sizeof(*w));
+  if (w == NULL) return 1;
+
+  printf("\n[parent] Running %d fibers (sleep %dms each) on %d OS thread(s), %zu-byte stacks...\n",
+         n, work_ms, nthreads, fiber_stack);
+
+  // 1. 본 실험: n개의 파이버가 동시에 sleep
+  long rss_delta = 0;
+  double t_begin = now_us();
+  fiber_body = fiber_task;
+  double wall = run_fiber_workers(n, nthreads, w, &rss_delta);
+
+  struct lat_hist late;
+  memset(&late, 0, sizeof(late));
+  double last_created = 0;
+  size_t hiwater = 0;
+  int completed = 0;
+  for (int t = 0; t < nthreads; ++t) {
+    completed += w[t].completed;
+    hist_merge(&late, &w[t].sched.late);
+    if (w[t].t_created > last_created) last_created = w[t].t_created;
+    if (w[t].stack_hiwater > hiwater) hiwater = w[t].stack_hiwater;
+  }
+
+  printf("  completed: %d of %d fibers in %.1f ms (ideal %d ms), all created after %.1f ms\n",
+         completed, n, wall / 1e3, work_ms, (last_created - t_begin) / 1e3);
+  printf("  memory: RSS +%ld kB while all were sleeping = %.0f bytes/fiber "
+         "(struct %zu B + stack %zu B reserved, %zu B max used)\n",
+         rss_delta, rss_delta * 1024.0 / n, sizeof(struct fiber), fiber_stack, hiwater);
+  hist_print("wake late", &late);
+
+  // 2. 스위치 지연: 한 스레드에서 파이버 2개가 서로 양보만 반복
+  struct fiber_worker pw;
+  memset(&pw, 0, sizeof(pw));
+  fiber_switch_rounds = 1000000;
+  fiber_body = fiber_pingpong;
+  double t = run_fiber_workers(2, 1, &pw, NULL);
+  // 양보 한 번 = 파이버→스케줄러, 스케줄러→다음 파이버 = 스위치 2번
+  if (pw.completed == 2) {
+    printf("  switch latency: %.1f ns per context switch (%ld yields in %.1f ms)\n",
+           t * 1e3 / (2.0 * pw.sched.yields), pw.sched.yields, t / 1e3);
+  } else {
+    printf("  switch latency: unavailable (ping-pong fibers did not run)\n");
+  }
+  free(w);
+  return completed == n && pw.completed == 2 ? 0 : 1;
+}
+
+/*
+ * 데몬 모드 (--daemon=SOCK)와 제어 클라이언트 (--ctl=SOCK 명령 ...)
+ *
+ * 데몬은 유닉스 도메인 소켓을 열어 두고 스레드 없이 epoll 루프 하나로 모든 일을 처리합니다:
+ * - 연결 수락과 요청 처리 (연결마다 입출력 버퍼를 둔 논블로킹 소켓)
+ * - 자식 준비 완료 (ready 파이프를 epoll에 넣으므로 exec를 기다리며 멈추지 않음)
+ * - 자식 종료 (SIGCHLD를 signalfd로 받아 waitpid(WNOHANG)로 한꺼번에 수거)
+ *
+ * 프로토콜은 고정 길이 이진 메시지(요청 16바이트, 응답 32바이트)입니다.
+ * 클라이언트는 응답을 기다리지 않고 요청을 이어 보낼 수 있고(파이프라이닝),
+ * 응답은 요청 순서대로 돌아오며 seq로 짝을 맞춥니다.
+ *
+ *   spawn [WORK [MS]]   자식 하나 생성 (WORK/MS를 빼면 데몬의 --work/--work-ms)
+ *   status [ID]         전체 요약, 또는 자식 하나의 상태 (끝난 자식은 최근 것만 기록이 남음)
+ *   kill ID|all [SIG]   시그널 보내기 (기본값 TERM)
+ *   scale N             워커 그룹을 N개로 맞춤 (끝난 워커는 다시 채움)
+ *   ping                아무 일도 하지 않음 (응답에 데몬 세대와 마지막 재실행 멈춤 시간)
+ *   upgrade             자식을 멈추지 않고 데몬 자신을 다시 exec (아래 "무중단 재실행" 참고)
+ *   bench N [DEPTH]     ping N개를 DEPTH개씩 이어 보내 요청 처리량 측정 (클라이언트 전용)
+ *   shutdown            모든 자식에게 SIGTERM을 보내고, 다 수거하면 종료
+ */
+#define CTL_MAGIC 0x5044        // "PD"
+#define DAEMON_MAX_LIVE 4096    // 동시에 살아 있을 수 있는 자식 수
+#define DAEMON_KEEP_EXITED 256  // status로 물어볼 수 있게 남겨 두는 끝난 자식 기록 수
+#define DAEMON_MAX_RECS (DAEMON_MAX_LIVE + DAEMON_KEEP_EXITED)  // 자식 기록 표의 최대 크기
+#define DAEMON_MAX_CONNS 64
+#define CTL_BUF 4096
+
+enum { CTL_PING = 1, CTL_SPAWN, CTL_STATUS, CTL_KILL, CTL_SCALE, CTL_SHUTDOWN, CTL_UPGRADE };
+
+struct ctl_req {
+  uint16_t magic;  // CTL_MAGIC
+  uint8_t op;      // CTL_*
+  uint8_t sub;     // spawn: payloads[] 번호 + 1 (0이면 기본값), kill: 시그널 (0이면 SIGTERM)
+  uint32_t seq;    // 응답에 그대로 돌려줌
+  uint32_t id;     // 자식 번호 (0이면 전체)
+  int32_t arg;     // spawn: 작업 시간 ms (음수면 기본값), scale: 워커 수
+};
+
+struct ctl_resp {
+  uint32_t seq;
+  int32_t err;     // 0이면 성공, 아니면 errno
+  uint32_t v[6];   // 요청별 결과 (ctl_print() 참고)
+};
+
+_Static_assert(sizeof(struct ctl_req) == 16, "ctl_req must stay 16 bytes");
+_Static_assert(sizeof(struct ctl_resp) == 32, "ctl_resp must stay 32 bytes");
+
+// epoll 이벤트의 data.u64: 위 32비트는 종류, 아래 32비트는 번호
+enum { EV_LISTEN = 1, EV_SIGNAL, EV_CONN, EV_READY };
+#define EV_TAG(type, i) (((uint64_t)(type) << 32) | (uint32_t)(i))
+
+enum { DCH_STARTING, DCH_RUNNING, DCH_EXITED };
+static const char* const dch_state_names[] = { "starting", "running", "exited" };
+
+struct dchild {
+  int id;          // 자식 번호 (0이면 빈 칸)
+  int next;        // 끝난 기록 목록이나 빈 칸 목록에서 다음 칸 (-1이면 끝)
+  struct child_rec rec;
+  int pidfd;       // PID 재사용에 안전한 시그널용 (pidfd_open, 없으면 -1)
+  int state;       // DCH_*
+  int worker;      // 워커 그룹 소속이면 1
+  int stopping;    // scale로 줄이는 중이면 1 (다시 채우지 않음)
+  int status;      // 수거한 종료 상태
+  double t_reaped;
+};
+
+struct ctl_conn {
+  int fd;
+  unsigned int events;  // 지금 epoll에 걸어 둔 이벤트
+  size_t in_len, out_len;
+  char in[CTL_BUF];
+  char out[CTL_BUF * 2];
+};
+
+static struct {
+  int epfd, listen_fd, sig_fd;
+  struct dchild* ch;     // 자식 기록 표 (끝난 기록은 오래된 것부터 재사용, 최대 DAEMON_MAX_RECS칸)
+  int n;                 // 지금까지 만든 자식 수 (= 마지막 자식 번호)
+  int used, cap;         // 한 번이라도 쓴 칸 수, 배열 크기
+  int free_head;         // 빈 칸 목록 (-1이면 없음)
+  int done_head, done_tail, ndone;  // 끝난 기록 목록, 오래된 것이 앞 (-1이면 없음)
+  struct pid_map ids;    // 자식 번호 → ch[] 위치
+  struct pid_map live;   // PID → ch[] 위치
+  int nlive;             // 수거하지 않은 자식 수
+  int workers, target;   // 살아 있는 (줄이는 중이 아닌) 워커 수, 목표 수
+  int shutting_down;
+  int upgrade;           // 이번 이벤트 처리가 끝나면 다시 exec
+  int generation;        // 재실행할 때마다 1씩 증가
+  double t_started;      // 처음 데몬이 시작한 시각 (재실행해도 유지)
+  double last_pause_us;  // 마지막 재실행의 멈춤 시간
+  unsigned long requests;
+  unsigned long orphans;  // 서브리퍼로서 넘겨받아 수거한 손자 프로세스 (자식이 남기고 죽은 프로세스)
+  struct ctl_conn* conns[DAEMON_MAX_CONNS];
+} dmn;
+
+// 자식을 가리키는 pidfd (커널이 지원하지 않으면 -1, 그때는 PID로 시그널을 보냄)
+static int open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+  return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+  (void)pid;
+  return -1;
+#endif
+}
+
+static int epoll_set(int op, int fd, unsigned int events, uint64_t tag) {
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events;
+  ev.data.u64 = tag;
+  return epoll_ctl(dmn.epfd, op, fd, &ev);
+}
+
+/*
+ * 데몬: 자식 기록 표 관리
+ *
+ * 오래 도는 데몬이 만든 자식마다 기록을 하나씩 쌓으면 메모리와 전체 순회 비용이
+ * 끝없이 늘어납니다. 그래서 수거한 자식의 기록은 "끝난 목록" 뒤에 붙여 두었다가
+ * DAEMON_KEEP_EXITED개를 넘으면 가장 오래된 것부터 빈 칸 목록으로 돌려 재사용합니다.
+ * 표는 살아 있는 자식 수 + 남겨 둘 끝난 기록 수보다 커지지 않습니다.
+ */
+static int daemon_slot_alloc(void) {
+  if (dmn.free_head >= 0) {
+    int i = dmn.free_head;
+    dmn.free_head = dmn.ch[i].next;
+    return i;
+  }
+  if (dmn.used == dmn.cap) {
+    if (dmn.cap >= DAEMON_MAX_RECS) return -1;
+    int cap = dmn.cap ? dmn.cap * 2 : 256;
+    if (cap > DAEMON_MAX_RECS) cap = DAEMON_MAX_RECS;
+    struct dchild* ch = realloc(dmn.ch, (size_t)cap * sizeof(*ch));
+    if (ch == NULL) return -1;
+    dmn.ch = ch;
+    dmn.cap = cap;
+  }
+  return dmn.used++;
+}
+
+static void daemon_slot_free(int i) {
+  dmn.ch[i].id = 0;
+  dmn.ch[i].next = dmn.free_head;
+  dmn.free_head = i;
+}
+
+// 수거한 자식의 기록을 끝난 목록 뒤에 붙이고, 넘치면 가장 오래된 기록을 빈 칸으로 돌림
+static void daemon_slot_retire(int i) {
+  dmn.ch[i].next = -1;
+  if (dmn.done_tail >= 0) dmn.ch[dmn.done_tail].next = i;
+  else dmn.done_head = i;
+  dmn.done_tail = i;
+  if (++dmn.ndone <= DAEMON_KEEP_EXITED) return;
+
+  int old = dmn.done_head;
+  dmn.done_head = dmn.ch[old].next;
+  if (dmn.done_head < 0) dmn.done_tail = -1;
+  dmn.ndone--;
+  pidmap_take(&dmn.ids, dmn.ch[old].id);
+  daemon_slot_free(old);
+}
+
+// 자식 번호 → 기록 (없는 번호거나 기록이 이미 재사용되었으면 NULL)
+static struct dchild* daemon_find(uint32_t id) {
+  if (id == 0 || id > (uint32_t)dmn.n) return NULL;
+  int i = pidmap_get(&dmn.ids, (pid_t)id);
+  return i < 0 ? NULL : &dmn.ch[i];
+}
+
+/*
+ * 데몬: 자식 하나 생성 (spawn 요청, 워커 채우기)
+ *
+ * 요청별 작업 옵션은 잠시 전달 인수 뒤에 붙입니다. (뒤에 온 것이 이김)
+ * exec와 준비 완료는 기다리지 않고 ready 파이프를 epoll에 걸어 둡니다.
+ * 반환값: 자식 번호, 실패하면 -errno
+ */
+static int daemon_spawn(int worker, int work, int ms) {
+  if (dmn.nlive >= DAEMON_MAX_LIVE) return -EAGAIN;
+  int slot = daemon_slot_alloc();
+  if (slot < 0) return -ENOMEM;
+
+  char work_arg[32], ms_arg[32];
+  int saved = n_fwd_args;
+  if (work > 0 && (size_t)work <= sizeof(payloads) / sizeof(payloads[0])) {
+    snprintf(work_arg, sizeof(work_arg), "--work=%s", payloads[work - 1].name);
+    forward_arg(work_arg);
+  }
+  if (ms >= 0) {
+    snprintf(ms_arg, sizeof(ms_arg), "--work-ms=%d", ms);
+    forward_arg(ms_arg);
+  }
+  int idx = dmn.n + 1;
+  struct dchild* d = &dmn.ch[slot];
+  memset(d, 0, sizeof(*d));
+  int rc = spawn_child(exec_path, idx, &d->rec);
+  int e = errno;
+  n_fwd_args = saved;
+  if (rc < 0) {
+    daemon_slot_free(slot);
+    return -(e ? e : EAGAIN);
+  }
+
+  dmn.n++;
+  d->id = idx;
+  d->next = -1;
+  d->state = DCH_STARTING;
+  d->worker = worker;
+  d->pidfd = open_pidfd(d->rec.pid);
+  pidmap_put(&dmn.ids, idx, slot);
+  pidmap_put(&dmn.live, d->rec.pid, slot);
+  dmn.nlive++;
+  if (worker) dmn.workers++;
+  epoll_set(EPOLL_CTL_ADD, d->rec.ready_fd, EPOLLIN, EV_TAG(EV_READY, slot));
+  return idx;
+}
+
+// 데몬: ready 파이프가 읽을 수 있게 됨 (준비 완료 바이트 또는 exec 실패 후 EOF)
+static void daemon_on_ready(struct dchild* d) {
+  epoll_ctl(dmn.epfd, EPOLL_CTL_DEL, d->rec.ready_fd, NULL);
+  // 자식이 이미 exec를 지났거나 끝났으므로 두 파이프 모두 기다리지 않고 읽힘
+  if (await_child_ready(&d->rec)) d->state = DCH_RUNNING;
+}
+
+// 데몬: 살아 있는 자식에게 시그널 (워커를 이렇게 끝내면 그룹이 다시 채움)
+static int daemon_kill(struct dchild* d, int sig) {
+  if (d->state == DCH_EXITED) return 0;
+#ifdef SYS_pidfd_send_signal
+  if (d->pidfd >= 0) return syscall(SYS_pidfd_send_signal, d->pidfd, sig, NULL, 0) == 0;
+#endif
+  return kill(d->rec.pid, sig) == 0;
+}
+
+// 데몬: 워커 수를 목표에 맞춤 (모자라면 생성, 넘치면 가장 최근 워커부터 SIGTERM)
+static void daemon_rebalance(void) {
+  if (dmn.shutting_down) return;
+  while (dmn.workers < dmn.target) {
+    if (daemon_spawn(1, 0, -1) < 0) break;
+  }
+  while (dmn.workers > dmn.target) {
+    struct dchild* last = NULL;
+    for (int i = 0; i < dmn.used; ++i) {
+      struct dchild* d = &dmn.ch[i];
+      if (d->id == 0 || !d->worker || d->stopping || d->state == DCH_EXITED) continue;
+      if (last == NULL || d->id > last->id) last = d;
+    }
+    if (last == NULL) break;
+    last->stopping = 1;
+    dmn.workers--;
+    daemon_kill(last, SIGTERM);
+  }
+}
+
+// 데몬: SIGCHLD가 오면 끝난 자식을 모두 수거
+static void daemon_reap(void) {
+  int respawn = 0;
+  for (;;) {
+    int status = 0;
+    pid_t pid = waitpid(-1, &status, WNOHANG);
+    if (pid <= 0) break;
+    int i = pidmap_take(&dmn.live, pid);
+    if (i < 0) {
+      // PR_SET_CHILD_SUBREAPER 때문에 자식이 남긴 고아도 여기로 옴: 수거만 하고 셈
+      dmn.orphans++;
+      continue;
+    }
+    struct dchild* d = &dmn.ch[i];
+    if (d->rec.ready_fd >= 0) daemon_on_ready(d);
+    d->state = DCH_EXITED;
+    d->status = child_real_status(&d->rec, status);
+    d->t_reaped = now_us();
+    if (d->pidfd >= 0) close(d->pidfd);
+    d->pidfd = -1;
+    report_exit(&d->rec, status);
+    dmn.nlive--;
+    if (d->worker && !d->stopping) {
+      dmn.workers--;
+      if (d->rec.exec_errno != 0) {
+        // exec가 안 되는 워커를 계속 다시 만들지 않도록 목표를 낮춤
+        fprintf(stderr, "[parent] Worker #%d exec failed (%s), lowering worker target to %d\n",
+                d->id, strerror(d->rec.exec_errno), dmn.workers);
+        dmn.target = dmn.workers;
+      } else {
+        respawn = 1;
+      }
+    }
+    daemon_slot_retire(i);
+  }
+  if (respawn) daemon_rebalance();
+}
+
+static void daemon_shutdown(void) {
+  if (dmn.shutting_down) return;
+  dmn.shutting_down = 1;
+  dmn.target = 0;
+  for (int i = 0; i < dmn.used; ++i) {
+    if (dmn.ch[i].id != 0) daemon_kill(&dmn.ch[i], SIGTERM);
+  }
+}
+
+// 데몬: 요청 하나 처리
+static void ctl_handle(const struct ctl_req* req, struct ctl_resp* resp) {
+  memset(resp, 0, sizeof(*resp));
+  resp->seq = req->seq;
+  dmn.requests++;
+
+  switch (req->op) {
+    case CTL_PING:
+      resp->v[0] = (uint32_t)dmn.generation;
+      resp->v[1] = (uint32_t)dmn.last_pause_us;
+      resp->v[2] = (uint32_t)dmn.orphans;
+      break;
+    case CTL_SPAWN: {
+      if (dmn.shutting_down) { resp->err = ESHUTDOWN; break; }
+      int idx = daemon_spawn(0, req->sub, req->arg);
+      if (idx < 0) { resp->err = -idx; break; }
+      resp->v[0] = (uint32_t)idx;
+      resp->v[1] = (uint32_t)daemon_find((uint32_t)idx)->rec.pid;
+      break;
+    }
+    case CTL_STATUS:
+      if (req->id == 0) {
+        resp->v[0] = (uint32_t)dmn.nlive;
+        resp->v[1] = (uint32_t)dmn.n;
+        resp->v[2] = (uint32_t)agg.total;
+        resp->v[3] = (uint32_t)(agg.total - agg.ok);
+        resp->v[4] = (uint32_t)dmn.workers;
+        resp->v[5] = (uint32_t)dmn.target;
+      } else if (daemon_find(req->id) == NULL) {
+        resp->err = ESRCH;
+      } else {
+        const struct dchild* d = daemon_find(req->id);
+        double end = d->state == DCH_EXITED ? d->t_reaped : now_us();
+        resp->v[0] = (uint32_t)d->rec.pid;
+        resp->v[1] = (uint32_t)d->state;
+        resp->v[2] = (uint32_t)d->status;
+        resp->v[3] = (uint32_t)((end - d->rec.t_fork) / 1e3);
+        resp->v[4] = (uint32_t)d->worker;
+      }
+      break;
+    case CTL_KILL: {
+      int sig = req->sub ? req->sub : SIGTERM;
+      if (req->id == 0) {
+        for (int i = 0; i < dmn.used; ++i) {
+          if (dmn.ch[i].id != 0) resp->v[0] += (uint32_t)daemon_kill(&dmn.ch[i], sig);
+        }
+      } else if (daemon_find(req->id) == NULL || daemon_find(req->id)->state == DCH_EXITED) {
+        resp->err = ESRCH;
+      } else if (!daemon_kill(daemon_find(req->id), sig)) {
+        resp->err = errno;
+      } else {
+        resp->v[0] = 1;
+      }
+      break;
+    }
+    case CTL_SCALE:
+      if (dmn.shutting_down) { resp->err = ESHUTDOWN; break; }
+      if (req->arg < 0 || req->arg > DAEMON_MAX_LIVE) { resp->err = EINVAL; break; }
+      dmn.target = req->arg;
+      daemon_rebalance();
+      resp->v[0] = (uint32_t)dmn.target;
+      resp->v[1] = (uint32_t)dmn.workers;
+      break;
+    case CTL_SHUTDOWN:
+      daemon_shutdown();
+      resp->v[0] = (uint32_t)dmn.nlive;
+      break;
+    case CTL_UPGRADE:
+      if (dmn.shutting_down) { resp->err = ESHUTDOWN; break; }
+      dmn.upgrade = 1;
+      resp->v[0] = (uint32_t)dmn.nlive;
+      resp->v[1] = (uint32_t)dmn.generation;
+      break;
+    default:
+      resp->err = EINVAL;
+      break;
+  }
+}
+
+/*
+ * 데몬: 연결 하나에서 읽을 수 있는 만큼 읽고, 처리하고, 보낼 수 있는 만큼 보냄
+ *
+ * 출력 버퍼가 차면 더 읽지 않고 EPOLLOUT을 기다립니다. (느린 클라이언트가
+ * 응답을 읽지 않아도 데몬의 메모리가 늘지 않음)
+ * 반환값: 연결을 닫아야 하면 -1
+ */
+static int conn_pump(struct ctl_conn* c, int i) {
+  for (;;) {
+    // 1. 버퍼에 모인 완전한 요청을 출력 버퍼에 자리가 있는 만큼 처리
+    size_t off = 0;
+    while (!dmn.upgrade && c->in_len - off >= sizeof(struct ctl_req) &&
+           c->out_len + sizeof(struct ctl_resp) <= sizeof(c->out)) {
+      struct ctl_req req;
+      struct ctl_resp resp;
+      memcpy(&req, c->in + off, sizeof(req));
+      off += sizeof(req);
+      if (req.magic != CTL_MAGIC) return -1;
+      ctl_handle(&req, &resp);
+      memcpy(c->out + c->out_len, &resp, sizeof(resp));
+      c->out_len += sizeof(resp);
+    }
+    memmove(c->in, c->in + off, c->in_len - off);
+    c->in_len -= off;
+
+    // 2. 응답을 한 번에 보냄
+    size_t sent = 0;
+    while (sent < c->out_len) {
+      ssize_t n = send(c->fd, c->out + sent, c->out_len - sent, MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0 && errno == EAGAIN) break;
+      if (n < 0) return -1;
+      sent += (size_t)n;
+    }
+    memmove(c->out, c->out + sent, c->out_len - sent);
+    c->out_len -= sent;
+    if (c->out_len > 0) break;
+
+    // 재실행 요청 뒤의 요청은 새 인스턴스가 처리 (남은 입력은 버퍼째 넘어감)
+    if (dmn.upgrade) break;
+
+    // 3. 처리하지 못한 요청이 남았으면 먼저 처리, 아니면 더 읽기 (없으면 다음 이벤트까지 대기)
+    if (c->in_len >= sizeof(struct ctl_req)) continue;
+    ssize_t n = read(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && errno == EAGAIN) break;
+    if (n <= 0) return -1;
+    c->in_len += (size_t)n;
+  }
+
+  unsigned int want = c->out_len > 0 ? EPOLLOUT : EPOLLIN;
+  if (want != c->events) {
+    c->events = want;
+    epoll_set(EPOLL_CTL_MOD, c->fd, want, EV_TAG(EV_CONN, i));
+  }
+  return 0;
+}
+
+static void conn_close(int i) {
+  struct ctl_conn* c = dmn.conns[i];
+  close(c->fd);  // epoll에서도 함께 빠짐
+  free(c);
+  dmn.conns[i] = NULL;
+}
+
+static void daemon_accept(void) {
+  for (;;) {
+    int fd = accept4(dmn.listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR) continue;
+      break;  // EAGAIN: 대기 중인 연결 없음
+    }
+    int i = 0;
+    while (i < DAEMON_MAX_CONNS && dmn.conns[i]) i++;
+    struct ctl_conn* c = i < DAEMON_MAX_CONNS ? malloc(sizeof(*c)) : NULL;
+    if (c == NULL) {
+      close(fd);
+      continue;
+    }
+    c->fd = fd;
+    c->events = EPOLLIN;
+    c->in_len = c->out_len = 0;
+    dmn.conns[i] = c;
+    epoll_set(EPOLL_CTL_ADD, fd, EPOLLIN, EV_TAG(EV_CONN, i));
+  }
+}
+
+static int unix_addr(struct sockaddr_un* sa, const char* path) {
+  memset(sa, 0, sizeof(*sa));
+  sa->sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(sa->sun_path)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  strcpy(sa->sun_path, path);
+  return 0;
+}
+
+/*
+ * 무중단 재실행 (upgrade 요청 또는 SIGHUP)
+ *
+ * 데몬이 다시 시작해도 자식은 멈추지 않아야 하고, 데몬은 자식들을 잊지 않아야 합니다.
+ * execve는 PID를 바꾸지 않으므로 자식의 부모는 그대로입니다. 그 사이 끝난 자식은
+ * 좀비로 남고 SIGCHLD는 막힌 채 보류되어 넘어가므로, 새 인스턴스가 이어서 수거합니다.
+ * 넘겨야 할 것은 두 가지입니다:
+ * - 자식 표, 워커 목표, 종료 집계 같은 메모리 상태 → memfd 하나에 그대로 기록
+ * - 열린 fd (제어 소켓, 클라이언트 연결, 자식별 pidfd, 아직 준비 중인 자식의 파이프)
+ *   → FD_CLOEXEC만 풀면 같은 번호로 exec 너머까지 살아남음
+ * 새 인스턴스는 --daemon-resume=FD로 memfd를 받아 상태를 되살리고 CLOEXEC를 다시 켭니다.
+ * 제어 소켓은 닫지 않으므로 그 사이 들어온 연결은 listen 대기열에서 기다립니다.
+ *
+ * 실행 파일은 시작할 때 /proc/self/exe를 풀어 둔 경로이므로, 그 자리에 새 빌드를
+ * 설치해 두면 새 바이너리로 바뀝니다. 구조체 배치가 다른 빌드는 넘겨받기를 거부합니다.
+ * (데몬은 서브리퍼이므로 그래도 자식과 손자 프로세스의 수거는 계속됨)
+ */
+#define HANDOFF_MAGIC "PDHAND1"
+
+struct handoff_header {
+  char magic[8];
+  uint32_t dchild_size, conn_size, agg_size;  // 같은 구조체 배치끼리만 넘겨받음
+  int n, nlive, workers, target, generation, nconns, listen_fd;
+  int used, free_head, done_head, done_tail, ndone;  // 자식 기록 표 (dmn과 같은 뜻)
+  unsigned long requests, orphans;
+  double t_started;  // 처음 데몬이 시작한 시각
+  double t_begin;    // 재실행 시작 (상태 기록 직전)
+  double t_exec;     // execve 호출 직전
+};
+
+static char daemon_exe[PATH_MAX];  // 재실행할 실행 파일
+static char** daemon_argv = NULL;  // 재실행할 때 그대로 넘길 인수
+
+static int write_all(int fd, const void* buf, size_t len) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = write(fd, (const char*)buf + done, len - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return -1;
+    done += (size_t)n;
+  }
+  return 0;
+}
+
+static void set_cloexec(int fd, int on) {
+  if (fd >= 0) fcntl(fd, F_SETFD, on ? FD_CLOEXEC : 0);
+}
+
+// 넘겨줄 fd 모두의 FD_CLOEXEC를 켜거나 끔
+static void handoff_fds_cloexec(int on) {
+  set_cloexec(dmn.listen_fd, on);
+  for (int i = 0; i < DAEMON_MAX_CONNS; ++i) if (dmn.conns[i]) set_cloexec(dmn.conns[i]->fd, on);
+  for (int i = 0; i < dmn.used; ++i) {
+    const struct dchild* d = &dmn.ch[i];
+    if (d->id == 0 || d->state == DCH_EXITED) continue;
+    set_cloexec(d->pidfd, on);
+    set_cloexec(d->rec.err_fd, on);
+    set_cloexec(d->rec.ready_fd, on);
+  }
+}
+
+// 데몬: 상태를 memfd에 기록하고 자기 자신을 다시 exec (실패하면 그대로 계속 실행)
+static void daemon_upgrade(void) {
+  struct handoff_header h;
+  memset(&h, 0, sizeof(h));
+  h.t_begin = now_us();
+  memcpy(h.magic, HANDOFF_MAGIC, sizeof(h.magic));
+  h.dchild_size = sizeof(struct dchild);
+  h.conn_size = sizeof(struct ctl_conn);
+  h.agg_size = sizeof(agg);
+  h.n = dmn.n;
+  h.used = dmn.used;
+  h.free_head = dmn.free_head;
+  h.done_head = dmn.done_head;
+  h.done_tail = dmn.done_tail;
+  h.ndone = dmn.ndone;
+  h.nlive = dmn.nlive;
+  h.workers = dmn.workers;
+  h.target = dmn.target;
+  h.generation = dmn.generation + 1;
+  h.listen_fd = dmn.listen_fd;
+  h.requests = dmn.requests;
+  h.orphans = dmn.orphans;
+  h.t_started = dmn.t_started;
+  for (int i = 0; i < DAEMON_MAX_CONNS; ++i) if (dmn.conns[i]) h.nconns++;
+  dmn.upgrade = 0;
+
+  // memfd는 CLOEXEC 없이 만듦 (새 인스턴스가 받아야 함)
+  int mfd = memfd_create("proc_demo-handoff", 0);
+  int ok = mfd >= 0 && write_all(mfd, &h, sizeof(h)) == 0 &&
+           write_all(mfd, &agg, sizeof(agg)) == 0 &&
+           write_all(mfd, dmn.ch, (size_t)dmn.used * sizeof(*dmn.ch)) == 0;
+  for (int i = 0; ok && i < DAEMON_MAX_CONNS; ++i) {
+    if (dmn.conns[i] == NULL) continue;
+    ok = write_all(mfd, &i, sizeof(i)) == 0 && write_all(mfd, dmn.conns[i], sizeof(struct ctl_conn)) == 0;
+  }
+  if (!ok) {
+    perror("[parent] cannot write handoff state, not re-executing");
+    if (mfd >= 0) close(mfd);
+    return;
+  }
+
+  // 원래 인수 뒤에 --daemon-resume=FD만 바꿔 붙임
+  int argc = 0;
+  while (daemon_argv[argc]) argc++;
+  char** args = calloc((size_t)argc + 2, sizeof(char*));
+  char resume_arg[32];
+  int n = 0;
+  snprintf(resume_arg, sizeof(resume_arg), "--daemon-resume=%d", mfd);
+  for (int k = 0; args && k < argc; ++k) {
+    if (strncmp(daemon_argv[k], "--daemon-resume=", 16) != 0) args[n++] = daemon_argv[k];
+  }
+  if (args == NULL) {
+    close(mfd);
+    return;
+  }
+  args[n++] = resume_arg;
+  args[n] = NULL;
+
+  printf("[parent] Re-executing %s with %d live children (generation %d)\n",
+         daemon_exe, dmn.nlive, h.generation);
+  fflush(stdout);
+  fflush(stderr);
+  handoff_fds_cloexec(0);
+  h.t_exec = now_us();
+  if (pwrite(mfd, &h.t_exec, sizeof(h.t_exec), offsetof(struct handoff_header, t_exec)) < 0 ||
+      lseek(mfd, 0, SEEK_SET) < 0) {
+    perror("[parent] handoff failed");
+  } else {
+    execv(daemon_exe, args);
+    perror("[parent] re-exec failed, continuing with the old instance");
+  }
+  handoff_fds_cloexec(1);
+  close(mfd);
+  free(args);
+}
+
+// 새 인스턴스: memfd에서 상태를 되살림 (fd들은 같은 번호로 이미 열려 있음)
+static int daemon_resume(int fd, struct handoff_header* h) {
+  int ok = read_full(fd, h, sizeof(*h)) == (ssize_t)sizeof(*h) &&
+           memcmp(h->magic, HANDOFF_MAGIC, sizeof(h->magic)) == 0 &&
+           h->dchild_size == sizeof(struct dchild) && h->conn_size == sizeof(struct ctl_conn) &&
+           h->agg_size == sizeof(agg) && h->n >= 0 && h->used >= 0 && h->used <= DAEMON_MAX_RECS &&
+           h->free_head < h->used && h->done_head < h->used && h->done_tail < h->used;
+  if (ok) {
+    dmn.cap = h->used > 256 ? h->used : 256;
+    dmn.ch = calloc((size_t)dmn.cap, sizeof(*dmn.ch));
+    ok = dmn.ch != NULL && read_full(fd, &agg, sizeof(agg)) == (ssize_t)sizeof(agg) &&
+         read_full(fd, dmn.ch, (size_t)h->used * sizeof(*dmn.ch)) ==
+             (ssize_t)((size_t)h->used * sizeof(*dmn.ch));
+  }
+  for (int k = 0; ok && k < h->nconns; ++k) {
+    int i = -1;
+    struct ctl_conn* c = malloc(sizeof(*c));
+    ok = c != NULL && read_full(fd, &i, sizeof(i)) == (ssize_t)sizeof(i) && i >= 0 &&
+         i < DAEMON_MAX_CONNS && read_full(fd, c, sizeof(*c)) == (ssize_t)sizeof(*c);
+    if (ok) dmn.conns[i] = c;
+    else free(c);
+  }
+  close(fd);
+  if (!ok) {
+    fprintf(stderr, "[parent] Handoff state from the previous instance is unusable, starting fresh\n");
+    free(dmn.ch);
+    dmn.ch = NULL;
+    dmn.cap = 0;
+    for (int i = 0; i < DAEMON_MAX_CONNS; ++i) { free(dmn.conns[i]); dmn.conns[i] = NULL; }
+    memset(&agg, 0, sizeof(agg));
+    return -1;
+  }
+  dmn.n = h->n;
+  dmn.used = h->used;
+  dmn.free_head = h->free_head;
+  dmn.done_head = h->done_head;
+  dmn.done_tail = h->done_tail;
+  dmn.ndone = h->ndone;
+  dmn.nlive = h->nlive;
+  dmn.workers = h->workers;
+  dmn.target = h->target;
+  dmn.generation = h->generation;
+  dmn.listen_fd = h->listen_fd;
+  dmn.requests = h->requests;
+  dmn.orphans = h->orphans;
+  dmn.t_started = h->t_started;
+  return 0;
+}
+
+static int run_daemon(const char* path, int resume_fd) {
+  double t_entry = now_us();
+  struct handoff_header h;
+  struct sockaddr_un sa;
+  if (unix_addr(&sa, path) < 0) {
+    perror("[parent] bad socket path");
+    return 1;
+  }
+  ssize_t len = readlink("/proc/self/exe", daemon_exe, sizeof(daemon_exe) - 1);
+  daemon_exe[len > 0 ? len : 0] = '\0';
+  dmn.free_head = dmn.done_head = dmn.done_tail = -1;
+  if (resume_fd >= 0 && daemon_resume(resume_fd, &h) < 0) resume_fd = -1;
+
+  if (resume_fd < 0) {
+    // 1. 이미 같은 경로에서 데몬이 돌고 있으면 빼앗지 않음 (남은 소켓 파일만 지움)
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0 && connect(probe, (struct sockaddr*)&sa, sizeof(sa)) == 0) {
+      fprintf(stderr, "[parent] A daemon is already listening on %s\n", path);
+      close(probe);
+      return 1;
+    }
+    if (probe >= 0) close(probe);
+    unlink(path);
+
+    dmn.listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (dmn.listen_fd < 0 || bind(dmn.listen_fd, (struct sockaddr*)&sa, sizeof(sa)) < 0 ||
+        listen(dmn.listen_fd, SOMAXCONN) < 0) {
+      perror("[parent] cannot listen on control socket");
+      return 1;
+    }
+    dmn.t_started = t_entry;
+
+    // 자식이 만든 손자 프로세스가 고아가 되면 init 대신 이 데몬이 받아 수거 (exec 후에도 유지)
+    if (prctl(PR_SET_CHILD_SUBREAPER, 1) < 0) perror("[parent] PR_SET_CHILD_SUBREAPER failed");
+
+    // 자식마다 pidfd를 하나씩 들고 있으므로 fd 한도를 하드 한도까지 올림
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+      rl.rlim_cur = rl.rlim_max;
+      setrlimit(RLIMIT_NOFILE, &rl);
+    }
+  }
+
+  // 2. SIGCHLD와 종료/재실행 시그널은 막아 두고 signalfd로 받음 (자식은 spawn_child에서 다시 풂)
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  sigaddset(&mask, SIGTERM);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGHUP);
+  sigprocmask(SIG_BLOCK, &mask, NULL);
+  dmn.sig_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  dmn.epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (dmn.sig_fd < 0 || dmn.epfd < 0 || pidmap_init(&dmn.live, DAEMON_MAX_LIVE) < 0 ||
+      pidmap_init(&dmn.ids, DAEMON_MAX_RECS) < 0) {
+    perror("[parent] daemon setup failed");
+    return 1;
+  }
+  epoll_set(EPOLL_CTL_ADD, dmn.listen_fd, EPOLLIN, EV_TAG(EV_LISTEN, 0));
+  epoll_set(EPOLL_CTL_ADD, dmn.sig_fd, EPOLLIN, EV_TAG(EV_SIGNAL, 0));
+
+  if (resume_fd >= 0) {
+    // 넘겨받은 fd를 다시 CLOEXEC로 (이후 자식에게 새지 않도록), 살아 있는 자식과 연결을 다시 등록
+    handoff_fds_cloexec(1);
+    for (int i = 0; i < dmn.used; ++i) {
+      const struct dchild* d = &dmn.ch[i];
+      if (d->id == 0) continue;
+      pidmap_put(&dmn.ids, d->id, i);
+      if (d->state == DCH_EXITED) continue;
+      pidmap_put(&dmn.live, d->rec.pid, i);
+      if (d->rec.ready_fd >= 0) epoll_set(EPOLL_CTL_ADD, d->rec.ready_fd, EPOLLIN, EV_TAG(EV_READY, i));
+    }
+    for (int i = 0; i < DAEMON_MAX_CONNS; ++i) {
+      if (dmn.conns[i]) epoll_set(EPOLL_CTL_ADD, dmn.conns[i]->fd, dmn.conns[i]->events, EV_TAG(EV_CONN, i));
+    }
+    double t_done = now_us();
+    dmn.last_pause_us = t_done - h.t_begin;
+    printf("[parent] Resumed daemon on %s (pid %d, generation %d): %d live children, %d connection(s)\n",
+           path, getpid(), dmn.generation, dmn.nlive, h.nconns);
+    printf("[parent]   handoff pause %.1f us (save state %.1f us, exec %.1f us, restore %.1f us)\n",
+           dmn.last_pause_us, h.t_exec - h.t_begin, t_entry - h.t_exec, t_done - t_entry);
+    // 재실행 중 끝난 자식과 버퍼에 남은 요청을 바로 처리
+    daemon_reap();
+    for (int i = 0; i < DAEMON_MAX_CONNS; ++i) {
+      if (dmn.conns[i] && conn_pump(dmn.conns[i], i) < 0) conn_close(i);
+    }
+  } else {
+    printf("[parent] Daemon listening on %s (pid %d)\n", path, getpid());
+  }
+  fflush(stdout);
+
+  // 3. 이벤트 루프: 종료 요청을 받고 모든 자식을 수거할 때까지
+  struct epoll_event evs[64];
+  while (!dmn.shutting_down || dmn.nlive > 0) {
+    int n = epoll_wait(dmn.epfd, evs, 64, -1);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      perror("[parent] epoll_wait failed");
+      break;
+    }
+    for (int k = 0; k < n; ++k) {
+      int type = (int)(evs[k].data.u64 >> 32);
+      int i = (int)(uint32_t)evs[k].data.u64;
+      if (type == EV_LISTEN) {
+        daemon_accept();
+      } else if (type == EV_SIGNAL) {
+        struct signalfd_siginfo si;
+        while (read(dmn.sig_fd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+          if (si.ssi_signo == SIGHUP) dmn.upgrade = !dmn.shutting_down;
+          else if (si.ssi_signo != SIGCHLD) daemon_shutdown();
+        }
+        daemon_reap();  // SIGCHLD는 여러 번 와도 하나로 합쳐지므로 매번 모두 수거
+      } else if (type == EV_READY) {
+        if (dmn.ch[i].rec.ready_fd >= 0) daemon_on_ready(&dmn.ch[i]);
+      } else if (type == EV_CONN && dmn.conns[i]) {
+        if (conn_pump(dmn.conns[i], i) < 0) conn_close(i);
+      }
+    }
+    if (dmn.upgrade) daemon_upgrade();  // 성공하면 돌아오지 않음
+  }
+  double wall = now_us() - dmn.t_started;
+
+  for (int i = 0; i < DAEMON_MAX_CONNS; ++i) if (dmn.conns[i]) conn_close(i);
+  close(dmn.listen_fd);
+  unlink(path);
+  close(dmn.sig_fd);
+  close(dmn.epfd);
+  pidmap_free(&dmn.live);
+  pidmap_free(&dmn.ids);
+
+  printf("[parent] Daemon handled %lu requests and %d children in %.1f s (%d re-exec(s), "
+         "%lu orphaned descendant(s) reaped)\n",
+         dmn.requests, dmn.n, wall / 1e6, dmn.generation, dmn.orphans);
+  print_exit_summary();
+  if (waitpid(-1, NULL, WNOHANG) < 0 && errno == ECHILD) {
+    printf("\n[parent] No unreaped children left (no zombies)\n");
+  } else {
+    printf("\n[parent] WARNING: unreaped children remain!\n");
+  }
+  free(dmn.ch);
+  return 0;
+}
+
+static int send_full(int fd, const void* buf, size_t len) {
+  size_t sent = 0;
+  while (sent < len) {
+    ssize_t n = send(fd, (const char*)buf + sent, len - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return -1;
+    sent += (size_t)n;
+  }
+  return 0;
+}
+
+// 클라이언트: 요청 n개를 한 번에 보내고 응답 n개를 받음
+static int ctl_roundtrip(int fd, const struct ctl_req* reqs, struct ctl_resp* resps, int n) {
+  if (send_full(fd, reqs, (size_t)n * sizeof(*reqs)) < 0) return -1;
+  if (read_full(fd, resps, (size_t)n * sizeof(*resps)) != (ssize_t)((size_t)n * sizeof(*resps))) {
+    errno = ECONNRESET;
+    return -1;
+  }
+  return 0;
+}
+
+static int ctl_signal(const char* s) {
+  static const struct { const char* name; int sig; } names[] = {
+    { "TERM", SIGTERM }, { "KILL", SIGKILL }, { "INT", SIGINT }, { "HUP", SIGHUP },
+    { "STOP", SIGSTOP }, { "CONT", SIGCONT }, { "USR1", SIGUSR1 }, { "USR2", SIGUSR2 },
+  };
+  if (strncmp(s, "SIG", 3) == 0) s += 3;
+  for (size_t k = 0; k < sizeof(names) / sizeof(names[0]); ++k) {
+    if (strcmp(names[k].name, s) == 0) return names[k].sig;
+  }
+  int sig = atoi(s);
+  return sig > 0 && sig < 65 ? sig : -1;
+}
+
+// 클라이언트: ping을 depth개씩 이어 보내며 요청 처리량과 왕복 지연 측정
+static int ctl_bench(int fd, int n, int depth) {
+  struct ctl_req* reqs = calloc((size_t)depth, sizeof(*reqs));
+  struct ctl_resp* resps = calloc((size_t)depth, sizeof(*resps));
+  struct lat_hist rtt;
+  if (reqs == NULL || resps == NULL) return 1;
+  memset(&rtt, 0, sizeof(rtt));
+
+  double t0 = now_us();
+  uint32_t seq = 0;
+  for (int done = 0; done < n; ) {
+    int k = n - done < depth ? n - done : depth;
+    for (int j = 0; j < k; ++j) {
+      reqs[j].magic = CTL_MAGIC;
+      reqs[j].op = CTL_PING;
+      reqs[j].seq = ++seq;
+    }
+    double t = now_us();
+    if (ctl_roundtrip(fd, reqs, resps, k) < 0) {
+      perror("[ctl] bench failed");
+      return 1;
+    }
+    hist_add(&rtt, now_us() - t);
+    if (resps[k - 1].seq != seq) {
+      fprintf(stderr, "[ctl] response out of order (seq %u, expected %u)\n", resps[k - 1].seq, seq);
+      return 1;
+    }
+    done += k;
+  }
+  double wall = now_us() - t0;
+  printf("[ctl] %d requests, pipeline depth %d: %.1f ms (%.0f req/s), batch round trip p50 %.1f us p99 %.1f us\n",
+         n, depth, wall / 1e3, n / (wall / 1e6), hist_pct(&rtt, 50), hist_pct(&rtt, 99));
+  free(reqs);
+  free(resps);
+  return 0;
+}
+
+// 클라이언트 응답 출력
+static void ctl_print(const struct ctl_req* req, const struct ctl_resp* r) {
+  char desc[64];
+  switch (req->op) {
+    case CTL_PING:
+      printf("[ctl] pong (generation %u, last re-exec pause %u us, %u orphan(s) reaped)\n",
+             r->v[0], r->v[1], r->v[2]);
+      break;
+    case CTL_SPAWN:
+      printf("[ctl] spawned child #%u (pid %u)\n", r->v[0], r->v[1]);
+      break;
+    case CTL_STATUS:
+      if (req->id == 0) {
+        printf("[ctl] live=%u spawned=%u reaped=%u failed=%u workers=%u/%u\n",
+               r->v[0], r->v[1], r->v[2], r->v[3], r->v[4], r->v[5]);
+      } else {
+        desc[0] = '\0';
+        if (r->v[1] == DCH_EXITED) describe_status((int)r->v[2], desc, sizeof(desc));
+        printf("[ctl] child #%u pid=%u %s%s%s %u ms%s\n", req->id, r->v[0],
+               r->v[1] <= DCH_EXITED ? dch_state_names[r->v[1]] : "?",
+               desc[0] ? ": " : "", desc, r->v[3], r->v[4] ? " (worker)" : "");
+      }
+      break;
+    case CTL_KILL:
+      printf("[ctl] sent signal %d to %u child(ren)\n", req->sub ? req->sub : SIGTERM, r->v[0]);
+      break;
+    case CTL_SCALE:
+      printf("[ctl] worker target %u (%u live)\n", r->v[0], r->v[1]);
+      break;
+    case CTL_SHUTDOWN:
+      printf("[ctl] daemon shutting down (%u children to reap)\n", r->v[0]);
+      break;
+  }
+}
+
+static int run_ctl(const char* path) {
+  const char* cmd = ctl_argc > 0 ? ctl_argv[0] : "status";
+  const char* a1 = ctl_argc > 1 ? ctl_argv[1] : NULL;
+  const char* a2 = ctl_argc > 2 ? ctl_argv[2] : NULL;
+  struct ctl_req req;
+  memset(&req, 0, sizeof(req));
+  req.magic = CTL_MAGIC;
+  req.seq = 1;
+  req.arg = -1;
+
+  if (strcmp(cmd, "ping") == 0 || strcmp(cmd, "bench") == 0) {
+    req.op = CTL_PING;
+  } else if (strcmp(cmd, "spawn") == 0) {
+    req.op = CTL_SPAWN;
+    if (a1) {
+      const struct payload* pl = find_payload(a1);
+      if (pl == NULL) {
+        fprintf(stderr, "[ctl] unknown work: %s\n", a1);
+        return 2;
+      }
+      req.sub = (uint8_t)(pl - payloads + 1);
+    }
+    if (a2) req.arg = atoi(a2);
+  } else if (strcmp(cmd, "status") == 0) {
+    req.op = CTL_STATUS;
+    if (a1) req.id = (uint32_t)atoi(a1);
+  } else if (strcmp(cmd, "kill") == 0 && a1) {
+    req.op = CTL_KILL;
+    req.id = strcmp(a1, "all") == 0 ? 0 : (uint32_t)atoi(a1);
+    int sig = a2 ? ctl_signal(a2) : SIGTERM;
+    if (sig < 0 || (req.id == 0 && strcmp(a1, "all") != 0)) {
+      fprintf(stderr, "[ctl] usage: kill ID|all [SIG]\n");
+      return 2;
+    }
+    req.sub = (uint8_t)sig;
+  } else if (strcmp(cmd, "scale") == 0 && a1) {
+    req.op = CTL_SCALE;
+    req.arg = atoi(a1);
+  } else if (strcmp(cmd, "shutdown") == 0) {
+    req.op = CTL_SHUTDOWN;
+  } else if (strcmp(cmd, "upgrade") == 0) {
+    req.op = CTL_UPGRADE;
+  } else {
+    fprintf(stderr, "[ctl] usage: --ctl=SOCK spawn [WORK [MS]] | status [ID] | kill ID|all [SIG] |"
+                    " scale N | ping | bench N [DEPTH] | upgrade | shutdown\n");
+    return 2;
+  }
+
+  struct sockaddr_un sa;
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0 || unix_addr(&sa, path) < 0 || connect(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0) {
+    fprintf(stderr, "[ctl] cannot connect to %s: %s\n", path, strerror(errno));
+    return 1;
+  }
+
+  int rc = 0;
+  if (strcmp(cmd, "bench") == 0) {
+    int n = a1 ? atoi(a1) : 10000;
+    int depth = a2 ? atoi(a2) : 64;
+    if (n < 1) n = 1;
+    if (depth < 1) depth = 1;
+    if (depth > CTL_BUF / (int)sizeof(struct ctl_req)) depth = CTL_BUF / (int)sizeof(struct ctl_req);
+    rc = ctl_bench(fd, n, 1);
+    if (rc == 0 && depth > 1) rc = ctl_bench(fd, n, depth);
+  } else {
+    struct ctl_resp resp;
+    double t0 = now_us();
+    if (ctl_roundtrip(fd, &req, &resp, 1) < 0) {
+      fprintf(stderr, "[ctl] no response: %s\n", strerror(errno));
+      rc = 1;
+    } else if (resp.err != 0) {
+      fprintf(stderr, "[ctl] %s failed: %s\n", cmd, strerror(resp.err));
+      rc = 1;
+    } else if (req.op == CTL_UPGRADE) {
+      // 같은 연결로 ping을 보내 새 인스턴스가 답할 때까지의 시간을 잼 (연결도 넘겨받으므로)
+      uint32_t old_gen = resp.v[1], nlive = resp.v[0];
+      req.op = CTL_PING;
+      req.seq = 2;
+      if (ctl_roundtrip(fd, &req, &resp, 1) < 0 || resp.v[0] != old_gen + 1) {
+        fprintf(stderr, "[ctl] no answer from the new instance\n");
+        rc = 1;
+      } else {
+        printf("[ctl] upgrade: %u live children handed off, generation %u answered %.1f us after the request"
+               " (daemon pause %u us)\n", nlive, resp.v[0], now_us() - t0, resp.v[1]);
+      }
+    } else {
+      ctl_print(&req, &resp);
+    }
+  }
+  close(fd);
+  return rc;
+}
+
+/*
+ * 작업 목록 실행기 (--manifest=FILE|-)
+ *
+ * 임의의 명령을 한 줄에 하나씩(또는 이진 레코드로) 읽어 최대 --jobs개를 동시에 실행합니다.
+ * 목록은 스트림으로 읽으므로 한 번에 한 작업만 파싱하고, 메모리에 남는 것은
+ * 실행 중인 작업 칸 K개뿐입니다. (fork 뒤 자식은 인수의 복사본을 가지므로
+ * 부모는 줄 버퍼를 바로 다시 씀) 그래서 작업이 수백만 개여도 메모리는 일정합니다.
+ *
+ * text 형식: 한 줄이 명령 하나, 공백으로 인수를 나누고 '...', "...", \로 묶거나 이스케이프
+ *   (빈 줄과 #으로 시작하는 줄은 건너뜀, 셸을 거치지 않고 바로 execvp,
+ *    앞에 붙은 in=FILE 인수는 명령이 아니라 --cache 키에 넣을 입력 파일)
+ * bin 형식: 레코드마다 uint32 argc, 이어서 인수마다 uint32 길이 + 바이트 (호스트 바이트 순서)
+ *
+ * exec 실패는 기다리지 않고, 자식을 수거할 때 err 파이프에 남은 errno로 확인합니다.
+ * (그 동안 부모는 다음 작업을 계속 띄움)
+ */
+#define MANIFEST_MAX_ARGS 256
+#define MANIFEST_SHOW_FAILED 8
+
+enum { MANIFEST_TEXT, MANIFEST_BIN };
+
+struct job_slot {
+  pid_t pid;       // 0이면 빈 칸
+  long no;         // 작업 번호 (1부터, 목록의 순서)
+  int err_fd;      // exec 실패 errno를 받을 파이프 읽기 끝
+  int out_fd;      // --keep-order: 작업의 stdout을 받는 파이프 읽기 끝 (없으면 -1)
+  int cache_fd;    // --cache: 작업의 stdout을 받는 캐시 항목 파일 (없으면 -1)
+  unsigned __int128 cache_key;
+  unsigned __int128 history_key;  // --history: 실행 시간을 남길 작업 정체
+  double t_start;
+  char cmd[64];    // 실패 보고용 명령 앞부분
+};
+
+struct manifest_stat {
+  long jobs, ok, failed, exec_failed, signaled, bad_records;
+  double wall_us, cpu_us;
+  long maxrss_kb;
+};
+
+// 한 줄을 그 자리에서 인수로 나눔 (따옴표와 \ 처리), 반환값: 인수 개수
+static int manifest_split(char* line, char** argv, int max) {
+  int argc = 0;
+  char* r = line;
+  while (*r) {
+    while (*r == ' ' || *r == '\t' || *r == '\n' || *r == '\r') r++;
+    if (*r == '\0' || argc == max) break;
+    char* w = r;
+    argv[argc++] = w;
+    char quote = 0;
+    for (; *r; ++r) {
+      if (quote) {
+        if (*r == quote) quote = 0;
+        else if (*r == '\\' && quote == '"' && r[1]) *w++ = *++r;
+        else *w++ = *r;
+      } else if (*r == '\'' || *r == '"') {
+        quote = *r;
+      } else if (*r == '\\' && r[1]) {
+        *w++ = *++r;
+      } else if (*r == ' ' || *r == '\t' || *r == '\n' || *r == '\r') {
+        r++;
+        break;
+      } else {
+        *w++ = *r;
+      }
+    }
+    *w = '\0';
+  }
+  argv[argc] = NULL;
+  return argc;
+}
+
+/*
+ * 목록에서 다음 작업 하나를 읽음
+ *
+ * buf는 호출 사이에 다시 쓰는 버퍼입니다. (필요하면 늘림)
+ * 반환값: 인수 개수, 목록 끝이면 0, 잘못된 이진 레코드면 -1
+ */
+static int manifest_next(FILE* fp, int fmt, char** buf, size_t* cap, char** argv) {
+  if (fmt == MANIFEST_TEXT) {
+    for (;;) {
+      if (getline(buf, cap, fp) < 0) return 0;
+      char* p = *buf;
+      while (*p == ' ' || *p == '\t') p++;
+      if (*p == '#') continue;
+      int argc = manifest_split(p, argv, MANIFEST_MAX_ARGS);
+      if (argc > 0) return argc;
+    }
+  }
+
+  uint32_t argc, len;
+  if (fread(&argc, sizeof(argc), 1, fp) != 1) return 0;
+  if (argc == 0 || argc > MANIFEST_MAX_ARGS) return -1;
+  size_t used = 0;
+  size_t offs[MANIFEST_MAX_ARGS];
+  for (uint32_t k = 0; k < argc; ++k) {
+    if (fread(&len, sizeof(len), 1, fp) != 1 || len > (1u << 20)) return -1;
+    if (used + len + 1 > *cap) {
+      size_t ncap = (used + len + 1) * 2;
+      char* nb = realloc(*buf, ncap);
+      if (nb == NULL) return -1;
+      *buf = nb;
+      *cap = ncap;
+    }
+    if (len > 0 && fread(*buf + used, 1, len, fp) != len) return -1;
+    (*buf)[used + len] = '\0';
+    offs[k] = used;
+    used += len + 1;
+  }
+  for (uint32_t k = 0; k < argc; ++k) argv[k] = *buf + offs[k];  // realloc가 끝난 뒤 포인터 계산
+  argv[argc] = NULL;
+  return (int)argc;
+}
+
+// 실패 보고용으로 명령 앞부분을 칸에 기록
+static void job_cmd(struct job_slot* s, char** argv) {
+  size_t off = 0;
+  s->cmd[0] = '\0';
+  for (int k = 0; argv[k] && off + 1 < sizeof(s->cmd); ++k) {
+    off += (size_t)snprintf(s->cmd + off, sizeof(s->cmd) - off, "%s%s", k ? " " : "", argv[k]);
+  }
+}
+
+// 작업 하나를 fork + execvp로 시작 (exec 결과는 기다리지 않음, capture면 stdout을 파이프로 받음)
+static int spawn_job(char** argv, struct job_slot* s, int capture) {
+  int err_pipe[2], out_pipe[2] = { -1, -1 };
+  if (pipe2(err_pipe, O_CLOEXEC) < 0) return -1;
+  if (capture && pipe2(out_pipe, O_CLOEXEC) < 0) {
+    close(err_pipe[0]);
+    close(err_pipe[1]);
+    return -1;
+  }
+  s->t_start = now_us();
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(err_pipe[0]);
+    close(err_pipe[1]);
+    if (capture) { close(out_pipe[0]); close(out_pipe[1]); }
+    return -1;
+  }
+  if (pid == 0) {
+    sigset_t none;
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, NULL);
+    // stdin은 /dev/null로 (xargs처럼): --manifest=-일 때 stdin을 읽는 작업이 남은 목록을 먹지 않도록
+    int null_fd = open("/dev/null", O_RDONLY);
+    if (null_fd > 0) {
+      dup2(null_fd, 0);
+      close(null_fd);
+    }
+    if (capture) dup2(out_pipe[1], 1);  // dup2로 만든 fd 1은 CLOEXEC가 아님
+    else if (s->cache_fd >= 0) dup2(s->cache_fd, 1);
+    int keep[1] = { err_pipe[1] };
+    fd_hygiene_apply(keep, 1);
+    if (timeout_ms > 0) {
+      struct itimerval it;
+      memset(&it, 0, sizeof(it));
+      it.it_value.tv_sec = timeout_ms / 1000;
+      it.it_value.tv_usec = (timeout_ms % 1000) * 1000;
+      setitimer(ITIMER_REAL, &it, NULL);
+    }
+    execvp(argv[0], argv);
+    int e = errno;
+    if (write(err_pipe[1], &e, sizeof(e)) < 0) { /* 부모가 127로 처리 */ }
+    _exit(127);
+  }
+  close(err_pipe[1]);
+  if (capture) close(out_pipe[1]);
+  s->pid = pid;
+  s->err_fd = err_pipe[0];
+  s->out_fd = out_pipe[0];
+  job_cmd(s, argv);
+  return 0;
+}
+
+/*
+ * 끝난 작업 하나를 집계 (exec 실패는 err 파이프에 남은 errno로 구분)
+ *
+ * err_fd가 -1이면 캐시에서 가져온 결과입니다. 반환값: exec 실패 errno (없으면 0)
+ */
+static int manifest_reaped(struct job_slot* s, int status, struct manifest_stat* st, FILE* log) {
+  int e = 0;
+  if (s->err_fd >= 0) {
+    if (read_full(s->err_fd, &e, sizeof(e)) != (ssize_t)sizeof(e)) e = 0;
+    close(s->err_fd);
+  }
+  s->err_fd = -1;
+  s->pid = 0;
+
+  char desc[64];
+  if (e != 0) {
+    st->exec_failed++;
+    snprintf(desc, sizeof(desc), "exec failed: %s", strerror(e));
+  } else if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+    st->ok++;
+    return 0;
+  } else {
+    if (WIFSIGNALED(status)) st->signaled++;
+    describe_status(status, desc, sizeof(desc));
+  }
+  st->failed++;
+  if (log && st->failed <= MANIFEST_SHOW_FAILED) {
+    fprintf(log, "[parent] Job #%ld failed (%s): %s%s\n", s->no, desc, s->cmd,
+           strlen(s->cmd) + 1 >= sizeof(s->cmd) ? "..." : "");
+  }
+  return e;
+}
+
+/*
+ * 결과 캐시 (--cache=DIR)
+ *
+ * 같은 작업을 다시 돌리는 것은 순수한 낭비이므로, 작업의 결과(종료 코드와 stdout)를
+ * 작업 내용의 해시로 찾는 파일에 저장해 두고 다음에는 fork 없이 그대로 돌려줍니다.
+ *
+ * 키: FNV-1a 128비트 해시
+ *   - 명령의 인수 (각각 끝의 '\0'까지)
+ *   - --cache-env에 적은 환경 변수의 이름과 값 (기본값 PATH, 없으면 없다는 표시)
+ *   - 줄 앞의 in=FILE로 적은 입력 파일의 경로와 내용 (없는 파일은 없다는 표시)
+ *   명령이 읽는 다른 것(시간, 네트워크, 적지 않은 파일)은 키에 없으므로 그런 작업은 캐시하면 안 됩니다.
+ *
+ * 저장소: 항목마다 DIR/<키 32자리 16진수> 파일 하나, 32바이트 머리 + stdout 바이트.
+ *   적중하면 파일을 mmap해 머리를 확인하고 출력 부분을 그대로 stdout에 씁니다.
+ *   실패하면 자식의 stdout을 이름 없는 파일(O_TMPFILE)로 받고, 끝난 뒤 머리를 채워
+ *   linkat()으로 이름을 붙입니다. 이름이 붙는 순간 완성된 항목만 보이므로
+ *   여러 실행기가 같은 디렉터리를 써도 반쯤 쓴 항목을 읽지 않습니다.
+ *   정상 종료만 저장합니다. (0이 아닌 종료 코드도 결과이므로 저장, 시그널과 exec 실패(127)는 제외)
+ *
+ * 축출: 실행이 끝나면 항목 크기의 합이 --cache-max를 넘지 않도록 가장 오래 쓰지 않은 항목부터 지웁니다.
+ *   (적중할 때마다 항목의 수정 시각을 갱신하므로 수정 시각이 곧 마지막 사용 시각)
+ */
+#define CACHE_MAGIC "PDCACHE1"
+
+struct cache_entry {
+  char magic[8];
+  int32_t status;    // waitpid 상태
+  uint32_t reserved;
+  uint64_t out_len;  // 이어지는 stdout 바이트 수
+  uint64_t run_us;   // 처음 실행했을 때 걸린 시간 (적중으로 아낀 시간 집계용)
+};
+
+static struct {
+  int dir_fd;
+  long hits, misses, stored, not_stored, evicted;
+  uint64_t stored_bytes, hit_bytes, evicted_bytes, total_bytes;
+  double saved_us, lookup_us;
+} cache = { .dir_fd = -1 };
+
+typedef unsigned __int128 fnv128_t;
+
+static fnv128_t fnv128_feed(fnv128_t h, const void* data, size_t len) {
+  const fnv128_t prime = ((fnv128_t)1 << 88) + 0x13B;
+  const unsigned char* p = data;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= p[i];
+    h *= prime;
+  }
+  return h;
+}
+
+static fnv128_t fnv128_str(fnv128_t h, const char* s) {
+  return fnv128_feed(h, s, strlen(s) + 1);  // '\0'까지 넣어 "ab c"와 "a bc"를 구분
+}
+
+// 작업 줄 앞의 in=FILE 개수 (캐시 키에 들어갈 입력 파일, 명령은 그 뒤부터)
+static int cache_inputs(char** argv) {
+  int n = 0;
+  while (argv[n] && strncmp(argv[n], "in=", 3) == 0) n++;
+  return n;
+}
+
+static fnv128_t cache_key(char** inputs, int ninputs, char** argv) {
+  fnv128_t h = ((fnv128_t)0x6c62272e07bb0142ULL << 64) | 0x62b821756295c58dULL;
+  for (int k = 0; argv[k]; ++k) h = fnv128_str(h, argv[k]);
+  h = fnv128_feed(h, "", 1);
+
+  char name[128];
+  for (const char* p = cache_env; p && *p; ) {
+    size_t len = strcspn(p, ",");
+    if (len > 0 && len < sizeof(name)) {
+      memcpy(name, p, len);
+      name[len] = '\0';
+      const char* v = getenv(name);
+      h = fnv128_str(h, name);
+      h = v ? fnv128_str(h, v) : fnv128_feed(h, "\1", 1);
+    }
+    p += len + (p[len] == ',');
+  }
+  h = fnv128_feed(h, "", 1);
+
+  for (int k = 0; k < ninputs; ++k) {
+    const char* path = inputs[k] + 3;
+    h = fnv128_str(h, path);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat sb;
+    if (fd < 0 || fstat(fd, &sb) < 0) {
+      h = fnv128_feed(h, "\1", 1);
+    } else if (sb.st_size > 0) {
+      void* m = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (m == MAP_FAILED) {
+        h = fnv128_feed(h, "\1", 1);
+      } else {
+        h = fnv128_feed(h, m, (size_t)sb.st_size);
+        munmap(m, (size_t)sb.st_size);
+      }
+    }
+    if (fd >= 0) close(fd);
+  }
+  return h;
+}
+
+static void cache_name(fnv128_t key, char* out) {
+  snprintf(out, 33, "%016llx%016llx", (unsigned long long)(key >> 64), (unsigned long long)key);
+}
+
+static int cache_open(void) {
+  mkdir(cache_dir, 0755);  // 이미 있으면 EEXIST
+  cache.dir_fd = open(cache_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (cache.dir_fd < 0) {
+    perror("[parent] cannot open cache directory");
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * 작업을 띄우기 전에 캐시 확인
+ *
+ * 적중하면 저장된 stdout을 쓰고 상태를 *status에 넣은 뒤 1을 반환합니다. (자식을 만들지 않음)
+ * 실패하면 자식 stdout을 받을 이름 없는 파일을 s->cache_fd에 준비하고 0을 반환합니다.
+ */
+static int cache_begin(char** inputs, int ninputs, char** argv, struct job_slot* s, int* status) {
+  double t = now_us();
+  s->cache_key = cache_key(inputs, ninputs, argv);
+  s->cache_fd = -1;
+  char name[33];
+  cache_name(s->cache_key, name);
+
+  int fd = openat(cache.dir_fd, name, O_RDONLY | O_CLOEXEC);
+  struct stat sb;
+  if (fd >= 0 && fstat(fd, &sb) == 0 && (size_t)sb.st_size >= sizeof(struct cache_entry)) {
+    void* m = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    const struct cache_entry* e = m;
+    if (m != MAP_FAILED && memcmp(e->magic, CACHE_MAGIC, 8) == 0 &&
+        e->out_len == (uint64_t)sb.st_size - sizeof(*e)) {
+      fflush(stdout);  // 앞서 printf로 쌓인 부모 출력보다 뒤에 나오도록
+      write_all(1, e + 1, (size_t)e->out_len);
+      *status = e->status;
+      cache.hits++;
+      cache.hit_bytes += e->out_len;
+      cache.saved_us += (double)e->run_us;
+      munmap(m, (size_t)sb.st_size);
+      futimens(fd, NULL);  // 마지막 사용 시각 (축출 순서)
+      close(fd);
+      cache.lookup_us += now_us() - t;
+      return 1;
+    }
+    if (m != MAP_FAILED) munmap(m, (size_t)sb.st_size);  // 다른 형식이면 실패로 보고 덮어씀
+  }
+  if (fd >= 0) close(fd);
+
+  cache.misses++;
+  int tmp = openat(cache.dir_fd, ".", O_TMPFILE | O_RDWR | O_CLOEXEC, 0644);
+  if (tmp >= 0 && lseek(tmp, sizeof(struct cache_entry), SEEK_SET) < 0) {
+    close(tmp);
+    tmp = -1;
+  }
+  s->cache_fd = tmp;  // 준비하지 못하면 캐시 없이 실행 (not stored로 집계)
+  cache.lookup_us += now_us() - t;
+  return 0;
+}
+
+/*
+ * 캐시를 거쳐 실행한 작업이 끝난 뒤: 받은 stdout을 내보내고, 저장할 결과면 항목으로 게시
+ *
+ * exec_errno는 manifest_reaped()가 돌려준 exec 실패 errno입니다.
+ */
+static void cache_finish(struct job_slot* s, int status, int exec_errno) {
+  int fd = s->cache_fd;
+  s->cache_fd = -1;
+  if (fd < 0) {
+    cache.not_stored++;
+    return;
+  }
+  struct stat sb;
+  uint64_t out_len = 0;
+  if (fstat(fd, &sb) == 0 && (size_t)sb.st_size > sizeof(struct cache_entry)) {
+    out_len = (uint64_t)sb.st_size - sizeof(struct cache_entry);
+    void* m = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (m != MAP_FAILED) {
+      fflush(stdout);
+      write_all(1, (const char*)m + sizeof(struct cache_entry), (size_t)out_len);
+      munmap(m, (size_t)sb.st_size);
+    }
+  }
+
+  int keep = exec_errno == 0 && WIFEXITED(status) && WEXITSTATUS(status) != 127;
+  struct cache_entry e;
+  memset(&e, 0, sizeof(e));
+  memcpy(e.magic, CACHE_MAGIC, 8);
+  e.status = status;
+  e.out_len = out_len;
+  e.run_us = (uint64_t)(now_us() - s->t_start);
+  char proc_path[64], name[33];
+  snprintf(proc_path, sizeof(proc_path), "/proc/self/fd/%d", fd);
+  cache_name(s->cache_key, name);
+  if (keep && pwrite(fd, &e, sizeof(e), 0) == (ssize_t)sizeof(e)) {
+    unlinkat(cache.dir_fd, name, 0);  // 형식이 달라 덮어쓰는 경우, 없으면 ENOENT
+    if (linkat(AT_FDCWD, proc_path, cache.dir_fd, name, AT_SYMLINK_FOLLOW) == 0 || errno == EEXIST) {
+      cache.stored++;
+      cache.stored_bytes += sizeof(e) + out_len;
+      close(fd);
+      return;
+    }
+  }
+  cache.not_stored++;
+  close(fd);
+}
+
+struct cache_file {
+  char name[33];  // 키 32자리 + NUL
+  off_t size;
+  struct timespec used;
+};
+
+static int cmp_cache_used(const void* a, const void* b) {
+  const struct timespec* x = &((const struct cache_file*)a)->used;
+  const struct timespec* y = &((const struct cache_file*)b)->used;
+  if (x->tv_sec != y->tv_sec) return x->tv_sec < y->tv_sec ? -1 : 1;
+  return x->tv_nsec < y->tv_nsec ? -1 : x->tv_nsec > y->tv_nsec;
+}
+
+// 항목 크기 합이 --cache-max 이하가 되도록 가장 오래 쓰지 않은 항목부터 삭제
+static void cache_evict(void) {
+  int dfd = dup(cache.dir_fd);
+  DIR* d = dfd >= 0 ? fdopendir(dfd) : NULL;
+  if (d == NULL) return;
+  struct cache_file* files = NULL;
+  size_t n = 0, cap = 0;
+  struct dirent* de;
+  while ((de = readdir(d)) != NULL) {
+    struct stat sb;
+    if (strlen(de->d_name) != 32 || fstatat(cache.dir_fd, de->d_name, &sb, 0) < 0) continue;
+    if (n == cap) {
+      cap = cap ? cap * 2 : 256;
+      struct cache_file* nf = realloc(files, cap * sizeof(*files));
+      if (nf == NULL) break;
+      files = nf;
+    }
+    memcpy(files[n].name, de->d_name, 33);  // 위에서 32자임을 확인했으므로 NUL까지 그대로 복사
+    files[n].size = sb.st_size;
+    files[n].used = sb.st_mtim;
+    cache.total_bytes += (uint64_t)sb.st_size;
+    n++;
+  }
+  closedir(d);
+  if (cache.total_bytes > (uint64_t)cache_max) {
+    qsort(files, n, sizeof(*files), cmp_cache_used);
+    for (size_t i = 0; i < n && cache.total_bytes > (uint64_t)cache_max; ++i) {
+      if (unlinkat(cache.dir_fd, files[i].name, 0) < 0) continue;
+      cache.total_bytes -= (uint64_t)files[i].size;
+      cache.evicted++;
+      cache.evicted_bytes += (uint64_t)files[i].size;
+    }
+  }
+  free(files);
+}
+
+static void print_cache_stat(void) {
+  long lookups = cache.hits + cache.misses;
+  printf("[parent] Cache %s: %ld hits, %ld misses (hit rate %.1f%%), %ld stored (%llu bytes), "
+         "%ld not stored\n",
+         cache_dir, cache.hits, cache.misses, lookups ? 100.0 * cache.hits / lookups : 0.0,
+         cache.stored, (unsigned long long)cache.stored_bytes, cache.not_stored);
+  printf("[parent]   hits replayed %llu bytes and saved %.1f ms of child run time, "
+         "lookup %.1f us/job (key hash + open)\n",
+         (unsigned long long)cache.hit_bytes, cache.saved_us / 1e3,
+         lookups ? cache.lookup_us / lookups : 0.0);
+  printf("[parent]   store %llu bytes after evicting %ld entries (%llu bytes, --cache-max=%lld)\n",
+         (unsigned long long)cache.total_bytes, cache.evicted,
+         (unsigned long long)cache.evicted_bytes, cache_max);
+}
+
+/*
+ * 실행 시간 기록 (--history=FILE)
+ *
+ * 작업마다 실행 시간과 최대 RSS를 파일에 남겨 두고, 다음 실행에서 순서를 정하는 데 씁니다.
+ * 작업의 정체는 명령 인수의 FNV-1a 128비트 해시입니다. (캐시 키와 달리 환경과 입력은 넣지 않음)
+ *
+ * 파일은 고정 크기 해시 표 하나이고(선형 탐사), 통째로 MAP_SHARED로 mmap해서
+ * 읽기/갱신이 곧 메모리 접근입니다. 기록은 munmap할 때(또는 커널이 알아서) 파일에 반영됩니다.
+ * 파일은 ftruncate로 늘려 만들므로 쓰지 않은 칸은 디스크를 차지하지 않습니다. (희소 파일)
+ * 잠금은 없습니다: 두 실행기가 같은 기록을 동시에 갱신하면 한쪽 측정이 덮이는 정도입니다.
+ *
+ * 예상 시간은 최근 실행에 절반의 무게를 주는 지수 평균, 예상 메모리는 지금까지의 최댓값입니다.
+ * (메모리는 넘치면 곤란하므로 보수적으로)
+ *
+ * 표가 3/4 넘게 차면 새 작업은 자기 탐사 경로에서 실행 횟수가 가장 적은 기록을 밀어내고
+ * 그 칸을 씁니다. 칸이 비지 않으므로 다른 키의 탐사 경로는 그대로입니다.
+ */
+#define HISTORY_MAGIC "PDHIST01"
+#define HISTORY_SLOTS 65536
+
+struct history_rec {
+  uint64_t key_hi, key_lo;  // 둘 다 0이면 빈 칸
+  uint32_t runs;
+  uint32_t rss_kb;          // 지금까지 가장 큰 최대 RSS
+  uint64_t dur_us;          // 실행 시간 지수 평균
+};
+
+struct history_file {
+  char magic[8];
+  uint32_t nslots;
+  uint32_t used;
+  uint64_t reserved[2];     // 머리도 기록 하나 크기 (32바이트)
+  struct history_rec rec[];
+};
+
+static struct {
+  struct history_file* map;
+  size_t size;
+  long hits, misses;        // 예측 조회 결과
+  long evicted, full;       // 표가 차서 밀어낸 기록 수, 밀어낼 기록도 없어 못 남긴 수
+} history;
+
+static fnv128_t history_key(char** argv) {
+  fnv128_t h = ((fnv128_t)0x6c62272e07bb0142ULL << 64) | 0x62b821756295c58dULL;
+  for (int k = 0; argv[k]; ++k) h = fnv128_str(h, argv[k]);
+  return h;
+}
+
+static int history_open(const char* path) {
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  struct stat sb;
+  if (fd < 0 || fstat(fd, &sb) < 0) {
+    perror("[parent] cannot open history");
+    if (fd >= 0) close(fd);
+    return -1;
+  }
+  size_t size = sizeof(struct history_file) + (size_t)HISTORY_SLOTS * sizeof(struct history_rec);
+  int fresh = sb.st_size == 0;
+  if (!fresh && (size_t)sb.st_size != size) {
+    fprintf(stderr, "[parent] %s is not a history file (%lld bytes)\n", path, (long long)sb.st_size);
+    close(fd);
+    return -1;
+  }
+  if (fresh && ftruncate(fd, (off_t)size) < 0) {
+    perror("[parent] ftruncate failed");
+    close(fd);
+    return -1;
+  }
+  void* m = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);  // 매핑은 fd를 닫아도 유지
+  if (m == MAP_FAILED) {
+    perror("[parent] mmap failed");
+    return -1;
+  }
+  history.map = m;
+  history.size = size;
+  if (fresh) {
+    memcpy(history.map->magic, HISTORY_MAGIC, 8);
+    history.map->nslots = HISTORY_SLOTS;
+  } else if (memcmp(history.map->magic, HISTORY_MAGIC, 8) != 0 || history.map->nslots != HISTORY_SLOTS) {
+    fprintf(stderr, "[parent] %s is not a history file\n", path);
+    munmap(m, size);
+    history.map = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+// 키의 칸을 찾음 (create면 빈 칸을 차지하거나, 표가 찼으면 경로의 기록을 밀어냄), 없으면 NULL
+static struct history_rec* history_find(fnv128_t key, int create) {
+  uint64_t hi = (uint64_t)(key >> 64), lo = (uint64_t)key;
+  if (hi == 0 && lo == 0) lo = 1;  // 0은 빈 칸 표시
+  uint32_t n = history.map->nslots;
+  struct history_rec* victim = NULL;
+  for (uint32_t probe = 0, i = (uint32_t)lo & (n - 1); probe < n; ++probe, i = (i + 1) & (n - 1)) {
+    struct history_rec* r = &history.map->rec[i];
+    if (r->key_hi == hi && r->key_lo == lo) return r;
+    if (r->key_hi == 0 && r->key_lo == 0) {
+      if (!create) return NULL;
+      if (history.map->used < n / 4 * 3) {  // 3/4 넘게 차면 탐사가 길어지므로 빈 칸은 더 쓰지 않음
+        r->key_hi = hi;
+        r->key_lo = lo;
+        history.map->used++;
+        return r;
+      }
+      break;
+    }
+    if (victim == NULL || r->runs < victim->runs) victim = r;
+  }
+  if (victim == NULL) return NULL;
+  history.evicted++;
+  memset(victim, 0, sizeof(*victim));
+  victim->key_hi = hi;
+  victim->key_lo = lo;
+  return victim;
+}
+
+// 예상 시간(us)과 메모리(kB), 기록이 없으면 0을 반환
+static int history_predict(fnv128_t key, double* dur_us, long* rss_kb) {
+  const struct history_rec* r = history.map ? history_find(key, 0) : NULL;
+  if (r == NULL || r->runs == 0) {
+    history.misses++;
+    return 0;
+  }
+  history.hits++;
+  *dur_us = (double)r->dur_us;
+  *rss_kb = r->rss_kb;
+  return 1;
+}
+
+static void history_record(fnv128_t key, double dur_us, long rss_kb) {
+  struct history_rec* r = history_find(key, 1);
+  if (r == NULL) {
+    history.full++;
+    return;
+  }
+  r->dur_us = r->runs ? (r->dur_us + (uint64_t)dur_us) / 2 : (uint64_t)dur_us;
+  if ((uint32_t)rss_kb > r->rss_kb) r->rss_kb = (uint32_t)rss_kb;
+  r->runs++;
+}
+
+static void history_close(void) {
+  if (history.map == NULL) return;
+  munmap(history.map, history.size);
+  history.map = NULL;
+}
+
+/*
+ * 캐시를 거쳐 작업 시작
+ *
+ * argv 앞의 in=FILE을 떼고 실행합니다. 캐시에 있으면 자식 없이 바로 집계하고 1을 반환,
+ * 띄웠으면 0, fork에 실패하면 -1을 반환합니다.
+ */
+static int start_job(char** argv, struct job_slot* s, struct manifest_stat* st, FILE* log) {
+  int nin = cache_inputs(argv);
+  s->cache_fd = -1;
+  if (argv[nin] == NULL) {
+    errno = EINVAL;  // in=FILE만 있고 명령이 없는 줄
+    return -1;
+  }
+  if (history.map) s->history_key = history_key(argv + nin);
+  if (cache_dir) {
+    int status = 0;
+    if (cache_begin(argv, nin, argv + nin, s, &status)) {
+      job_cmd(s, argv + nin);
+      s->err_fd = -1;
+      manifest_reaped(s, status, st, log);
+      return 1;
+    }
+  }
+  if (spawn_job(argv + nin, s, 0) < 0) {
+    if (s->cache_fd >= 0) close(s->cache_fd);
+    s->cache_fd = -1;
+    return -1;
+  }
+  return 0;
+}
+
+// start_job()으로 띄운 작업 수거 (캐시에 저장할 결과면 저장, exec된 작업은 실행 시간 기록)
+static void finish_job(struct job_slot* s, int status, const struct rusage* ru,
+                       struct manifest_stat* st, FILE* log) {
+  double dur_us = now_us() - s->t_start;
+  int e = manifest_reaped(s, status, st, log);
+  if (cache_dir) cache_finish(s, status, e);
+  if (history.map && e == 0) history_record(s->history_key, dur_us, ru->ru_maxrss);
+}
+
+/*
+ * 목록을 끝까지 실행
+ *
+ * run_pool()과 같은 구조입니다: 빈 칸이 있으면 다음 작업을 띄우고,
+ * 칸이 다 차면 waitpid(-1)로 아무 작업이나 하나 끝나기를 기다립니다.
+ */
+static void run_manifest(FILE* fp, int fmt, int k, struct manifest_stat* st, int verbose) {
+  struct job_slot* slots = calloc((size_t)k, sizeof(*slots));
+  struct pid_map live;
+  char* argv[MANIFEST_MAX_ARGS + 1];
+  char* buf = NULL;
+  size_t cap = 0;
+  if (slots == NULL || pidmap_init(&live, k) < 0) {
+    perror("[parent] calloc failed");
+    exit(1);
+  }
+  memset(st, 0, sizeof(*st));
+
+  double t0 = now_us(), cpu0 = cpu_time_us();
+  int nlive = 0, eof = 0, free_slot = 0;
+  while (!eof || nlive > 0) {
+    // 1. 빈 칸을 채움
+    while (!eof && nlive < k) {
+      int argc = manifest_next(fp, fmt, &buf, &cap, argv);
+      if (argc <= 0) {
+        if (argc < 0) {
+          st->bad_records++;
+          fprintf(stderr, "[parent] Bad binary record after job #%ld, stopping\n", st->jobs);
+        }
+        eof = 1;
+        break;
+      }
+      while (slots[free_slot].pid != 0) free_slot = (free_slot + 1) % k;
+      struct job_slot* s = &slots[free_slot];
+      s->no = ++st->jobs;
+      int r = start_job(argv, s, st, verbose ? stdout : NULL);
+      if (r != 0) {
+        if (r < 0) {
+          perror("[parent] fork failed");
+          st->failed++;
+        }
+        continue;
+      }
+      pidmap_put(&live, s->pid, free_slot);
+      nlive++;
+    }
+    if (nlive == 0) continue;
+
+    // 2. 아무 작업이나 하나 끝나기를 기다렸다가 수거
+    int status = 0;
+    struct rusage ru;
+    pid_t pid = wait4(-1, &status, 0, &ru);
+    if (pid < 0) {
+      if (errno == EINTR) continue;
+      perror("[parent] wait4 failed");
+      break;
+    }
+    int i = pidmap_take(&live, pid);
+    if (i < 0) continue;
+    finish_job(&slots[i], status, &ru, st, verbose ? stdout : NULL);
+    free_slot = i;
+    nlive--;
+  }
+  st->wall_us = now_us() - t0;
+  st->cpu_us = cpu_time_us() - cpu0;
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  st->maxrss_kb = ru.ru_maxrss;
+  free(buf);
+  pidmap_free(&live);
+  free(slots);
+}
+
+/*
+ * 제출 순서대로 출력하기 (--keep-order, 작업 목록 실행기)
+ *
+ * 작업은 동시에 돌고 끝나는 순서도 제각각이지만, 출력은 작업 번호 순서대로 내보냅니다.
+ * 작업마다 stdout을 파이프로 받아 재정렬 버퍼(reorder buffer)에 모으고,
+ * "앞의 작업이 모두 끝난" 접두사가 생기는 즉시 내보냅니다.
+ *
+ * - 머리(head): 아직 내보내지 않은 가장 앞 번호의 작업. 이 작업의 출력은 모으지 않고
+ *   도착하는 대로 바로 내보내므로, 머리 작업이 오래 걸려도 그 출력은 늦어지지 않습니다.
+ * - 머리 뒤의 작업은 출력을 메모리에 모읍니다. 합계가 --keep-order-mem을 넘으면
+ *   머리에서 가장 먼 작업부터 임시 파일로 내려 씁니다(spill). 가장 늦게 내보낼 것이므로.
+ * - 머리가 끝나면 다음 작업의 모인 출력을 (파일 부분, 메모리 부분 순서로) 내보내고,
+ *   그 작업도 끝났으면 계속 넘어가며, 아니면 그 작업이 새 머리가 되어 바로 출력합니다.
+ *
+ * 머리에서 너무 멀리 앞서가지 않도록, 머리 번호 + 창 크기(작업 칸 수의 REORDER_WINDOW_PER_SLOT배)
+ * 이상인 작업은 시작하지 않습니다. 그래서 버퍼의 항목 수도 일정하게 묶입니다.
+ * 자식의 종료는 signalfd로 받은 SIGCHLD로, 출력은 poll()로 함께 기다립니다.
+ */
+#define REORDER_WINDOW_PER_SLOT 16
+#define REORDER_READ_CHUNK (64 * 1024)
+
+struct ro_seg {       // 임시 파일로 내려 쓴 출력 조각
+  off_t off;
+  size_t len;
+};
+
+struct ro_entry {
+  long no;            // 작업 번호 (0이면 빈 칸)
+  int done;           // 출력 EOF와 수거가 모두 끝났으면 1
+  int spilled;        // 1이면 이후 출력도 임시 파일로 바로 씀 (순서 유지)
+  char* mem;          // 메모리에 모은 출력
+  size_t mem_len, mem_cap;
+  struct ro_seg* segs;
+  int nseg, segcap;
+  double t_done;
+};
+
+static struct {
+  struct ro_entry* ring;   // 작업 #no는 ring[no % window]
+  long window;
+  long head;               // 다음에 내보낼 작업 번호
+  size_t mem_limit, mem_used, mem_peak;
+  int spill_fd;            // 이름 없는 임시 파일 (없으면 -1)
+  off_t spill_end;
+  unsigned long long spilled_bytes, emitted_bytes;
+  long spills;
+  struct lat_hist hol;     // 작업이 끝난 뒤 출력이 다 나가기까지 기다린 시간 (head-of-line)
+} ro;
+
+static struct ro_entry* ro_at(long no) {
+  return &ro.ring[no % ro.window];
+}
+
+static void ro_emit(const char* p, size_t len) {
+  fwrite(p, 1, len, stdout);
+  ro.emitted_bytes += len;
+}
+
+static int ro_spill_open(void) {
+  if (ro.spill_fd >= 0) return 0;
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/proc_demo-reorder-XXXXXX");
+  ro.spill_fd = mkostemp(path, O_CLOEXEC);
+  if (ro.spill_fd < 0) return -1;
+  unlink(path);  // 이름을 지워 두면 끝나거나 죽을 때 자동으로 사라짐
+  return 0;
+}
+
+static int ro_spill_write(struct ro_entry* e, const char* p, size_t len) {
+  if (ro_spill_open() < 0) return -1;
+  if (e->nseg == e->segcap) {
+    int cap = e->segcap ? e->segcap * 2 : 4;
+    struct ro_seg* s = realloc(e->segs, (size_t)cap * sizeof(*s));
+    if (s == NULL) return -1;
+    e->segs = s;
+    e->segcap = cap;
+  }
+  for (size_t done = 0; done < len; ) {
+    ssize_t n = pwrite(ro.spill_fd, p + done, len - done, ro.spill_end + (off_t)done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return -1;
+    done += (size_t)n;
+  }
+  // 바로 앞 조각에 이어지면 합침 (한 작업만 계속 쓰는 흔한 경우)
+  struct ro_seg* last = e->nseg ? &e->segs[e->nseg - 1] : NULL;
+  if (last && last->off + (off_t)last->len == ro.spill_end) {
+    last->len += len;
+  } else {
+    e->segs[e->nseg].off = ro.spill_end;
+    e->segs[e->nseg].len = len;
+    e->nseg++;
+  }
+  ro.spill_end += (off_t)len;
+  ro.spilled_bytes += len;
+  return 0;
+}
+
+// 메모리 한도를 넘었으면 머리에서 가장 먼 작업부터 임시 파일로 내려 씀
+static void ro_enforce_limit(long newest) {
+  for (long no = newest; ro.mem_used > ro.mem_limit && no > ro.head; --no) {
+    struct ro_entry* e = ro_at(no);
+    if (e->no != no || e->mem_len == 0) continue;
+    if (ro_spill_write(e, e->mem, e->mem_len) < 0) {
+      perror("[parent] reorder spill failed, keeping output in memory");
+      return;
+    }
+    ro.mem_used -= e->mem_len;
+    free(e->mem);
+    e->mem = NULL;
+    e->mem_len = e->mem_cap = 0;
+    e->spilled = 1;
+    ro.spills++;
+  }
+}
+
+// 작업 #no의 출력 조각 도착
+static void ro_append(long no, const char* p, size_t len, long newest) {
+  if (no == ro.head) {
+    ro_emit(p, len);  // 머리는 모으지 않고 바로 출력
+    return;
+  }
+  struct ro_entry* e = ro_at(no);
+  if (e->spilled) {
+    if (ro_spill_write(e, p, len) == 0) return;
+    e->spilled = 0;  // 쓰기 실패: 메모리로 계속 (조각 뒤에 이어 붙으므로 순서는 유지)
+  }
+  if (e->mem_len + len > e->mem_cap) {
+    size_t cap = e->mem_cap ? e->mem_cap : 4096;
+    while (cap < e->mem_len + len) cap *= 2;
+    char* m = realloc(e->mem, cap);
+    if (m == NULL) {
+      perror("[parent] reorder buffer allocation failed");
+      exit(1);
+    }
+    e->mem = m;
+    e->mem_cap = cap;
+  }
+  memcpy(e->mem + e->mem_len, p, len);
+  e->mem_len += len;
+  ro.mem_used += len;
+  ro_enforce_limit(newest);
+  if (ro.mem_used > ro.mem_peak) ro.mem_peak = ro.mem_used;
+}
+
+// 모아 둔 출력을 (파일 조각, 메모리 순서로) 내보내고 항목을 비움
+static void ro_flush_entry(struct ro_entry* e) {
+  char buf[REORDER_READ_CHUNK];
+  for (int k = 0; k < e->nseg; ++k) {
+    for (size_t done = 0; done < e->segs[k].len; ) {
+      size_t want = e->segs[k].len - done < sizeof(buf) ? e->segs[k].len - done : sizeof(buf);
+      ssize_t n = pread(ro.spill_fd, buf, want, e->segs[k].off + (off_t)done);
+      if (n <= 0) break;
+      ro_emit(buf, (size_t)n);
+      done += (size_t)n;
+    }
+  }
+  if (e->mem_len) ro_emit(e->mem, e->mem_len);
+  ro.mem_used -= e->mem_len;
+  free(e->mem);
+  free(e->segs);
+  e->mem = NULL;
+  e->segs = NULL;
+  e->mem_len = e->mem_cap = 0;
+  e->nseg = e->segcap = 0;
+  e->spilled = 0;
+}
+
+// 머리 작업이 끝났으면 끝난 접두사를 모두 내보내고 머리를 옮김
+static void ro_advance(void) {
+  for (;;) {
+    struct ro_entry* e = ro_at(ro.head);
+    if (e->no != ro.head) return;  // 아직 시작하지 않은 작업
+    ro_flush_entry(e);             // 새 머리: 모인 출력부터 내보냄 (이후는 바로 출력)
+    if (!e->done) return;
+    hist_add(&ro.hol, now_us() - e->t_done);
+    e->no = 0;
+    ro.head++;
+  }
+}
+
+// 내려 쓴 출력이 모두 나갔으면 임시 파일을 비워 처음부터 다시 씀 (한 번 커진 파일이 남지 않도록)
+static void ro_maybe_truncate(void) {
+  if (ro.spill_fd < 0 || ro.spill_end == 0) return;
+  for (long no = ro.head; no < ro.head + ro.window; ++no) {
+    struct ro_entry* e = ro_at(no);
+    if (e->no == no && e->nseg > 0) return;
+  }
+  if (ftruncate(ro.spill_fd, 0) == 0) ro.spill_end = 0;
+}
+
+// 작업 하나의 출력 EOF와 수거가 모두 끝남
+static void ro_job_done(long no) {
+  struct ro_entry* e = ro_at(no);
+  e->done = 1;
+  e->t_done = now_us();
+  if (no == ro.head) {
+    ro_advance();
+    ro_maybe_truncate();
+  }
+}
+
+/*
+ * 순서 유지 실행 루프 (run_manifest()의 --keep-order 판)
+ *
+ * waitpid()에서 잠드는 대신 poll()로 작업들의 출력 파이프와 SIGCHLD signalfd를 함께 기다립니다.
+ * 작업 칸은 출력 EOF와 수거가 모두 끝나야 비므로 파이프 수도 칸 수(K)를 넘지 않습니다.
+ */
+static void run_manifest_ordered(FILE* fp, int fmt, int k, struct manifest_stat* st, int verbose) {
+  struct job_slot* slots = calloc((size_t)k, sizeof(*slots));
+  struct pollfd* pfds = calloc((size_t)k + 1, sizeof(*pfds));
+  int* pslot = calloc((size_t)k + 1, sizeof(int));
+  struct pid_map live;
+  char* argv[MANIFEST_MAX_ARGS + 1];
+  char* buf = NULL;
+  size_t cap = 0;
+  static char chunk[REORDER_READ_CHUNK];
+
+  memset(&ro, 0, sizeof(ro));
+  ro.window = (long)k * REORDER_WINDOW_PER_SLOT;
+  ro.ring = calloc((size_t)ro.window, sizeof(*ro.ring));
+  ro.head = 1;
+  ro.mem_limit = keep_order_mem;
+  ro.spill_fd = -1;
+  if (slots == NULL || pfds == NULL || pslot == NULL || ro.ring == NULL || pidmap_init(&live, k) < 0) {
+    perror("[parent] calloc failed");
+    exit(1);
+  }
+  memset(st, 0, sizeof(*st));
+
+  sigset_t mask, old;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &mask, &old);
+  int sig_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (sig_fd < 0) {
+    perror("[parent] signalfd failed");
+    exit(1);
+  }
+  for (int i = 0; i < k; ++i) slots[i].out_fd = slots[i].cache_fd = -1;
+
+  double t0 = now_us(), cpu0 = cpu_time_us();
+  int nbusy = 0, eof = 0;
+  while (!eof || nbusy > 0) {
+    // 1. 빈 칸을 채움 (머리에서 창 크기 이상 앞서가지 않음)
+    while (!eof && nbusy < k && st->jobs + 1 < ro.head + ro.window) {
+      int argc = manifest_next(fp, fmt, &buf, &cap, argv);
+      if (argc <= 0) {
+        if (argc < 0) {
+          st->bad_records++;
+          fprintf(stderr, "[parent] Bad binary record after job #%ld, stopping\n", st->jobs);
+        }
+        eof = 1;
+        break;
+      }
+      int i = 0;
+      while (slots[i].pid != 0 || slots[i].out_fd >= 0) i++;
+      struct job_slot* s = &slots[i];
+      s->no = ++st->jobs;
+      struct ro_entry* e = ro_at(s->no);
+      memset(e, 0, sizeof(*e));
+      e->no = s->no;
+      if (history.map) s->history_key = history_key(argv + cache_inputs(argv));
+      if (spawn_job(argv + cache_inputs(argv), s, 1) < 0) {
+        perror("[parent] fork failed");
+        st->failed++;
+        ro_job_done(s->no);
+        continue;
+      }
+      pidmap_put(&live, s->pid, i);
+      nbusy++;
+    }
+    if (nbusy == 0) continue;
+
+    // 2. 출력과 자식 종료를 함께 기다림 (기다리기 전에 내보낸 출력을 비움)
+    fflush(stdout);
+    int n = 0;
+    pfds[n].fd = sig_fd;
+    pfds[n].events = POLLIN;
+    pslot[n++] = -1;
+    for (int i = 0; i < k; ++i) {
+      if (slots[i].out_fd < 0) continue;
+      pfds[n].fd = slots[i].out_fd;
+      pfds[n].events = POLLIN;
+      pslot[n++] = i;
+    }
+    if (poll(pfds, (nfds_t)n, -1) < 0) {
+      if (errno == EINTR) continue;
+      perror("[parent] poll failed");
+      break;
+    }
+
+    // 3. 출력 읽기 (EOF면 파이프를 닫음)
+    for (int j = 1; j < n; ++j) {
+      if (!(pfds[j].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+      struct job_slot* s = &slots[pslot[j]];
+      ssize_t got = read(s->out_fd, chunk, sizeof(chunk));
+      if (got < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+      if (got > 0) {
+        ro_append(s->no, chunk, (size_t)got, st->jobs);
+        continue;
+      }
+      close(s->out_fd);
+      s->out_fd = -1;
+      if (s->pid == 0) {  // 이미 수거됨
+        ro_job_done(s->no);
+        nbusy--;
+      }
+    }
+
+    // 4. 끝난 자식 수거 (SIGCHLD는 합쳐질 수 있으므로 WNOHANG으로 모두)
+    if (pfds[0].revents & POLLIN) {
+      struct signalfd_siginfo si;
+      while (read(sig_fd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {}
+      int status;
+      pid_t pid;
+      struct rusage ru;
+      while ((pid = wait4(-1, &status, WNOHANG, &ru)) > 0) {
+        int i = pidmap_take(&live, pid);
+        if (i < 0) continue;
+        struct job_slot* s = &slots[i];
+        long no = s->no;
+        finish_job(s, status, &ru, st, verbose ? stderr : NULL);  // 순서 있는 출력에 끼지 않도록
+        if (s->out_fd < 0) {  // 출력도 이미 끝남
+          ro_job_done(no);
+          nbusy--;
+        }
+      }
+    }
+  }
+  fflush(stdout);
+  st->wall_us = now_us() - t0;
+  st->cpu_us = cpu_time_us() - cpu0;
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  st->maxrss_kb = ru.ru_maxrss;
+
+  close(sig_fd);
+  sigprocmask(SIG_SETMASK, &old, NULL);
+  if (ro.spill_fd >= 0) close(ro.spill_fd);
+  free(ro.ring);
+  free(buf);
+  free(pfds);
+  free(pslot);
+  pidmap_free(&live);
+  free(slots);
+}
+
+static void print_reorder_report(void) {
+  printf("[parent] Reorder buffer: %llu bytes emitted in job order, peak %zu bytes in memory"
+         " (limit %zu), %llu bytes spilled in %ld spill(s), window %ld jobs\n",
+         ro.emitted_bytes, ro.mem_peak, ro.mem_limit, ro.spilled_bytes, ro.spills, ro.window);
+  printf("[parent]   head-of-line wait after a job finished: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+         hist_pct(&ro.hol, 50), hist_pct(&ro.hol, 99), ro.hol.max_us);
+}
+
+static void print_manifest_stat(const struct manifest_stat* st, int k) {
+  printf("\n[parent] Manifest: %ld jobs, %ld ok, %ld failed (%ld exec failure(s), %ld killed by signal)\n",
+         st->jobs, st->ok, st->failed, st->exec_failed, st->signaled);
+  printf("[parent] %ld jobs in %.1f ms with --jobs=%d (%.0f jobs/s, %.1f us/job wall, "
+         "%.1f us/job runner CPU, max RSS %ld kB)\n",
+         st->jobs, st->wall_us / 1e3, k, st->jobs / (st->wall_us / 1e6),
+         st->jobs ? st->wall_us / st->jobs : 0.0, st->jobs ? st->cpu_us / st->jobs : 0.0,
+         st->maxrss_kb);
+}
+
+/*
+ * 실행기 비교 (--manifest-bench=N)
+ *
+ * /bin/true N개짜리 목록을 text와 bin 형식으로 만들어 이 실행기로 돌리고,
+ * 같은 text 목록을 xargs -P K -L 1 /bin/true로도 돌려 처리량을 비교합니다.
+ * (xargs는 줄을 인수로 붙이므로 exec 횟수와 인수 개수가 같아지도록 /bin/true를 명령으로 줌)
+ * 작업 자체는 거의 0이므로 us/job은 작업 하나당 실행기의 부담(생성, 수거, 파싱)입니다.
+ */
+static int manifest_tmp(char* path, size_t len) {
+  snprintf(path, len, "/tmp/proc_demo-manifest-XXXXXX");
+  return mkstemp(path);
+}
+
+static void run_manifest_bench(int n, int k) {
+  char text_path[64], bin_path[64];
+  int tfd = manifest_tmp(text_path, sizeof(text_path));
+  int bfd = manifest_tmp(bin_path, sizeof(bin_path));
+  FILE* tf = tfd >= 0 ? fdopen(tfd, "w") : NULL;
+  FILE* bf = bfd >= 0 ? fdopen(bfd, "w") : NULL;
+  if (tf == NULL || bf == NULL) {
+    perror("[parent] cannot create manifest files");
+    return;
+  }
+  static const char cmd[] = "/bin/true";
+  uint32_t argc = 1, len = sizeof(cmd) - 1;
+  for (int i = 0; i < n; ++i) {
+    fprintf(tf, "%s\n", cmd);
+    fwrite(&argc, sizeof(argc), 1, bf);
+    fwrite(&len, sizeof(len), 1, bf);
+    fwrite(cmd, 1, len, bf);
+  }
+  fclose(tf);
+  fclose(bf);
 
-// 전역 변수: 현재 프로세스가 자식인지, 몇 번째 자식인지 저장
-static int is_child = 0;    // 1이면 자식 프로세스, 0이면 부모 프로세스
-static int child_idx = 0;   // 자식 프로세스의 인덱스 번호 (1, 2, ...)
+  printf("\n[parent] Manifest runner vs xargs, %d x %s, %d at a time:\n", n, cmd, k);
+  printf("  %-22s %9s %10s %10s %10s\n", "runner", "jobs", "wall ms", "jobs/s", "us/job");
+
+  // xargs -P K -L 1 /bin/true < 목록
+  double t0 = now_us();
+  pid_t pid = fork();
+  if (pid == 0) {
+    char kbuf[16];
+    snprintf(kbuf, sizeof(kbuf), "%d", k);
+    int fd = open(text_path, O_RDONLY);
+    if (fd < 0 || dup2(fd, 0) < 0) _exit(127);
+    execlp("xargs", "xargs", "-P", kbuf, "-L", "1", cmd, (char*)NULL);
+    _exit(127);
+  }
+  int status = 0;
+  if (pid > 0) waitpid(pid, &status, 0);
+  double wall = now_us() - t0;
+  if (pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+    printf("  %-22s %9d %10.1f %10.0f %10.1f\n", "xargs -P K -L 1 true", n, wall / 1e3,
+           n / (wall / 1e6), wall / n);
+  } else {
+    printf("  %-22s unavailable (xargs not found or failed)\n", "xargs -P K -L 1 true");
+  }
+
+  static const struct { const char* name; int fmt; } rows[] = {
+    { "proc_demo text", MANIFEST_TEXT },
+    { "proc_demo bin", MANIFEST_BIN },
+  };
+  for (size_t r = 0; r < sizeof(rows) / sizeof(rows[0]); ++r) {
+    struct manifest_stat st;
+    FILE* fp = fopen(rows[r].fmt == MANIFEST_TEXT ? text_path : bin_path, "r");
+    if (fp == NULL) continue;
+    run_manifest(fp, rows[r].fmt, k, &st, 1);
+    fclose(fp);
+    printf("  %-22s %9ld %10.1f %10.0f %10.1f  (runner CPU %.1f us/job, %ld failed)\n",
+           rows[r].name, st.jobs, st.wall_us / 1e3, st.jobs / (st.wall_us / 1e6),
+           st.wall_us / st.jobs, st.cpu_us / st.jobs, st.failed);
+  }
+  unlink(text_path);
+  unlink(bin_path);
+}
 
 /*
- * 명령행 인수 파싱 함수
- * 
- * 프로그램이 자기 자신을 다시 실행할 때 사용하는 인수들:
- * --child: 이 프로세스가 자식 프로세스임을 나타냄
- * --id=N: 이 자식 프로세스의 인덱스 번호
- * 
- * 예: ./proc_demo --child --id=1
+ * 의존성 그래프 실행 (--dag=FILE)
+ *
+ * 목록의 각 줄이 이름, 의존하는 작업, 예상 비용을 가진 작업 하나입니다.
+ * (cost=가 없으면 --history에 기록된 실행 시간, 기록도 없으면 1)
+ *
+ *   # 이름   [after=의존,...] [cost=예상ms]   명령 ...
+ *   fetch    cost=200                       sh -c 'sleep 0.2'
+ *   build    after=fetch cost=500           make
+ *   test     after=build                    make test
+ *
+ * 의존하는 작업이 모두 성공해야 시작할 수 있고(준비된 작업), 준비된 작업은 --jobs개까지 동시에 돕니다.
+ * 준비된 작업이 칸보다 많으면 임계 경로 길이(자신부터 그래프 끝까지 가장 긴 비용 합)가 긴 것부터
+ * 띄웁니다. 가장 긴 사슬을 일찍 시작해야 전체 시간이 그 사슬 길이에 가까워지기 때문입니다.
+ * 작업이 실패하면 그 작업에 (직간접으로) 의존하는 작업은 모두 취소합니다.
+ *
+ * 그래프 전체가 있어야 임계 경로를 계산할 수 있으므로 --manifest와 달리 목록을 모두 읽어 둡니다.
+ * 순환이나 없는 이름을 가리키는 의존은 실행 전에 거부합니다.
  */
-static void parse_args(int argc, char** argv) {
-  for (int i = 1; i < argc; ++i) {
-    if (strcmp(argv[i], "--child") == 0) {
-      is_child = 1;  // 자식 모드로 설정
-    } else if (strncmp(argv[i], "--id=", 5) == 0) {
-      // "--id=" 다음 문자들을 숫자로 변환
-      child_idx = atoi(argv[i] + 5);
+#define DAG_TIMELINE_BUCKETS 20
+
+enum { DAG_WAITING, DAG_READY, DAG_RUNNING, DAG_OK, DAG_FAILED, DAG_CANCELLED };
+
+struct dag_node {
+  char* name;
+  char* line;          // manifest_split()로 나눈 줄 (argv가 가리킴)
+  char** argv;
+  char* after;         // after= 값 (쉼표 목록, 없으면 NULL)
+  double cost;         // 예상 비용 (cost=, 기본값 1)
+  double prio;         // 임계 경로 길이: cost + 의존하는 작업들의 prio 중 최댓값
+  int* out;            // 이 작업에 의존하는 작업들
+  int nout, outcap;
+  int nwait;           // 아직 끝나지 않은 선행 작업 수
+  int state;
+  double t_start, t_end;
+  int best_pred;       // 실제 시간 기준 임계 경로에서 바로 앞 작업 (-1이면 없음)
+};
+
+static struct {
+  struct dag_node* n;
+  int count, cap;
+  int* order;          // 위상 순서 (선행 작업이 항상 앞)
+  int* heap;           // 준비된 작업 (prio 최대 힙)
+  int nheap;
+} dag;
+
+static int dag_higher(int a, int b) {
+  if (dag.n[a].prio != dag.n[b].prio) return dag.n[a].prio > dag.n[b].prio;
+  return a < b;  // 같으면 목록 순서
+}
+
+static void dag_push(int v) {
+  int i = dag.nheap++;
+  dag.heap[i] = v;
+  while (i > 0 && dag_higher(dag.heap[i], dag.heap[(i - 1) / 2])) {
+    int p = (i - 1) / 2, t = dag.heap[p];
+    dag.heap[p] = dag.heap[i];
+    dag.heap[i] = t;
+    i = p;
+  }
+  dag.n[v].state = DAG_READY;
+}
+
+static int dag_pop(void) {
+  int top = dag.heap[0];
+  dag.heap[0] = dag.heap[--dag.nheap];
+  for (int i = 0; ; ) {
+    int l = 2 * i + 1, r = l + 1, m = i;
+    if (l < dag.nheap && dag_higher(dag.heap[l], dag.heap[m])) m = l;
+    if (r < dag.nheap && dag_higher(dag.heap[r], dag.heap[m])) m = r;
+    if (m == i) break;
+    int t = dag.heap[m];
+    dag.heap[m] = dag.heap[i];
+    dag.heap[i] = t;
+    i = m;
+  }
+  return top;
+}
+
+struct dag_name {
+  const char* name;
+  int idx;
+};
+
+static int cmp_dag_name(const void* a, const void* b) {
+  return strcmp(((const struct dag_name*)a)->name, ((const struct dag_name*)b)->name);
+}
+
+static int dag_add_edge(int from, int to) {
+  struct dag_node* f = &dag.n[from];
+  if (f->nout == f->outcap) {
+    int cap = f->outcap ? f->outcap * 2 : 4;
+    int* o = realloc(f->out, (size_t)cap * sizeof(int));
+    if (o == NULL) return -1;
+    f->out = o;
+    f->outcap = cap;
+  }
+  f->out[f->nout++] = to;
+  dag.n[to].nwait++;
+  return 0;
+}
+
+/*
+ * 목록을 읽어 그래프를 만들고 임계 경로 길이를 계산
+ *
+ * 반환값: 0이면 성공, 잘못된 목록(이름 중복, 없는 의존, 순환)이면 -1
+ */
+static int dag_load(FILE* fp) {
+  char* buf = NULL;
+  size_t cap = 0;
+  char* argv[MANIFEST_MAX_ARGS + 1];
+  long lineno = 0;
+
+  while (getline(&buf, &cap, fp) >= 0) {
+    lineno++;
+    char* p = buf;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == '#') continue;
+    char* line = strdup(p);
+    int argc = line ? manifest_split(line, argv, MANIFEST_MAX_ARGS) : -1;
+    if (argc == 0) {
+      free(line);
+      continue;
+    }
+    if (dag.count == dag.cap) {
+      int ncap = dag.cap ? dag.cap * 2 : 64;
+      struct dag_node* nn = realloc(dag.n, (size_t)ncap * sizeof(*dag.n));
+      if (nn == NULL) argc = -1;
+      else dag.n = nn, dag.cap = ncap;
+    }
+    if (argc < 0) {
+      perror("[parent] out of memory reading DAG");
+      return -1;
+    }
+    struct dag_node* d = &dag.n[dag.count];
+    memset(d, 0, sizeof(*d));
+    d->name = argv[0];
+    d->line = line;
+    d->cost = -1;
+    d->best_pred = -1;
+    int a = 1;
+    for (; a < argc; ++a) {
+      if (strncmp(argv[a], "after=", 6) == 0) d->after = argv[a] + 6;
+      else if (strncmp(argv[a], "cost=", 5) == 0) d->cost = atof(argv[a] + 5);
+      else break;
+    }
+    double pred_us;
+    long rss_kb;
+    if (d->cost < 0) {
+      d->cost = history_predict(history_key(argv + a + cache_inputs(argv + a)), &pred_us, &rss_kb)
+                    ? pred_us / 1e3 : 1;
+    }
+    if (a + cache_inputs(argv + a) == argc) {
+      fprintf(stderr, "[parent] DAG line %ld: job '%s' has no command\n", lineno, d->name);
+      return -1;
+    }
+    d->argv = malloc((size_t)(argc - a + 1) * sizeof(char*));
+    if (d->argv == NULL) return -1;
+    memcpy(d->argv, argv + a, (size_t)(argc - a + 1) * sizeof(char*));  // 끝의 NULL 포함
+    dag.count++;
+  }
+  free(buf);
+
+  // 이름 → 번호 (정렬 후 이진 탐색), 중복 이름 거부
+  struct dag_name* names = malloc((size_t)(dag.count ? dag.count : 1) * sizeof(*names));
+  dag.heap = malloc((size_t)(dag.count ? dag.count : 1) * sizeof(int));
+  if (names == NULL || dag.heap == NULL) return -1;
+  for (int i = 0; i < dag.count; ++i) {
+    names[i].name = dag.n[i].name;
+    names[i].idx = i;
+  }
+  qsort(names, (size_t)dag.count, sizeof(*names), cmp_dag_name);
+  for (int i = 1; i < dag.count; ++i) {
+    if (strcmp(names[i].name, names[i - 1].name) == 0) {
+      fprintf(stderr, "[parent] DAG: duplicate job name '%s'\n", names[i].name);
+      free(names);
+      return -1;
+    }
+  }
+
+  // 의존 관계를 간선으로 (after= 목록은 여기서 쉼표를 잘라 씀)
+  for (int i = 0; i < dag.count; ++i) {
+    for (char* dep = dag.n[i].after; dep && *dep; ) {
+      char* comma = strchr(dep, ',');
+      if (comma) *comma = '\0';
+      struct dag_name key = { dep, 0 };
+      struct dag_name* hit = *dep ? bsearch(&key, names, (size_t)dag.count, sizeof(*names), cmp_dag_name) : NULL;
+      if (*dep && hit == NULL) {
+        fprintf(stderr, "[parent] DAG: job '%s' depends on unknown job '%s'\n", dag.n[i].name, dep);
+        free(names);
+        return -1;
+      }
+      if (hit && dag_add_edge(hit->idx, i) < 0) return -1;
+      dep = comma ? comma + 1 : NULL;
+    }
+  }
+  free(names);
+
+  // Kahn 위상 정렬: 다 돌지 못하면 순환이 있음
+  int* order = malloc((size_t)(dag.count ? dag.count : 1) * sizeof(int));
+  int* wait = malloc((size_t)(dag.count ? dag.count : 1) * sizeof(int));
+  if (order == NULL || wait == NULL) return -1;
+  int head = 0, tail = 0;
+  for (int i = 0; i < dag.count; ++i) {
+    wait[i] = dag.n[i].nwait;
+    if (wait[i] == 0) order[tail++] = i;
+  }
+  while (head < tail) {
+    const struct dag_node* d = &dag.n[order[head++]];
+    for (int k = 0; k < d->nout; ++k) {
+      if (--wait[d->out[k]] == 0) order[tail++] = d->out[k];
+    }
+  }
+  if (tail < dag.count) {
+    for (int i = 0; i < dag.count; ++i) {
+      if (wait[i] > 0) {
+        fprintf(stderr, "[parent] DAG: dependency cycle through job '%s' (%d job(s) unreachable)\n",
+                dag.n[i].name, dag.count - tail);
+        break;
+      }
+    }
+    free(order);
+    free(wait);
+    return -1;
+  }
+
+  // 위상 순서의 역순으로 임계 경로 길이 계산
+  for (int t = dag.count - 1; t >= 0; --t) {
+    struct dag_node* d = &dag.n[order[t]];
+    double longest = 0;
+    for (int k = 0; k < d->nout; ++k) {
+      if (dag.n[d->out[k]].prio > longest) longest = dag.n[d->out[k]].prio;
+    }
+    d->prio = d->cost + longest;
+  }
+  dag.order = order;
+  free(wait);
+  return 0;
+}
+
+// 실패한 작업에 (직간접으로) 의존하는 작업을 모두 취소, 반환값: 취소한 수
+static int dag_cancel_dependents(int v) {
+  int cancelled = 0;
+  int* stack = malloc((size_t)dag.count * sizeof(int));
+  int sp = 0;
+  if (stack == NULL) return 0;
+  stack[sp++] = v;
+  while (sp > 0) {
+    const struct dag_node* d = &dag.n[stack[--sp]];
+    for (int k = 0; k < d->nout; ++k) {
+      struct dag_node* c = &dag.n[d->out[k]];
+      if (c->state != DAG_WAITING) continue;  // 이미 취소됨 (두 경로로 닿는 경우)
+      c->state = DAG_CANCELLED;
+      cancelled++;
+      stack[sp++] = d->out[k];
     }
   }
+  free(stack);
+  return cancelled;
+}
+
+// 끝난 작업 v의 뒤처리: 성공이면 의존하는 작업을 풀고, 실패면 취소
+static void dag_job_done(int v, int failed, long* cancelled) {
+  struct dag_node* d = &dag.n[v];
+  if (failed) {
+    d->state = DAG_FAILED;
+    int c = dag_cancel_dependents(v);
+    *cancelled += c;
+    if (c > 0) printf("[parent]   cancelled %d job(s) depending on '%s'\n", c, d->name);
+    return;
+  }
+  d->state = DAG_OK;
+  for (int e = 0; e < d->nout; ++e) {
+    struct dag_node* c = &dag.n[d->out[e]];
+    if (--c->nwait == 0 && c->state == DAG_WAITING) dag_push(d->out[e]);
+  }
 }
 
 /*
- * 자식 프로세스가 수행할 작업
- * 
- * 이 함수는 자식 프로세스로 실행될 때만 호출됩니다.
- * 자신의 PID를 출력하고, 1초간 대기한 후 종료합니다.
+ * 그래프 실행
+ *
+ * run_manifest()와 같은 칸/수거 루프에서, 다음 작업을 목록 대신 준비된 작업 힙에서 꺼냅니다.
+ * 캐시에서 바로 나온 작업은 칸을 차지하지 않고 그 자리에서 끝난 것으로 처리합니다.
  */
-static void child_work(void) {
-#ifdef _WIN32
-  // Windows에서 현재 프로세스의 PID 얻기
-  int pid = (int)_getpid();
-  printf("[child #%d] pid=%d: hello! working for 1s...\n", child_idx, pid);
-  
-  // Windows Sleep: 밀리초 단위 (1000ms = 1초)
-  Sleep(1000);
-  
-  printf("[child #%d] done.\n", child_idx);
-  
-  // Windows에서 프로세스 종료 (종료 코드 = 자식 인덱스)
-  // ExitProcess()는 즉시 프로세스를 종료시킴
-  ExitProcess((UINT)child_idx);
-  
-#else
-  // Unix/Linux에서 현재 프로세스의 PID와 부모 PID 얻기
-  int pid = (int)getpid();   // 현재 프로세스 ID
-  int ppid = (int)getppid(); // 부모 프로세스 ID
-  printf("[child #%d] pid=%d ppid=%d: hello! working for 1s...\n", child_idx, pid, ppid);
-  
-  // Unix sleep: 초 단위 (1 = 1초)
-  sleep(1);
-  
-  printf("[child #%d] done.\n", child_idx);
-  
-  // Unix에서 프로세스 종료 (종료 코드 = 자식 인덱스)
-  // _exit()는 즉시 프로세스를 종료시킴 (cleanup 없이)
-  _exit(child_idx);
-#endif
+static void run_dag(int k, struct manifest_stat* st, long* cancelled) {
+  struct job_slot* slots = calloc((size_t)k, sizeof(*slots));
+  struct pid_map live;
+  if (slots == NULL || pidmap_init(&live, k) < 0) {
+    perror("[parent] calloc failed");
+    exit(1);
+  }
+  memset(st, 0, sizeof(*st));
+  *cancelled = 0;
+  for (int i = 0; i < dag.count; ++i) {
+    if (dag.n[i].nwait == 0) dag_push(i);
+  }
+
+  double t0 = now_us(), cpu0 = cpu_time_us();
+  int nlive = 0;
+  while (dag.nheap > 0 || nlive > 0) {
+    // 1. 빈 칸을 임계 경로가 긴 준비된 작업으로 채움
+    for (int i = 0; i < k && dag.nheap > 0; ++i) {
+      if (slots[i].pid != 0) continue;
+      int v = dag_pop();
+      struct dag_node* d = &dag.n[v];
+      slots[i].no = v + 1;
+      st->jobs++;
+      long failed_before = st->failed;
+      int r = start_job(d->argv, &slots[i], st, stdout);
+      if (r != 0) {
+        if (r < 0) {
+          perror("[parent] fork failed");
+          st->failed++;
+        }
+        dag_job_done(v, st->failed != failed_before, cancelled);
+        i--;  // 같은 칸을 다음 준비된 작업에 씀
+        continue;
+      }
+      d->state = DAG_RUNNING;
+      d->t_start = slots[i].t_start - t0;
+      pidmap_put(&live, slots[i].pid, i);
+      nlive++;
+    }
+    if (nlive == 0) continue;
+
+    // 2. 아무 작업이나 하나 끝나기를 기다렸다가, 성공이면 뒤 작업을 풀고 실패면 취소
+    int status = 0;
+    struct rusage ru;
+    pid_t pid = wait4(-1, &status, 0, &ru);
+    if (pid < 0) {
+      if (errno == EINTR) continue;
+      perror("[parent] wait4 failed");
+      break;
+    }
+    int i = pidmap_take(&live, pid);
+    if (i < 0) continue;
+    int v = (int)slots[i].no - 1;
+    long failed_before = st->failed;
+    finish_job(&slots[i], status, &ru, st, stdout);
+    nlive--;
+    dag.n[v].t_end = now_us() - t0;
+    dag_job_done(v, st->failed != failed_before, cancelled);
+  }
+  st->wall_us = now_us() - t0;
+  st->cpu_us = cpu_time_us() - cpu0;
+  pidmap_free(&live);
+  free(slots);
+}
+
+/*
+ * 실행 결과 보고
+ *
+ * - 시간 구간별 평균 동시 실행 수 (구간과 겹친 작업 시간의 합 / 구간 길이)
+ * - 실제 걸린 시간으로 다시 잰 임계 경로와 전체 시간 비교 (1.00이면 더 줄일 수 없음)
+ */
+static void print_dag_report(int k, const struct manifest_stat* st, long cancelled) {
+  double wall = st->wall_us, work = 0, bucket = wall / DAG_TIMELINE_BUCKETS;
+  double busy[DAG_TIMELINE_BUCKETS] = { 0 };
+  double* finish = calloc((size_t)(dag.count ? dag.count : 1), sizeof(double));
+  for (int i = 0; i < dag.count; ++i) {
+    const struct dag_node* d = &dag.n[i];
+    if (d->state != DAG_OK && d->state != DAG_FAILED) continue;
+    if (d->t_end <= d->t_start) continue;  // fork 실패
+    work += d->t_end - d->t_start;
+    for (int b = 0; b < DAG_TIMELINE_BUCKETS; ++b) {
+      double lo = b * bucket, hi = lo + bucket;
+      double s = d->t_start > lo ? d->t_start : lo, e = d->t_end < hi ? d->t_end : hi;
+      if (e > s) busy[b] += e - s;
+    }
+  }
+
+  // 실제 시간 기준 임계 경로: 위상 순서로 (선행 경로 중 가장 긴 것 + 자기 실행 시간)을 전파
+  double crit_end = 0;
+  int crit_last = -1;
+  for (int t = 0; finish && t < dag.count; ++t) {
+    int v = dag.order[t];
+    struct dag_node* d = &dag.n[v];
+    if (d->t_end <= d->t_start) continue;  // 실행하지 않은 작업
+    finish[v] += d->t_end - d->t_start;    // finish[v]에는 선행 경로의 최댓값이 먼저 들어 있음
+    if (finish[v] > crit_end) {
+      crit_end = finish[v];
+      crit_last = v;
+    }
+    for (int e = 0; e < d->nout; ++e) {
+      int c = d->out[e];
+      if (finish[v] > finish[c]) {
+        finish[c] = finish[v];
+        dag.n[c].best_pred = v;
+      }
+    }
+  }
+
+  printf("\n[parent] DAG: %d jobs, %ld ran, %ld ok, %ld failed, %ld cancelled\n",
+         dag.count, st->jobs, st->ok, st->failed, cancelled);
+  printf("  parallelism over time (--jobs=%d, %.1f ms per row):\n", k, bucket / 1e3);
+  for (int b = 0; b < DAG_TIMELINE_BUCKETS && bucket > 0; ++b) {
+    double avg = busy[b] / bucket;
+    char bar[41];
+    int w = k > 0 ? (int)(avg / k * 40 + 0.5) : 0;
+    if (w > 40) w = 40;
+    memset(bar, '#', (size_t)w);
+    bar[w] = '\0';
+    printf("    %8.1f ms | %-40s %5.2f\n", b * bucket / 1e3, bar, avg);
+  }
+  printf("  total work %.1f ms, wall %.1f ms, average parallelism %.2f\n",
+         work / 1e3, wall / 1e3, wall > 0 ? work / wall : 0.0);
+
+  // 임계 경로를 뒤에서부터 따라가 앞에서부터 출력
+  if (crit_last >= 0) {
+    int path[64], np = 0, len = 0;
+    for (int v = crit_last; v >= 0; v = dag.n[v].best_pred) {
+      if (np < 64) path[np++] = v;
+      len++;
+    }
+    printf("  critical path (actual run times) %.1f ms over %d job(s):", crit_end / 1e3, len);
+    for (int j = np - 1; j >= 0; --j) printf("%s%s", j == np - 1 ? " " : " -> ", dag.n[path[j]].name);
+    if (len > np) printf(" ...");
+    printf("\n");
+    double bound = crit_end > work / k ? crit_end : work / k;
+    printf("  wall / critical path = %.2f, wall / max(critical path, work/jobs) = %.2f"
+           " (1.00 = no schedule can do better)\n",
+           crit_end > 0 ? wall / crit_end : 0.0, bound > 0 ? wall / bound : 0.0);
+  }
+  free(finish);
+}
+
+/*
+ * 예상 시간 순서로 실행 (--order=lpt|sjf, --mem-budget=MB)
+ *
+ * 기본(fifo)은 목록 순서대로 스트림으로 띄웁니다. 순서를 바꾸려면 목록 전체가 있어야 하므로
+ * 이 모드는 목록을 모두 읽어 둔 뒤 --history의 예상 시간으로 정렬합니다.
+ *   lpt: 긴 작업부터. 긴 작업이 끝에 홀로 남아 칸 하나만 돌아가는 꼬리가 줄어 전체 시간(makespan)이 짧아짐
+ *   sjf: 짧은 작업부터. 전체 시간은 줄지 않지만 작업들의 평균 완료 시각이 가장 이름
+ * 기록이 없는 작업은 기록이 있는 작업들의 평균 시간으로 봅니다.
+ *
+ * --mem-budget을 주면 실행 중인 작업의 예상 메모리(기록된 최대 RSS) 합이 한도를 넘지 않게 띄웁니다.
+ * 순서상 다음 작업이 들어가지 않으면 뒤의 작업 중(최대 PLAN_FIT_WINDOW개) 들어가는 첫 작업을 먼저 띄웁니다.
+ * (first-fit, 실행 중인 작업이 하나도 없으면 한도를 넘어도 띄움)
+ */
+#define PLAN_FIT_WINDOW 64
+
+enum { ORDER_FIFO, ORDER_LPT, ORDER_SJF };
+
+struct plan_job {
+  char** argv;      // 인수 포인터 배열과 문자열을 한 블록에 할당
+  long no;
+  double pred_us;
+  long rss_kb;
+  int started;
+};
+
+struct plan_stat {
+  long jobs, known, held_for_mem;
+  double pred_total_us, longest_us, work_us, done_sum_us;
+  long peak_rss_kb;  // 동시에 실행 중인 작업의 예상 메모리 합의 최댓값
+};
+
+static int plan_order_of(const char* name) {
+  if (strcmp(name, "lpt") == 0) return ORDER_LPT;
+  if (strcmp(name, "sjf") == 0) return ORDER_SJF;
+  return ORDER_FIFO;
+}
+
+static int plan_order = ORDER_FIFO;
+
+static int cmp_plan_job(const void* a, const void* b) {
+  const struct plan_job* x = a;
+  const struct plan_job* y = b;
+  if (plan_order != ORDER_FIFO && x->pred_us != y->pred_us) {
+    int longer = x->pred_us > y->pred_us ? -1 : 1;
+    return plan_order == ORDER_LPT ? longer : -longer;
+  }
+  return x->no < y->no ? -1 : x->no > y->no;
+}
+
+static char** plan_copy_argv(char** argv, int argc) {
+  size_t bytes = (size_t)(argc + 1) * sizeof(char*);
+  for (int k = 0; k < argc; ++k) bytes += strlen(argv[k]) + 1;
+  char** out = malloc(bytes);
+  if (out == NULL) return NULL;
+  char* p = (char*)(out + argc + 1);
+  for (int k = 0; k < argc; ++k) {
+    size_t len = strlen(argv[k]) + 1;
+    memcpy(p, argv[k], len);
+    out[k] = p;
+    p += len;
+  }
+  out[argc] = NULL;
+  return out;
+}
+
+static void run_manifest_planned(FILE* fp, int fmt, int k, struct manifest_stat* st,
+                                 struct plan_stat* ps, int verbose) {
+  struct plan_job* jobs_v = NULL;
+  long n = 0, cap_v = 0;
+  double rss_total_kb = 0;
+  char* argv[MANIFEST_MAX_ARGS + 1];
+  char* buf = NULL;
+  size_t cap = 0;
+  memset(st, 0, sizeof(*st));
+  memset(ps, 0, sizeof(*ps));
+
+  // 1. 목록을 모두 읽고 예상 시간/메모리를 붙임
+  for (;;) {
+    int argc = manifest_next(fp, fmt, &buf, &cap, argv);
+    if (argc <= 0) {
+      if (argc < 0) {
+        st->bad_records++;
+        fprintf(stderr, "[parent] Bad binary record after job #%ld, stopping\n", n);
+      }
+      break;
+    }
+    if (n == cap_v) {
+      cap_v = cap_v ? cap_v * 2 : 256;
+      struct plan_job* nj = realloc(jobs_v, (size_t)cap_v * sizeof(*jobs_v));
+      if (nj == NULL) {
+        perror("[parent] out of memory reading manifest");
+        exit(1);
+      }
+      jobs_v = nj;
+    }
+    struct plan_job* j = &jobs_v[n];
+    memset(j, 0, sizeof(*j));
+    j->argv = plan_copy_argv(argv, argc);
+    if (j->argv == NULL) {
+      perror("[parent] out of memory reading manifest");
+      exit(1);
+    }
+    j->no = ++n;
+    j->pred_us = -1;
+    if (history_predict(history_key(j->argv + cache_inputs(j->argv)), &j->pred_us, &j->rss_kb)) {
+      ps->known++;
+      ps->pred_total_us += j->pred_us;
+      rss_total_kb += (double)j->rss_kb;
+    }
+  }
+  free(buf);
+  // 기록이 없는 작업은 기록이 있는 작업들의 평균 시간과 평균 메모리로 예상
+  double mean = ps->known ? ps->pred_total_us / ps->known : 0;
+  long mean_rss_kb = ps->known ? (long)(rss_total_kb / ps->known) : 0;
+  for (long i = 0; i < n; ++i) {
+    if (jobs_v[i].pred_us < 0) {
+      jobs_v[i].pred_us = mean;
+      jobs_v[i].rss_kb = mean_rss_kb;
+    }
+  }
+  qsort(jobs_v, (size_t)n, sizeof(*jobs_v), cmp_plan_job);
+  ps->jobs = n;
+
+  // 2. run_manifest()와 같은 칸/수거 루프, 다음 작업은 정렬된 배열에서 메모리 한도에 맞는 첫 작업
+  struct job_slot* slots = calloc((size_t)k, sizeof(*slots));
+  long* slot_job = calloc((size_t)k, sizeof(long));
+  struct pid_map live;
+  if (slots == NULL || slot_job == NULL || pidmap_init(&live, k) < 0) {
+    perror("[parent] calloc failed");
+    exit(1);
+  }
+  long budget_kb = mem_budget_mb * 1024L, inflight_kb = 0, next = 0;
+  double t0 = now_us(), cpu0 = cpu_time_us();
+  int nlive = 0;
+  while (next < n || nlive > 0) {
+    while (nlive < k) {
+      while (next < n && jobs_v[next].started) next++;
+      long pick = -1;
+      for (long w = next; w < n && w < next + PLAN_FIT_WINDOW; ++w) {
+        if (jobs_v[w].started) continue;
+        if (budget_kb == 0 || nlive == 0 || inflight_kb + jobs_v[w].rss_kb <= budget_kb) {
+          pick = w;
+          break;
+        }
+      }
+      if (pick < 0) {
+        if (next < n) ps->held_for_mem++;
+        break;
+      }
+      int i = 0;
+      while (slots[i].pid != 0) i++;
+      struct plan_job* j = &jobs_v[pick];
+      j->started = 1;
+      slots[i].no = j->no;
+      st->jobs++;
+      int r = start_job(j->argv, &slots[i], st, verbose ? stdout : NULL);
+      if (r != 0) {
+        if (r < 0) {
+          perror("[parent] fork failed");
+          st->failed++;
+        }
+        ps->done_sum_us += now_us() - t0;
+        continue;
+      }
+      slot_job[i] = pick;
+      inflight_kb += j->rss_kb;
+      if (inflight_kb > ps->peak_rss_kb) ps->peak_rss_kb = inflight_kb;
+      pidmap_put(&live, slots[i].pid, i);
+      nlive++;
+    }
+    if (nlive == 0) continue;
+
+    int status = 0;
+    struct rusage ru;
+    pid_t pid = wait4(-1, &status, 0, &ru);
+    if (pid < 0) {
+      if (errno == EINTR) continue;
+      perror("[parent] wait4 failed");
+      break;
+    }
+    int i = pidmap_take(&live, pid);
+    if (i < 0) continue;
+    double dur = now_us() - slots[i].t_start;
+    ps->work_us += dur;
+    if (dur > ps->longest_us) ps->longest_us = dur;
+    finish_job(&slots[i], status, &ru, st, verbose ? stdout : NULL);
+    inflight_kb -= jobs_v[slot_job[i]].rss_kb;
+    ps->done_sum_us += now_us() - t0;
+    nlive--;
+  }
+  st->wall_us = now_us() - t0;
+  st->cpu_us = cpu_time_us() - cpu0;
+  struct rusage self;
+  getrusage(RUSAGE_SELF, &self);
+  st->maxrss_kb = self.ru_maxrss;
+  pidmap_free(&live);
+  free(slot_job);
+  free(slots);
+  for (long i = 0; i < n; ++i) free(jobs_v[i].argv);
+  free(jobs_v);
+}
+
+static void print_plan_stat(const struct plan_stat* ps, const struct manifest_stat* st, int k) {
+  double bound = ps->work_us / k > ps->longest_us ? ps->work_us / k : ps->longest_us;
+  printf("[parent] Order %s: %ld of %ld jobs had history (predicted work %.1f ms), "
+         "mean completion %.1f ms\n",
+         order_name, ps->known, ps->jobs, ps->pred_total_us / 1e3,
+         ps->jobs ? ps->done_sum_us / ps->jobs / 1e3 : 0.0);
+  printf("[parent]   makespan %.1f ms, lower bound max(longest job, work/jobs) %.1f ms (%.2fx)\n",
+         st->wall_us / 1e3, bound / 1e3, bound > 0 ? st->wall_us / bound : 0.0);
+  if (mem_budget_mb > 0) {
+    printf("[parent]   predicted memory in flight peaked at %.1f MB of --mem-budget=%ld MB, "
+           "held back %ld time(s) for memory\n",
+           ps->peak_rss_kb / 1024.0, mem_budget_mb, ps->held_for_mem);
+  }
+}
+
+static void print_history_stat(void) {
+  if (history.map == NULL) return;
+  printf("[parent] History %s: %ld predictions, %ld jobs without history, %u of %u entries used%s\n",
+         history_path, history.hits, history.misses, history.map->used, history.map->nslots,
+         history.full ? " (table full, some runs not recorded)" : "");
+  if (history.evicted) {
+    printf("[parent]   table full: evicted %ld least-run entries for new jobs\n", history.evicted);
+  }
+}
+
+/*
+ * 순서별 전체 시간 비교 (--history-bench=N)
+ *
+ * 꼬리가 긴 가짜 작업 N개(sleep, 5 ms × 2^g, g는 동전을 던져 앞면이 나올 때까지 뒷면 수, 최대 7)를
+ * 무작위 순서로 목록에 적고, 빈 기록 파일로 fifo를 한 번 돌려 기록을 만든 뒤 lpt, sjf로 다시 돌립니다.
+ */
+static void run_history_bench(int n, int k) {
+  char mpath[64];
+  static char hpath[64];  // history_path가 가리키므로 함수가 끝나도 남아 있어야 함
+  int mfd = manifest_tmp(mpath, sizeof(mpath));
+  snprintf(hpath, sizeof(hpath), "/tmp/proc_demo-history-XXXXXX");
+  int hfd = mkostemp(hpath, O_CLOEXEC);
+  FILE* mf = mfd >= 0 && hfd >= 0 ? fdopen(mfd, "w") : NULL;
+  if (mf == NULL) {
+    perror("[parent] cannot create bench files");
+    if (mfd >= 0) {
+      close(mfd);
+      unlink(mpath);
+    }
+    if (hfd >= 0) {
+      close(hfd);
+      unlink(hpath);
+    }
+    return;
+  }
+  close(hfd);
+  uint64_t seed = 0x2545F4914F6CDD1DULL;
+  double total_ms = 0, longest_ms = 0;
+  for (int i = 0; i < n; ++i) {
+    int g = 0;
+    for (;;) {
+      seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+      if ((seed >> 33) & 1 || g == 7) break;
+      g++;
+    }
+    double ms = 5.0 * (1 << g);
+    total_ms += ms;
+    if (ms > longest_ms) longest_ms = ms;
+    fprintf(mf, "sleep %.3f\n", ms / 1e3);
+  }
+  if (fclose(mf) != 0) {
+    perror("[parent] cannot write bench manifest");
+    unlink(mpath);
+    unlink(hpath);
+    return;
+  }
+
+  printf("\n=== Scheduling order: %d jobs, sleep 5 ms x 2^g (total %.0f ms, longest %.0f ms), --jobs=%d ===\n",
+         n, total_ms, longest_ms, k);
+  printf("    ideal makespan >= max(longest, total/jobs) = %.1f ms\n",
+         total_ms / k > longest_ms ? total_ms / k : longest_ms);
+  history_path = hpath;
+  if (history_open(hpath) < 0) {
+    unlink(mpath);
+    unlink(hpath);
+    return;
+  }
+  static const char* const names[] = { "fifo", "lpt", "sjf" };
+  double fifo_wall = 0;
+  printf("    %-5s %12s %10s %18s\n", "order", "makespan ms", "vs fifo", "mean completion ms");
+  for (int r = 0; r < 3; ++r) {
+    FILE* fp = fopen(mpath, "r");
+    if (fp == NULL) break;
+    order_name = names[r];
+    plan_order = plan_order_of(names[r]);
+    struct manifest_stat st;
+    struct plan_stat ps;
+    run_manifest_planned(fp, MANIFEST_TEXT, k, &st, &ps, 1);
+    fclose(fp);
+    if (r == 0) fifo_wall = st.wall_us;
+    printf("    %-5s %12.1f %+9.1f%% %18.1f%s\n", names[r], st.wall_us / 1e3,
+           fifo_wall > 0 ? 100.0 * (st.wall_us - fifo_wall) / fifo_wall : 0.0,
+           ps.jobs ? ps.done_sum_us / ps.jobs / 1e3 : 0.0, r == 0 ? "   (records history)" : "");
+  }
+  history_close();
+  unlink(mpath);
+  unlink(hpath);
 }
+#endif
 
 /*
  * 메인 함수
@@ -99,6 +7494,11 @@ int main(int argc, char** argv) {
     return 0;      // 실제로는 child_work()에서 _exit()로 종료되므로 여기까지 오지 않음
   }
 
+#ifndef _WIN32
+  // 제어 클라이언트 모드: 데몬에 요청만 보내고 끝남
+  if (ctl_path) return run_ctl(ctl_path);
+#endif
+
   // ==================== 부모 프로세스 모드 ====================
   printf("[parent] starting. (this is the terminal)\n");
 
@@ -182,77 +7582,240 @@ int main(int argc, char** argv) {
   // ==================== Unix/Linux 프로세스 생성 ====================
   
   printf("[parent] My PID: %d\n", getpid());
-  
-  // 2개의 자식 프로세스를 순차적으로 생성
-  for (int i = 1; i <= 2; ++i) {
-    printf("\n[parent] Creating child process #%d...\n", i);
-    
-    // 1. fork() 시스템 콜로 프로세스 복제
-    // fork()는 현재 프로세스를 완전히 복사하여 새로운 프로세스 생성
-    pid_t pid = fork();
-    
-    // 2. fork() 결과 확인
-    if (pid < 0) {
-      // fork() 실패 (음수 반환)
-      perror("[parent] fork failed");
-      continue;  // 다음 자식 프로세스 생성 시도
+  if (exec_path == NULL) exec_path = argv[0];
+  if (perf_list) perf_parse(perf_list);
+  if (ns_list) ns_flags = ns_parse(ns_list);
+  for (int k = 0; k < n_sched_specs; ++k) sched_parse(sched_specs[k]);
+  for (int k = 0; k < n_ioprio_specs; ++k) ioprio_parse(ioprio_specs[k]);
+  for (int k = 0; k < n_io_cg_specs; ++k) io_cgroup_parse(io_cg_specs[k]);
+  if (fd_hygiene_name) {
+    if (strcmp(fd_hygiene_name, "off") == 0) fd_hygiene = FD_HYGIENE_OFF;
+    else if (strcmp(fd_hygiene_name, "close") == 0) fd_hygiene = FD_HYGIENE_CLOSE;
+    else if (strcmp(fd_hygiene_name, "cloexec") == 0) fd_hygiene = FD_HYGIENE_CLOEXEC;
+    else fprintf(stderr, "[parent] unknown --fd-hygiene=%s (using cloexec)\n", fd_hygiene_name);
+  }
+  if (hold_fds_n > 0) {
+    printf("[parent] Holding %d inherited fds\n", hold_fds(hold_fds_n));
+  }
+  use_seccomp = seccomp_opt;
+
+  // 자식이 많으면 한 줄씩 찍는 출력은 읽을 수 없으므로 요약만 출력
+  if (num_children > 32 && !quiet) {
+    static char quiet_arg[] = "--quiet";
+    quiet = 1;
+    forward_arg(quiet_arg);
+  }
+
+  // 자식별 진행 출력이 있을 때는 stdout을 줄 단위 버퍼로 바꿈
+  // (파이프로 받으면 기본이 블록 버퍼라, 부모의 줄이 자식의 줄보다 늦게 찍혀 순서가 뒤바뀜)
+  if (!quiet) setvbuf(stdout, NULL, _IOLBF, 0);
+
+  // 스레드/프로세스 비교 모드: 자식별 출력 없이 표만 출력
+  if (compare_n > 0) {
+    static char quiet_arg[] = "--quiet";
+    if (!quiet) forward_arg(quiet_arg);
+    quiet = 1;
+    if (shm_create(compare_n) < 0) return 1;
+    int failed = run_compare(exec_path, compare_n);
+    printf("[parent] Parent process terminating%s...\n", failed ? " with exit status 1" : "");
+    return failed;
+  }
+
+  // 파이버 실행기 모드: 프로세스를 만들지 않고 파이버로만 실행
+  if (fibers_n > 0) {
+    fiber_stack = (fiber_stack + 15) & ~(size_t)15;
+    int failed = run_fibers(fibers_n, fiber_threads > 0 ? fiber_threads
+                                                        : (int)sysconf(_SC_NPROCESSORS_ONLN));
+    printf("[parent] Parent process terminating%s...\n", failed ? " with exit status 1" : "");
+    return failed;
+  }
+
+  // I/O 격리 벤치마크: 자식은 --work-ms 동안 읽기/쓰기를 하고 표만 출력
+  if (io_bench_n > 0) {
+    static char quiet_arg[] = "--quiet";
+    forward_arg(quiet_arg);
+    quiet = 1;
+    if (shm_create(IO_BENCH_READERS + io_bench_n) < 0) return 1;
+    run_io_bench(exec_path, io_bench_n);
+    printf("[parent] Parent process terminating...\n");
+    return 0;
+  }
+
+  // 생성 비용 벤치마크 모드: 자식 작업은 0ms로 고정하고 표만 출력
+  if (ns_bench_n > 0 || seccomp_bench_n > 0 || exec_bench_n > 0 || fd_bench_n > 0) {
+    static char bench_args[][16] = { "--quiet", "--work=sleep", "--work-ms=0" };
+    for (size_t k = 0; k < sizeof(bench_args) / sizeof(bench_args[0]); ++k) {
+      forward_arg(bench_args[k]);
     }
-    
-    if (pid == 0) {
-      // ========== 자식 프로세스 영역 ==========
-      // fork() 후 자식 프로세스에서는 pid가 0으로 반환됨
-      
-      printf("[child #%d] I'm the child! My PID: %d, Parent PID: %d\n", 
-             i, getpid(), getppid());
-      
-      // 3. exec 계열 함수로 새로운 프로그램 실행
-      // execvp()는 현재 프로세스 이미지를 새로운 프로그램으로 교체
-      char idarg[16];
-      snprintf(idarg, sizeof(idarg), "--id=%d", i);
-      
-      // 실행할 프로그램의 인수 배열 (NULL로 끝나야 함)
-      char *args[] = { 
-        argv[0],    // 프로그램 이름 (자기 자신)
-        "--child",  // 자식 모드 플래그
-        idarg,      // 자식 인덱스 (--id=1, --id=2, ...)
-        NULL        // 배열 끝 표시
-      };
-      
-      printf("[child #%d] Executing: %s %s %s\n", i, args[0], args[1], args[2]);
-      
-      // execvp() 실행: 성공하면 이 지점으로 돌아오지 않음
-      execvp(args[0], args);
-      
-      // execvp()가 실패한 경우에만 여기 도달
-      perror("[child] execvp failed");
-      _exit(127);  // 표준 실패 코드로 즉시 종료
-      
-    } else {
-      // ========== 부모 프로세스 영역 ==========
-      // fork() 후 부모 프로세스에서는 자식의 PID가 반환됨
-      
-      printf("[parent] Successfully created child #%d (pid=%d)\n", i, pid);
-      
-      // 4. 자식 프로세스 종료 대기
-      printf("[parent] Waiting for child #%d to finish...\n", i);
-      int status = 0;
-      waitpid(pid, &status, 0);  // 특정 자식 프로세스 대기
-      
-      // 5. 자식 프로세스 종료 상태 분석
-      if (WIFEXITED(status)) {
-        // 정상 종료: exit() 또는 return으로 종료
-        int exit_code = WEXITSTATUS(status);
-        printf("[parent] Child #%d exited normally with code %d\n", i, exit_code);
-      } else if (WIFSIGNALED(status)) {
-        // 시그널에 의한 종료: 강제 종료 등
-        int signal_num = WTERMSIG(status);
-        printf("[parent] Child #%d was killed by signal %d\n", i, signal_num);
-      } else {
-        // 기타 종료 상황
-        printf("[parent] Child #%d terminated with status 0x%x\n", i, status);
+    quiet = 1;
+    int nslots = ns_bench_n > seccomp_bench_n ? ns_bench_n : seccomp_bench_n;
+    if (exec_bench_n > nslots) nslots = exec_bench_n;
+    if (fd_bench_n > nslots) nslots = fd_bench_n;
+    if (shm_create(nslots) < 0) return 1;
+    if (exec_bench_n > 0) run_exec_bench(exec_path, exec_bench_n);
+    if (ns_bench_n > 0) run_ns_bench(exec_path, ns_bench_n);
+    if (seccomp_bench_n > 0) run_seccomp_bench(exec_path, seccomp_bench_n);
+    if (fd_bench_n > 0) run_fd_bench(exec_path, fd_bench_n);
+    printf("[parent] Parent process terminating...\n");
+    return 0;
+  }
+
+  // 작업 목록 실행기: --child 대신 목록의 임의 명령을 실행
+  if (manifest_bench_n > 0) {
+    run_manifest_bench(manifest_bench_n, jobs > 1 ? jobs : 8);
+    printf("[parent] Parent process terminating...\n");
+    return 0;
+  }
+  if (history_bench_n > 0) {
+    run_history_bench(history_bench_n, jobs > 1 ? jobs : 8);
+    printf("[parent] Parent process terminating...\n");
+    return 0;
+  }
+  plan_order = plan_order_of(order_name);
+  int planned = plan_order != ORDER_FIFO || mem_budget_mb > 0;
+  if (cache_dir && (manifest_path || dag_path)) {
+    if (keep_order) {
+      fprintf(stderr, "[parent] --cache cannot be combined with --keep-order\n");
+      return 1;
+    }
+    if (cache_open() < 0) return 1;
+  }
+  if (planned && keep_order) {
+    fprintf(stderr, "[parent] --order and --mem-budget cannot be combined with --keep-order\n");
+    return 1;
+  }
+  if (history_path && (manifest_path || dag_path) && history_open(history_path) < 0) return 1;
+  if (manifest_path) {
+    int fmt = strcmp(manifest_format, "bin") == 0 ? MANIFEST_BIN : MANIFEST_TEXT;
+    FILE* fp = strcmp(manifest_path, "-") == 0 ? stdin : fopen(manifest_path, "r");
+    if (fp == NULL) {
+      perror("[parent] cannot open manifest");
+      return 1;
+    }
+    struct manifest_stat st;
+    struct plan_stat ps;
+    if (keep_order) run_manifest_ordered(fp, fmt, jobs, &st, 1);
+    else if (planned) run_manifest_planned(fp, fmt, jobs, &st, &ps, 1);
+    else run_manifest(fp, fmt, jobs, &st, 1);
+    if (fp != stdin) fclose(fp);
+    print_manifest_stat(&st, jobs);
+    if (keep_order) print_reorder_report();
+    if (planned) print_plan_stat(&ps, &st, jobs);
+    if (cache_dir) {
+      cache_evict();
+      print_cache_stat();
+    }
+    print_history_stat();
+    history_close();
+    printf("[parent] Parent process terminating%s...\n", st.failed ? " with exit status 1" : "");
+    return st.failed || st.bad_records ? 1 : 0;
+  }
+  if (dag_path) {
+    FILE* fp = fopen(dag_path, "r");
+    if (fp == NULL) {
+      perror("[parent] cannot open DAG");
+      return 1;
+    }
+    int bad = dag_load(fp);
+    fclose(fp);
+    if (bad < 0) return 1;
+    struct manifest_stat st;
+    long cancelled;
+    run_dag(jobs, &st, &cancelled);
+    print_dag_report(jobs, &st, cancelled);
+    if (cache_dir) {
+      cache_evict();
+      print_cache_stat();
+    }
+    print_history_stat();
+    history_close();
+    printf("[parent] Parent process terminating%s...\n", st.failed ? " with exit status 1" : "");
+    return st.failed || cancelled ? 1 : 0;
+  }
+
+  // 데몬 모드: 자식은 요청이 올 때마다 만들고, 배리어 없이 바로 출발 (공유 메모리 없음)
+  if (daemon_path) {
+    static char quiet_arg[] = "--quiet";
+    if (!quiet) forward_arg(quiet_arg);
+    quiet = 1;
+    daemon_argv = argv;
+    return run_daemon(daemon_path, daemon_resume_fd);
+  }
+
+  // 시작 배리어와 타임스탬프를 담을 공유 메모리 준비 (풀 모드는 칸 수만큼)
+  if (shm_create(jobs > 1 && !parallel ? jobs : num_children) < 0) return 1;
+
+  io_cgroup_setup();
+
+  if (sample_ms > 0) {
+    sampler.interval_ms = sample_ms;
+    sampler.out_path = sample_out;
+    sampler_start(parallel ? num_children : (jobs > 1 ? jobs : 1));
+  }
+
+  if (parallel) {
+    run_parallel(exec_path);
+  } else if (jobs > 1) {
+    run_pool(exec_path);
+  } else {
+    // num_children개의 자식 프로세스를 순차적으로 생성
+    for (int i = 1; i <= num_children; ++i) {
+      if (!quiet) printf("\n[parent] Creating child process #%d...\n", i);
+
+      // 1. fork + exec (준비 완료 파이프 포함)
+      struct child_rec rec = { 0 };  // slot 0: 자식 인덱스와 같은 슬롯
+      if (spawn_child(exec_path, i, &rec) < 0) {
+        continue;  // 다음 자식 프로세스 생성 시도
       }
+      if (!quiet) {
+        printf("[parent] fork() returned for child #%d (pid=%d), waiting for exec/ready...\n",
+               i, rec.pid);
+      }
+
+      // 2. exec 완료 → 준비 완료 순서로 대기 (순차 모드에서는 배리어 없이 바로 출발)
+      if (await_child_ready(&rec) && !quiet) {
+        printf("[parent] Child #%d is ready (fork %.1f us, exec %.1f us, ready %.1f us)\n",
+               i, rec.t_forked - rec.t_fork, rec.t_exec - rec.t_forked,
+               rec.t_ready - rec.t_exec);
+      }
+      if (shm) barrier_release();
+
+      // 3. 자식 프로세스 종료 대기
+      if (!quiet) printf("[parent] Waiting for child #%d to finish...\n", i);
+      int status = 0;
+      waitpid(rec.pid, &status, 0);  // 특정 자식 프로세스 대기
+
+      // 4. 자식 프로세스 종료 상태 분석
+      report_exit(&rec, status);
     }
   }
+
+  sampler_stop();
+  io_cgroup_cleanup();
+
+  print_phase_report();
+  slots_harvest_all();
+  print_metric_report();
+  print_sched_report();
+  print_exit_summary();
+  print_perf_summary();
+  print_sampler_report();
+  write_sampler_csv();
+
+  // 수거하지 않은 자식(좀비)이 남았는지 확인: 자식이 하나도 없으면 ECHILD
+  if (waitpid(-1, NULL, WNOHANG) < 0 && errno == ECHILD) {
+    printf("\n[parent] No unreaped children left (no zombies)\n");
+  } else {
+    printf("\n[parent] WARNING: unreaped children remain!\n");
+  }
+
+  // 모든 자식이 기대한 종료 코드로 끝났을 때만 성공으로 종료
+  if (agg.ok != (unsigned long)num_children) {
+    printf("\n[parent] %lu of %d child processes failed!\n",
+           (unsigned long)num_children - agg.ok, num_children);
+    printf("[parent] Parent process terminating with exit status 1...\n");
+    return 1;
+  }
 #endif
 
   // ==================== 부모 프로세스 종료 ====================
@@ -269,8 +7832,45 @@ int main(int argc, char** argv) {
  *   ./proc_demo.exe
  * 
  * Linux/Unix:
- *   gcc -o proc_demo proc_demo.c
+ *   gcc -o proc_demo proc_demo.c -pthread
+ *   (또는 저장소 최상위에서 cmake -S . -B build && cmake --build build)
  *   ./proc_demo
+ *   ./proc_demo --children=20           # 단계별(fork/exec/ready) 지연 분포 확인
+ *   ./proc_demo --exec=/no/such/file    # exec 실패 즉시 감지 확인
+ *   ./proc_demo --parallel --children=8 --work=spin --work-ms=200   # 동시 시작 후 확장성 측정
+ *   ./proc_demo --children=4 --work=alloc --mem-mb=256 --mem-backing=thp --prefault=madvise
+ *   ./proc_demo --work=table --work-ms=100 --snapshot-dir=/tmp   # 두 번 실행하면 웜 스타트
+ *   ./proc_demo --children=100000 --jobs=64 --work-ms=0 --fail-every=1000   # 집계 요약만 출력
+ *   ./proc_demo --work=spin --work-ms=200 --perf=cycles,instructions,cache-misses,branch-misses,task-clock
+ *   ./proc_demo --compare=200 --work=sleep --work-ms=100   # 스레드 vs fork vs fork+exec
+ *   ./proc_demo --fibers=1000000 --fiber-threads=4 --work-ms=1000   # 파이버 100만 개
+ *   ./proc_demo --ns=user,pid,mount,net --children=2   # 격리된 자식 (권한 없이도 가능)
+ *   ./proc_demo --ns-bench=200                          # 네임스페이스별 생성 비용
+ *   ./proc_demo --seccomp --work=syscall --work-ms=200  # seccomp 필터 아래에서 실행
+ *   ./proc_demo --seccomp-bench=200                     # 필터의 생성/시스템 콜 비용
+ *   ./proc_demo --mem-report --children=1000 --quiet --minimal   # 대기 워커의 PSS/USS
+ *   ./proc_demo --exec-bench=500 --exec=./proc_demo_static   # 링크 방식별 exec → main 지연
+ *   ./proc_demo --children=3 --work-ms=5000 --timeout-ms=200   # 시간 초과 자식 종료
+ *   ./proc_demo --parallel --children=4 --work=spin --work-ms=2000 --sample-ms=50   # CPU/RSS 곡선
+ *   ./proc_demo --parallel --children=4 --work=spin --work-ms=1000 --sched=1-3:batch=19 --sched=4:fifo=10:wakeup
+ *   ./proc_demo --parallel --children=3 --sched=1:default:read --sched=2-3:default:write --ioprio=2-3:idle
+ *   ./proc_demo --io-bench=4 --work-ms=3000 --io-dir=/var/tmp   # 쓰기 부하 옆의 읽기 지연
+ *   ./proc_demo --hold-fds=10000 --fd-hygiene=off --children=2   # 자식에게 fd가 새는지 확인
+ *   ./proc_demo --fd-bench=100                                    # fd 정리 방식별 생성 비용
+ *   ./proc_demo --daemon=/tmp/pd.sock --work-ms=60000 &               # 제어 소켓 데몬
+ *   ./proc_demo --ctl=/tmp/pd.sock scale 8                            # 워커 8개로 늘리기
+ *   ./proc_demo --ctl=/tmp/pd.sock spawn spin 500                     # 자식 하나 추가
+ *   ./proc_demo --ctl=/tmp/pd.sock bench 100000                       # 요청 처리량
+ *   ./proc_demo --ctl=/tmp/pd.sock upgrade                            # 무중단 재실행
+ *   seq 1000000 | sed 's/^/true /' | ./proc_demo --manifest=- --jobs=16   # 명령 100만 개, 메모리 일정
+ *   ./proc_demo --manifest-bench=20000 --jobs=8                       # xargs -P와 처리량 비교
+ *   ./proc_demo --manifest=jobs.txt --jobs=16 --keep-order --keep-order-mem=65536   # 제출 순서대로 출력
+ *   ./proc_demo --dag=build.txt --jobs=8                              # 의존성 그래프, 임계 경로 우선
+ *   ./proc_demo --dag=build.txt --jobs=8 --cache=/var/tmp/pd-cache   # 두 번째부터는 바뀐 작업만 실행
+ *   ./proc_demo --manifest=jobs.txt --jobs=8 --history=jobs.hist --order=lpt --mem-budget=4096   # 긴 작업부터, 메모리 채우기
+ *   ./proc_demo --history-bench=300 --jobs=8                          # fifo/lpt/sjf 전체 시간 비교
+ *   ./proc_demo --ctl=/tmp/pd.sock shutdown
+ *   cmake --build build --target exec_bench              # 모든 빌드 변형을 차례로 비교
  * 
  * 예상 출력:
  *   [parent] starting. (this is the terminal)
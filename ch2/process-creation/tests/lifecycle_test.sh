@@ -0,0 +1,474 @@
+#!/bin/sh
+# proc_demo 프로세스 생명주기 테스트
+#
+# 사용법: lifecycle_test.sh <proc_demo 경로> <테스트 이름> <reaper 경로>
+# ctest가 테스트마다 한 번씩 부릅니다. (CMakeLists.txt 참고)
+# run과 start_daemon은 proc_demo를 reaper(tests/reaper.c)를 거쳐 실행하므로,
+# 끝난 뒤 남은 좀비를 프로그램 출력이 아니라 /proc에서 직접 확인합니다.
+#
+# 성공하면 0, 실패하면 이유를 출력하고 1로 끝납니다.
+# 스트레스 테스트의 처리량 하한은 PROC_DEMO_MIN_SPAWN_RATE(children/s)로 바꿀 수 있습니다.
+
+PROC_DEMO="$1"
+CASE="$2"
+REAPER="$3"
+OUT="$(mktemp)"
+SOCK="$OUT.sock"
+trap 'rm -rf "$OUT" "$OUT.daemon" "$OUT.manifest" "$OUT.in" "$OUT.count" "$OUT.cache" "$OUT.hist" "$OUT.sh" "$OUT.snap" "$SOCK"' EXIT
+
+fail() {
+  echo "FAIL [$CASE]: $*"
+  echo "---- output ----"
+  cat "$OUT"
+  exit 1
+}
+
+# run <기대 종료 코드> <proc_demo 인수...>
+run() {
+  expect_rc="$1"
+  shift
+  "$REAPER" "$PROC_DEMO" "$@" >"$OUT" 2>&1
+  rc=$?
+  [ "$rc" -eq "$expect_rc" ] || fail "exit status $rc, expected $expect_rc ($*)"
+}
+
+# has <고정 문자열>: 출력에 그 줄이 있어야 함
+has() {
+  grep -qF -- "$1" "$OUT" || fail "missing output: $1"
+}
+
+# count_is <고정 문자열> <개수>
+count_is() {
+  n=$(grep -cF -- "$1" "$OUT")
+  [ "$n" -eq "$2" ] || fail "'$1' printed $n time(s), expected $2"
+}
+
+# line_of <고정 문자열>: 처음 나타나는 줄 번호
+line_of() {
+  grep -nF -- "$1" "$OUT" | head -n 1 | cut -d: -f1
+}
+
+# 프로그램이 수거를 마쳤다고 말하고, reaper가 /proc에서 남은 프로세스를 찾지 못해야 함
+no_zombies() {
+  has "No unreaped children left (no zombies)"
+  has "[reaper] no processes left behind"
+}
+
+# start_daemon [추가 인수...]: 제어 소켓 데몬을 백그라운드로 띄우고 소켓이 생길 때까지 대기 ($dpid)
+start_daemon() {
+  "$REAPER" "$PROC_DEMO" --daemon="$SOCK" --work-ms=60000 "$@" >"$OUT.daemon" 2>&1 &
+  dpid=$!
+  i=0
+  while [ ! -S "$SOCK" ] && [ $i -lt 100 ]; do sleep 0.05; i=$((i + 1)); done
+  [ -S "$SOCK" ] || { cat "$OUT.daemon" >"$OUT"; fail "daemon did not listen"; }
+}
+
+# ctl <명령...>: 데몬에 요청을 보내고 결과를 출력 파일에 덧붙임
+ctl() {
+  "$PROC_DEMO" --ctl="$SOCK" "$@" >>"$OUT" 2>&1 || fail "ctl $* failed"
+}
+
+case "$CASE" in
+  exit_codes)
+    # 자식 인덱스가 255를 넘으면 종료 코드는 idx & 0xff (300 → 44)로 전달되어야 함
+    run 0 --children=300 --jobs=16 --work-ms=0
+    has "Exit summary: 300 reaped, 300 ok, 0 failed"
+    no_zombies
+    # exec 실패도 127로 끝나지만, 인덱스 127인 자식의 정상 종료로 세면 안 됨
+    run 1 --children=127 --jobs=16 --exec=/nonexistent/proc_demo --quiet
+    has "Exit summary: 127 reaped, 0 ok, 127 failed"
+    ;;
+  exit_code_mismatch)
+    # --fail-every=5: 5번째, 10번째 자식은 idx ^ 0x80 으로 끝남 (133, 138)
+    run 1 --children=10 --fail-every=5 --work-ms=0 --quiet
+    has "Exit summary: 10 reaped, 8 ok, 2 failed"
+    has "unexpected exit code 133: 1"
+    has "unexpected exit code 138: 1"
+    has "2 of 10 child processes failed!"
+    no_zombies
+    ;;
+  signal_death)
+    run 1 --children=6 --crash-every=3 --work-ms=0
+    has "Child #3 was killed by signal 11"
+    has "Child #6 was killed by signal 11"
+    has "killed by signal 11 (Segmentation fault): 2"
+    no_zombies
+    # --minimal 자식도 실패 주입과 작업 종류를 따라야 하고, 돌릴 수 없는 작업은 시작 전에 거부
+    run 1 --children=3 --crash-every=3 --work=spin --work-ms=0 --minimal
+    has "Child #3 was killed by signal 11"
+    has "(minimal): working for 0ms (spin)"
+    run 2 --children=1 --work=alloc --minimal
+    has "invalid --minimal"
+    ;;
+  exec_failure)
+    # exec 실패는 오류 파이프로 즉시 감지되고, 자식은 127로 끝나야 함
+    run 1 --children=2 --exec=/nonexistent/proc_demo
+    count_is "exec failed: No such file or directory" 2
+    has "Child #1 exited normally with code 127"
+    has "Spawn phase latency (2 exec failure(s))"
+    no_zombies
+    ;;
+  no_zombies)
+    run 0 --parallel --children=50 --work-ms=20 --quiet
+    no_zombies
+    run 1 --children=200 --jobs=8 --work-ms=0 --crash-every=7 --fail-every=11
+    no_zombies
+    ;;
+  output_order)
+    # 파이프로 받아도 줄이 한 번씩만, 실제 일어난 순서대로 찍혀야 함
+    run 0 --children=3 --work-ms=10
+    for i in 1 2 3; do
+      count_is "[child #$i] done." 1
+      count_is "[parent] Child #$i exited normally with code $i" 1
+      a=$(line_of "[parent] fork() returned for child #$i ")
+      b=$(line_of "[parent] Child #$i is ready")
+      c=$(line_of "[child #$i] pid=")
+      d=$(line_of "[child #$i] done.")
+      e=$(line_of "[parent] Child #$i exited")
+      [ -n "$a" ] && [ -n "$b" ] && [ -n "$c" ] && [ -n "$d" ] && [ -n "$e" ] ||
+        fail "child #$i lines missing"
+      [ "$a" -lt "$b" ] && [ "$b" -lt "$c" ] && [ "$c" -lt "$d" ] && [ "$d" -lt "$e" ] ||
+        fail "child #$i lines out of order ($a $b $c $d $e)"
+    done
+    ;;
+  timeout)
+    run 1 --children=3 --work-ms=5000 --timeout-ms=200
+    has "Child #1 timed out after 200 ms"
+    has "timed out (--timeout-ms=200): 3"
+    no_zombies
+    # 제한 안에 끝나는 자식은 영향을 받지 않아야 함
+    run 0 --children=2 --work-ms=10 --timeout-ms=2000
+    no_zombies
+    ;;
+  sampler)
+    # 샘플러가 모든 자식을 추적하고, CPU 사용률이 1% 미만이어야 함
+    run 0 --parallel --children=20 --work=spin --work-ms=300 --sample-ms=20 --quiet
+    has "20 children tracked"
+    has "per-child curves"
+    pct=$(sed -n 's/.*sampler CPU .* = \([0-9]*\)\.[0-9]*% of.*/\1/p' "$OUT")
+    [ -n "$pct" ] && [ "$pct" -lt 1 ] || fail "sampler overhead not below 1%"
+    no_zombies
+    # 자식 수천 개를 풀로 돌려도 칸을 재사용하며 모두 추적하고, 오버헤드 상한을 지켜야 함
+    run 0 --children=3000 --jobs=64 --work=sleep --work-ms=50 --sample-ms=20 --quiet \
+      --sample-out="$OUT.csv"
+    has "3000 children tracked"
+    pct=$(sed -n 's/.*sampler CPU .* = \([0-9]*\)\.[0-9]*% of.*/\1/p' "$OUT")
+    [ -n "$pct" ] && [ "$pct" -lt 1 ] || fail "sampler overhead not below 1% with 3000 children"
+    [ "$(grep -c '^[0-9]' "$OUT.csv")" -gt 0 ] || fail "no samples written"
+    rm -f "$OUT.csv"
+    no_zombies
+    ;;
+  daemon)
+    # 제어 소켓으로 자식 생성/조회/시그널/워커 수 조정 후 종료, 좀비가 없어야 함
+    start_daemon
+    ctl spawn sleep 0
+    ctl scale 3
+    ctl kill 2
+    sleep 0.3
+    ctl status 1
+    ctl status 2
+    ctl status
+    ctl scale 0
+    ctl bench 2000
+    ctl shutdown
+    wait "$dpid" || fail "daemon exited with $?"
+    has "spawned child #1"
+    has "child #1 pid="
+    has "exited: exit 1"
+    has "exited: signal 15 (Terminated)"
+    has "workers=3/3"
+    has "worker target 0 (0 live)"
+    has "pipeline depth 64"
+    cat "$OUT.daemon" >>"$OUT"
+    [ ! -e "$SOCK" ] || fail "socket file left behind"
+    no_zombies
+    # 자식이 남기고 간 고아는 서브리퍼인 데몬이 받아 수거해야 함 (모르는 PID로 멈추지 않고)
+    printf '#!/bin/sh\nsleep 0.1 &\nexit 0\n' >"$OUT.sh"
+    chmod +x "$OUT.sh"
+    : >"$OUT"
+    start_daemon --exec="$OUT.sh"
+    ctl spawn
+    ctl spawn
+    sleep 0.5
+    ctl ping
+    has "2 orphan(s) reaped"
+    ctl shutdown
+    wait "$dpid" || fail "daemon exited with $?"
+    # 끝난 자식 기록은 최근 것만 남고 오래된 칸은 재사용되어야 함 (표가 끝없이 커지지 않음)
+    : >"$OUT"
+    start_daemon
+    n=0
+    while [ $n -lt 300 ]; do ctl spawn sleep 0; n=$((n + 1)); done
+    sleep 0.5
+    ctl status 300
+    has "child #300 pid="
+    "$PROC_DEMO" --ctl="$SOCK" status 1 >>"$OUT" 2>&1 && fail "status of recycled child #1 succeeded"
+    has "status failed: No such process"
+    ctl shutdown
+    wait "$dpid" || fail "daemon exited with $?"
+    ;;
+  daemon_upgrade)
+    # 데몬을 두 번 다시 exec해도 (요청, SIGHUP) 자식은 그대로 살아 있고 계속 관리되어야 함
+    start_daemon
+    ctl scale 3
+    ctl status 1
+    pid1=$(sed -n 's/.*child #1 pid=\([0-9]*\) .*/\1/p' "$OUT")
+    ctl upgrade
+    has "upgrade: 3 live children handed off, generation 1"
+    kill -HUP "$dpid"
+    sleep 0.3
+    ctl ping
+    has "pong (generation 2"
+    : >"$OUT"
+    ctl status 1
+    has "child #1 pid=$pid1 running"
+    kill -0 "$pid1" || fail "worker #1 did not survive the re-exec"
+    # 새 인스턴스도 수거와 워커 다시 채우기를 이어서 해야 함
+    ctl kill 1
+    sleep 0.3
+    ctl status
+    has "live=3 spawned=4 reaped=1 failed=1 workers=3/3"
+    ctl shutdown
+    wait "$dpid" || fail "daemon exited with $?"
+    cat "$OUT.daemon" >>"$OUT"
+    count_is "handoff pause" 2
+    has "Exit summary: 4 reaped"
+    no_zombies
+    ;;
+  manifest)
+    # 임의 명령 목록: 종료 코드, exec 실패, 시그널, 따옴표 처리를 구분해 집계
+    printf '%s\n' 'true' '# comment' '' 'false' 'sh -c "exit 3"' '/nonexistent/cmd' \
+      "sh -c 'kill -9 \$\$'" 'echo "two  spaces" a\ b' >"$OUT.manifest"
+    run 1 --manifest="$OUT.manifest" --jobs=3
+    has "Manifest: 6 jobs, 2 ok, 4 failed (1 exec failure(s), 1 killed by signal)"
+    has "Job #2 failed (exit 1): false"
+    has "failed (exec failed: No such file or directory): /nonexistent/cmd"
+    has "two  spaces a b"
+    # stdin에서 스트림으로 읽기
+    seq 2000 | sed 's/^/true /' | "$PROC_DEMO" --manifest=- --jobs=16 >"$OUT" 2>&1 ||
+      fail "streamed manifest failed"
+    has "Manifest: 2000 jobs, 2000 ok, 0 failed"
+    # stdin을 읽는 작업이 남은 목록을 먹으면 안 됨 (작업의 stdin은 /dev/null)
+    { echo 'head -c 200000'; seq 3000 | sed 's/^/true /'; } | "$PROC_DEMO" --manifest=- --jobs=4 >"$OUT" 2>&1 ||
+      fail "manifest with a stdin reader failed"
+    has "Manifest: 3001 jobs, 3001 ok, 0 failed"
+    # --jobs=0은 돌기 전에 거부
+    run 2 --manifest="$OUT.manifest" --jobs=0
+    has "invalid --jobs=0"
+    ;;
+  keep_order)
+    # 늦게 시작한 작업이 먼저 끝나도 출력은 작업 번호 순서, 메모리 한도를 넘으면 임시 파일 사용
+    : >"$OUT.manifest"
+    for i in 1 2 3 4 5 6 7 8 9 10 11 12; do
+      echo "sh -c 'sleep 0.0$(( (13 - i) % 10 )); seq $((i * 500))'" >>"$OUT.manifest"
+    done
+    run 0 --manifest="$OUT.manifest" --jobs=6 --keep-order --keep-order-mem=4096
+    has "Manifest: 12 jobs, 12 ok, 0 failed"
+    got=$(grep -v -e '^\[parent\]' -e '^\[reaper\]' -e '^$' "$OUT" | cksum)
+    want=$(for i in 1 2 3 4 5 6 7 8 9 10 11 12; do seq $((i * 500)); done | cksum)
+    [ "$got" = "$want" ] || fail "output not in job order"
+    grep -q "bytes spilled in [1-9]" "$OUT" || fail "reorder buffer never spilled"
+    ;;
+  table)
+    # 두 번째 실행은 스냅샷을 매핑해 바로 시작해야 함
+    mkdir -p "$OUT.snap"
+    run 0 --children=1 --work=table --table-entries=1000 --snapshot-dir="$OUT.snap" --work-ms=10
+    has "table cold start"
+    run 0 --children=1 --work=table --table-entries=1000 --snapshot-dir="$OUT.snap" --work-ms=10
+    has "table warm start"
+    # 슬롯 수(헤더 오프셋 32)를 2의 거듭제곱이 아닌 값으로 망가뜨리면 다시 만들어야 함
+    printf '\003\000\000\000\000\000\000\000' |
+      dd of="$OUT.snap/proc_demo-1.snap" bs=1 seek=32 conv=notrunc 2>/dev/null
+    run 0 --children=1 --work=table --table-entries=1000 --snapshot-dir="$OUT.snap" --work-ms=10
+    has "is stale or corrupt, rebuilding"
+    has "table cold start"
+    # 항목 0개는 나눗셈 전에 거부
+    run 2 --children=1 --work=table --table-entries=0
+    has "invalid --table-entries=0"
+    # 자식에게 넘길 옵션이 한도를 넘으면 일부를 버리고 돌지 않고 시작 전에 거부
+    run 2 --children=1 $(i=0; while [ $i -lt 33 ]; do echo --work-ms=0; i=$((i + 1)); done)
+    has "too many options to forward to children (33, at most 32)"
+    run 2 --children=1 $(i=0; while [ $i -lt 50 ]; do echo --work-ms=0; i=$((i + 1)); done)
+    has "too many options to forward to children (at most 32)"
+    run 0 --children=1 --quiet $(i=0; while [ $i -lt 31 ]; do echo --work-ms=0; i=$((i + 1)); done)
+    ;;
+  io_isolation)
+    # --ioprio: 작업 중인 자식의 I/O 우선순위를 밖에서(ionice) 확인
+    if command -v ionice >/dev/null 2>&1; then
+      "$PROC_DEMO" --children=1 --ioprio=1:idle --work-ms=1500 --quiet >"$OUT" 2>&1 &
+      ppid=$!
+      cpid=""
+      i=0
+      while [ -z "$cpid" ] && [ $i -lt 100 ]; do
+        sleep 0.05
+        cpid=$(pgrep -P "$ppid" | head -n 1)
+        i=$((i + 1))
+      done
+      sleep 0.2
+      prio=$(ionice -p "$cpid" 2>&1)
+      wait "$ppid" || fail "--ioprio run failed"
+      [ "$prio" = "idle" ] || fail "child ioprio is '$prio', expected idle"
+    fi
+    # --io-cgroup: 설정하든(io 컨트롤러 있음) 경고 후 무시하든 자식은 끝나고 그룹은 남지 않아야 함
+    run 0 --children=2 --io-cgroup=1-2:weight=100 --io-dir="${TMPDIR:-/tmp}" --work=write --work-ms=50
+    has "Exit summary: 2 reaped, 2 ok, 0 failed"
+    pid=$(sed -n 's/^\[parent\] My PID: //p' "$OUT")
+    mnt=$(awk '/ - cgroup2 /{print $5; exit}' /proc/self/mountinfo)
+    rel=$(sed -n 's/^0:://p' /proc/self/cgroup)
+    [ -z "$mnt" ] || [ ! -d "$mnt$rel/proc_demo-$pid" ] || fail "cgroup proc_demo-$pid left behind"
+    # --seccomp: 쓰기 작업의 시스템 콜(pwrite64, fsync)이 허용 목록에 있어 실제로 써야 함
+    run 0 --children=1 --seccomp --work=write --io-dir="${TMPDIR:-/tmp}" --work-ms=100
+    grep -q "MB written *n=1 *min= *[1-9]" "$OUT" || fail "seccomp write child wrote nothing"
+    # 잘못된 규칙과 표에 들어가지 않는 규칙은 자식을 띄우기 전에 거부 (조용히 버리지 않음)
+    run 2 --children=1 --sched=1:fifo=100
+    has "invalid --sched=1:fifo=100: fifo priority must be"
+    run 2 --children=1 --sched=1:deadline=500/1000/2000
+    has "need 0 < runtime <= deadline <= period"
+    run 2 --children=1 --ioprio=1:be/8
+    has "level must be 0..7"
+    run 2 --children=1 --io-cgroup=1:weight=0
+    has "weight must be 1..10000"
+    set --
+    for i in 1 2 3 4 5 6 7 8 9; do set -- "$@" --ioprio=$i:idle; done
+    run 2 --children=1 "$@"
+    has "too many --ioprio rules"
+    ;;
+  pid_namespace)
+    # 새 PID 네임스페이스를 만들 수 없는 환경(권한, 커널 설정)이면 확인할 것이 없음
+    "$PROC_DEMO" --ns=user,pid --children=1 --work-ms=0 --quiet >"$OUT" 2>&1 || {
+      echo "pid namespaces unavailable, nothing to check"
+      exit 0
+    }
+    # 작업 프로세스가 네임스페이스의 init이 아니므로 SIGALRM, SIGSEGV가 그대로 전달되어야 함
+    run 1 --ns=user,pid --children=1 --work-ms=5000 --timeout-ms=100
+    has "Child #1 timed out after 100 ms"
+    run 1 --ns=user,pid --children=2 --crash-every=2 --work-ms=0
+    has "Child #1 exited normally with code 1"
+    has "Child #2 was killed by signal 11"
+    no_zombies
+    # perf 카운터는 exec하지 않는 init이 아니라 작업 프로세스에 붙어야 함 (200 ms 중 절반 이상은 세야 함)
+    run 0 --ns=user,pid --children=1 --perf=task-clock --work=spin --work-ms=200
+    if ! grep -q "perf_event_open not permitted" "$OUT"; then
+      clock=$(sed -n 's/.*perf: task-clock=\([0-9]*\).*/\1/p' "$OUT")
+      [ "${clock:-0}" -ge 100000000 ] || fail "task-clock not counted for the worker: ${clock:-none}"
+    fi
+    ;;
+  dag)
+    # --jobs=1이면 실행 순서가 곧 우선순위: 사슬 x1 → x2 → x3이 먼저 적힌 짧은 작업보다 앞서야 함
+    printf '%s\n' 'short cost=0.5 echo short' 'x1 echo x1' 'x2 after=x1 echo x2' 'x3 after=x2 echo x3' >"$OUT.manifest"
+    run 0 --dag="$OUT.manifest" --jobs=1
+    order=$(grep -x -e short -e 'x[123]' "$OUT" | tr '\n' ' ')
+    [ "$order" = "x1 x2 x3 short " ] || fail "critical path not scheduled first: $order"
+    has "critical path (actual run times)"
+    # 실패한 작업에 직간접으로 의존하는 작업은 취소되고, 나머지는 계속 실행
+    printf '%s\n' 'ok1 true' 'bad after=ok1 false' 'd1 after=bad true' 'd2 after=d1,ok2 true' 'ok2 true' >"$OUT.manifest"
+    run 1 --dag="$OUT.manifest" --jobs=2
+    has "cancelled 2 job(s) depending on 'bad'"
+    has "DAG: 5 jobs, 3 ran, 2 ok, 1 failed, 2 cancelled"
+    # 순환과 없는 이름은 실행 전에 거부
+    printf '%s\n' 'a after=b true' 'b after=a true' >"$OUT.manifest"
+    run 1 --dag="$OUT.manifest"
+    has "dependency cycle"
+    ;;
+  cache)
+    # 두 번째 실행은 자식 없이 캐시에서 같은 출력과 종료 코드를 돌려주고, 입력 파일이 바뀐 작업만 다시 실행
+    echo v1 >"$OUT.in"
+    printf '%s\n' "sh -c 'echo ran >>$OUT.count; echo hello'" \
+      "in=$OUT.in sh -c 'echo ran >>$OUT.count; cat $OUT.in'" \
+      "sh -c 'echo ran >>$OUT.count; exit 3'" "sh -c 'kill -9 \$\$'" >"$OUT.manifest"
+    run 1 --manifest="$OUT.manifest" --cache="$OUT.cache" --jobs=2
+    has "0 hits, 4 misses (hit rate 0.0%), 3 stored"
+    run 1 --manifest="$OUT.manifest" --cache="$OUT.cache" --jobs=2
+    has "3 hits, 1 misses (hit rate 75.0%), 0 stored"
+    has "Manifest: 4 jobs, 2 ok, 2 failed"
+    has "Job #3 failed (exit 3)"
+    has "hello"
+    has "v1"
+    [ "$(wc -l <"$OUT.count")" -eq 3 ] || fail "cached jobs were run again"
+    echo v2 >"$OUT.in"
+    run 1 --manifest="$OUT.manifest" --cache="$OUT.cache" --jobs=2 --cache-max=0
+    has "2 hits, 2 misses (hit rate 50.0%), 1 stored"
+    has "v2"
+    has "store 0 bytes after evicting 4 entries"
+    ;;
+  history)
+    # fifo로 한 번 돌려 기록을 남기면, --jobs=1에서 lpt는 긴 작업부터, sjf는 짧은 작업부터 실행해야 함
+    printf '%s\n' "sh -c 'sleep 0.05; echo short'" "sh -c 'sleep 0.3; echo long'" \
+      "sh -c 'sleep 0.15; echo mid'" >"$OUT.manifest"
+    run 0 --manifest="$OUT.manifest" --history="$OUT.hist" --jobs=3
+    has "3 of 65536 entries used"
+    run 0 --manifest="$OUT.manifest" --history="$OUT.hist" --jobs=1 --order=lpt
+    has "Order lpt: 3 of 3 jobs had history"
+    order=$(grep -x -e short -e mid -e long "$OUT" | tr '\n' ' ')
+    [ "$order" = "long mid short " ] || fail "lpt order: $order"
+    run 0 --manifest="$OUT.manifest" --history="$OUT.hist" --jobs=1 --order=sjf
+    order=$(grep -x -e short -e mid -e long "$OUT" | tr '\n' ' ')
+    [ "$order" = "short mid long " ] || fail "sjf order: $order"
+    # 작업마다 예상 메모리가 1 MB를 넘으므로 한도 1 MB면 칸이 남아도 하나씩만 실행
+    run 0 --manifest="$OUT.manifest" --history="$OUT.hist" --jobs=3 --mem-budget=1
+    grep -q "held back [1-9][0-9]* time(s) for memory" "$OUT" || fail "memory budget never held a job back"
+    # --keep-order로 돌려도 실행 시간이 기록되어야 함
+    rm -f "$OUT.hist2"
+    run 0 --manifest="$OUT.manifest" --history="$OUT.hist2" --jobs=3 --keep-order
+    run 0 --manifest="$OUT.manifest" --history="$OUT.hist2" --jobs=1 --order=lpt
+    has "Order lpt: 3 of 3 jobs had history"
+    rm -f "$OUT.hist2"
+    ;;
+  compare)
+    # 스레드/fork/fork+exec 비교 모드도 실행 단위가 실패하면 종료 상태 1로 알려야 함
+    run 0 --compare=2 --work=sleep --work-ms=0
+    has "fork+exec"
+    run 1 --compare=2 --work=read --work-ms=10 --io-dir="$OUT.none/missing"
+    has "thread: 2 of 2 unit(s) failed"
+    has "fork: 2 of 2 unit(s) failed"
+    has "fork+exec: 2 of 2 unit(s) failed"
+    has "terminating with exit status 1"
+    ;;
+  fibers)
+    # 파이버는 모두 끝까지 실행되어야 하고, 스택 크기는 범위를 벗어나면 거부
+    run 0 --fibers=500 --fiber-threads=2 --work-ms=10
+    has "completed: 500 of 500 fibers"
+    run 0 --fibers=4 --fiber-threads=1 --fiber-stack=33554432 --work-ms=0
+    has "completed: 4 of 4 fibers"
+    run 2 --fibers=4 --fiber-stack=-1
+    has "invalid --fiber-stack=-1: must be between 1024 and 33554432 bytes"
+    run 2 --fibers=4 --fiber-stack=67108864
+    has "invalid --fiber-stack=67108864"
+    ;;
+  fd_hygiene)
+    # exec된 자식이 가진 fd를 /proc에서 직접 세어, 부모가 든 fd 50개가 --fd-hygiene=off에서만 새는지 확인
+    # (자식 경로와 작업 목록 경로 모두, 기준은 부모가 fd를 들지 않았을 때의 개수)
+    printf '#!/bin/sh\nls /proc/$$/fd\nexit 1\n' >"$OUT.sh"
+    chmod +x "$OUT.sh"
+    printf '%s\n' "sh -c 'ls /proc/\$\$/fd'" >"$OUT.manifest"
+    fds() { grep -cx '[0-9][0-9]*' "$OUT"; }
+    for how in "--children=1 --exec=$OUT.sh --quiet" "--manifest=$OUT.manifest"; do
+      run 0 $how
+      base=$(fds)
+      run 0 $how --hold-fds=50 --fd-hygiene=off
+      [ "$(fds)" -ge $((base + 50)) ] || fail "fd-hygiene=off: $(fds) fds, expected at least $((base + 50)) ($how)"
+      for mode in close cloexec; do
+        run 0 $how --hold-fds=50 --fd-hygiene=$mode
+        [ "$(fds)" -eq "$base" ] || fail "fd-hygiene=$mode: $(fds) fds leaked into the child, expected $base ($how)"
+      done
+    done
+    ;;
+  stress)
+    # 자식 수천 개를 풀로 돌리며 처리량 하한 확인
+    min_rate="${PROC_DEMO_MIN_SPAWN_RATE:-200}"
+    run 0 --children=3000 --jobs=32 --work-ms=0
+    has "Exit summary: 3000 reaped, 3000 ok, 0 failed"
+    no_zombies
+    rate=$(sed -n 's/.* children in .* ms (\([0-9]*\) children\/s).*/\1/p' "$OUT" | head -n 1)
+    [ -n "$rate" ] || fail "no throughput line"
+    [ "$rate" -ge "$min_rate" ] || fail "spawn rate $rate children/s below floor $min_rate"
+    echo "spawn rate: $rate children/s (floor $min_rate)"
+    ;;
+  *)
+    echo "unknown test case: $CASE"
+    exit 2
+    ;;
+esac
+
+echo "PASS [$CASE]"
+exit 0
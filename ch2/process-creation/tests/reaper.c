@@ -0,0 +1,107 @@
+/*
+ * 좀비 검사용 도우미 (lifecycle_test.sh가 proc_demo를 이걸 거쳐 실행)
+ *
+ * 사용법: reaper <명령> [인수...]
+ *
+ * 자신을 서브리퍼(PR_SET_CHILD_SUBREAPER)로 만든 뒤 명령을 실행합니다.
+ * 명령이 수거하지 않고 남긴 자식은 명령이 끝나는 순간 init이 아니라 이 프로세스로 넘어오므로,
+ * 명령이 끝난 직후 모든 /proc/PID/stat을 훑어 부모가 자신인 프로세스를 세면
+ * 프로그램의 출력을 믿지 않고도 좀비(상태 Z)가 남았는지 알 수 있습니다.
+ *
+ * 남긴 것이 없으면 명령의 종료 코드(시그널로 끝났으면 128 + 번호)로,
+ * 있으면 모두 수거한 뒤 125로 끝납니다.
+ * 데몬 테스트가 보내는 SIGHUP, SIGINT, SIGTERM은 명령에 그대로 전달합니다.
+ */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+
+static pid_t child = 0;
+
+static void forward_signal(int sig) {
+  if (child > 0) kill(child, sig);
+}
+
+// /proc/PID/stat에서 상태와 부모 PID (읽을 수 없으면 -1)
+static int read_stat(const char* pid, char* state, int* ppid) {
+  char path[300], buf[512];
+  snprintf(path, sizeof(path), "/proc/%s/stat", pid);
+  FILE* f = fopen(path, "r");
+  if (f == NULL) return -1;
+  size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+  fclose(f);
+  buf[n] = '\0';
+  // comm에 공백이나 괄호가 있을 수 있으므로 마지막 ')' 뒤부터 해석
+  char* p = strrchr(buf, ')');
+  if (p == NULL || sscanf(p + 2, "%c %d", state, ppid) != 2) return -1;
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <command> [args...]\n", argv[0]);
+    return 2;
+  }
+  if (prctl(PR_SET_CHILD_SUBREAPER, 1) < 0) {
+    perror("[reaper] PR_SET_CHILD_SUBREAPER failed");
+    return 2;
+  }
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = forward_signal;
+  sigaction(SIGHUP, &sa, NULL);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  pid_t pid = fork();
+  if (pid < 0) {
+    perror("[reaper] fork failed");
+    return 2;
+  }
+  if (pid == 0) {
+    signal(SIGHUP, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    execvp(argv[1], argv + 1);
+    perror("[reaper] exec failed");
+    _exit(127);
+  }
+  child = pid;
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+
+  // 명령이 남긴 프로세스: 좀비와 아직 돌고 있는 것
+  int zombies = 0, running = 0;
+  DIR* d = opendir("/proc");
+  struct dirent* e;
+  while (d && (e = readdir(d)) != NULL) {
+    char state;
+    int ppid;
+    if (e->d_name[0] < '1' || e->d_name[0] > '9') continue;
+    if (read_stat(e->d_name, &state, &ppid) < 0 || ppid != (int)getpid()) continue;
+    if (state == 'Z') {
+      zombies++;
+    } else {
+      running++;
+      kill(atoi(e->d_name), SIGKILL);
+    }
+  }
+  if (d) closedir(d);
+  if (zombies + running == 0) {
+    fprintf(stderr, "[reaper] no processes left behind by pid %d\n", (int)pid);
+  } else {
+    fprintf(stderr, "[reaper] pid %d left %d zombie(s) and %d running process(es) behind\n",
+            (int)pid, zombies, running);
+    while (wait(NULL) > 0 || errno == EINTR) {}
+    return 125;
+  }
+  if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+  return WEXITSTATUS(status);
+}